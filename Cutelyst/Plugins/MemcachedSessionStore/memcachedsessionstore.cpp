@@ -106,7 +106,10 @@ QVariantHash loadMemcSessionData(Context *c, const QString &sid, const QString &
     const static QString sessionPrefix = QCoreApplication::applicationName() + QLatin1String("_sess_");
     const QString sessionKey = sessionPrefix + sid;
 
-    QObject::connect(c->app(), &Application::afterDispatch, c, [=] () {
+    // A child of the Context as context object, so the connection goes
+    // away with it when the Context is released
+    auto guard = new QObject(c);
+    QObject::connect(c->app(), &Application::afterDispatch, guard, [=] () {
         if (!c->stash(SESSION_STORE_MEMCD_SAVE).toBool()) {
             return;
         }
@@ -107,8 +107,9 @@ QVariantHash loadSessionData(Context *c, const QString &sid)
         }
     }
 
-    // Commit data when Context gets deleted
-    QObject::connect(c->app(), &Application::afterDispatch, c, [=] () {
+    // Commit data after dispatch, the file is the context object so the
+    // connection goes away with it when the Context is released
+    QObject::connect(c->app(), &Application::afterDispatch, file, [=] () {
         if (!c->stash(SESSION_STORE_FILE_SAVE).toBool()) {
             return;
         }
@@ -48,6 +48,27 @@ void Action::setMethod(const QMetaMethod &method)
     if (method.parameterCount() == 2 && method.parameterType(1) == QMetaType::QStringList) {
         d->listSignature = true;
     }
+
+    // Methods taking only QStrings (or a QStringList) besides the Context
+    // can be called through QMetaObject::metacall() with the request arguments,
+    // avoiding copying the arguments list and building generic arguments per call
+    d->methodIndex = -1;
+    d->numberOfParams = method.parameterCount() - 1;
+    bool directCall = d->numberOfParams >= 0 && d->numberOfParams <= 9 &&
+            method.parameterTypes().constFirst().endsWith("Context*") &&
+            (method.returnType() == QMetaType::Void || d->evaluateBool);
+    if (directCall && !d->listSignature) {
+        for (int i = 1; i <= d->numberOfParams; ++i) {
+            if (method.parameterType(i) != QMetaType::QString) {
+                directCall = false;
+                break;
+            }
+        }
+    }
+
+    if (directCall) {
+        d->methodIndex = method.methodIndex();
+    }
 }
 
 void Action::setController(Controller *controller)
@@ -153,6 +174,33 @@ bool Action::doExecute(Context *c)
         return false;
     }
 
+    if (d->methodIndex != -1) {
+        const QStringList args = c->request()->args();
+        bool methodRet = false;
+
+        // argv[0] is the return value, argv[1] the Context and then the arguments
+        void *argv[11];
+        argv[0] = d->evaluateBool ? &methodRet : nullptr;
+        argv[1] = &c;
+        if (d->listSignature) {
+            argv[2] = const_cast<QStringList *>(&args);
+        } else {
+            static const QString emptyArg;
+            const int size = args.size();
+            for (int i = 0; i < d->numberOfParams; ++i) {
+                argv[i + 2] = const_cast<QString *>(i < size ? &args.at(i) : &emptyArg);
+            }
+        }
+        QMetaObject::metacall(d->controller, QMetaObject::InvokeMetaMethod, d->methodIndex, argv);
+
+        if (d->evaluateBool) {
+            c->setState(methodRet);
+            return methodRet;
+        }
+        c->setState(true);
+        return true;
+    }
+
     bool ret;
     if (d->evaluateBool) {
         bool methodRet;
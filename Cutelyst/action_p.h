@@ -27,6 +27,10 @@ class ActionPrivate
 public:
     QString ns;
     QMetaMethod method;
+    // Index of the method when it can be called directly with
+    // the request arguments through QMetaObject::metacall()
+    int methodIndex = -1;
+    int numberOfParams = 0;
     QMap<QString, QString> attributes;
     Controller *controller = nullptr;
     QStringList emptyArgs = QStringList()
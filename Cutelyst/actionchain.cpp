@@ -17,13 +17,14 @@
  */
 #include "actionchain_p.h"
 #include "request_p.h"
+#include "context_p.h"
 
 #include "context.h"
 
 using namespace Cutelyst;
 
 ActionChain::ActionChain(const ActionList &chain, QObject *parent) : Action(parent)
-  , d_ptr(new ActionChainPrivate)
+  , d_ptr(new ActionChainPrivate(this))
 {
     Q_D(ActionChain);
     d->chain = chain;
@@ -67,15 +68,24 @@ qint8 ActionChain::numberOfCaptures() const
 bool ActionChain::doExecute(Context *c)
 {
     Q_D(ActionChain);
+    return d->dispatchLinks(c, 0, c->request()->args());
+}
 
+// Dispatches the chain from step followed by the final action, when the
+// Context is detached async the next step is kept for Context::attachAsync()
+bool ActionChainPrivate::dispatchLinks(Context *c, int step, const QStringList &currentArgs)
+{
     Request *request =  c->request();
     const QStringList captures = request->captures();
-    const QStringList currentArgs = request->args();
-    const ActionList chain = d->chain;
-    Action *final = d->final;
 
     int captured = 0;
-    for (Action *action : chain) {
+    for (int i = 0; i < step; ++i) {
+        captured += qMax(0, int(chain.at(i)->numberOfCaptures()));
+    }
+    captured = qMin(captured, captures.size());
+
+    while (step < chain.size()) {
+        Action *action = chain.at(step++);
         QStringList args;
         while (args.size() < action->numberOfCaptures() && captured < captures.size()) {
             args.append(captures.at(captured++));
@@ -85,6 +95,14 @@ bool ActionChain::doExecute(Context *c)
         if (!action->dispatch(c)) {
             return false;
         }
+
+        ContextPrivate *priv = c->d_ptr;
+        if (priv->engineRequest->status & EngineRequest::Async) {
+            priv->asyncChain = q_ptr;
+            priv->asyncChainStep = step;
+            priv->asyncChainArgs = currentArgs;
+            return true;
+        }
     }
     request->setArguments(currentArgs);
 
@@ -59,6 +59,9 @@ protected:
     virtual bool doExecute(Context *c) override;
 
     ActionChainPrivate *d_ptr;
+
+private:
+    friend class Context;
 };
 
 }
@@ -24,7 +24,13 @@ namespace Cutelyst {
 
 class ActionChainPrivate
 {
+    Q_DECLARE_PUBLIC(ActionChain)
 public:
+    ActionChainPrivate(ActionChain *q) : q_ptr(q) {}
+
+    bool dispatchLinks(Context *c, int step, const QStringList &currentArgs);
+
+    ActionChain *q_ptr;
     ActionList chain;
     Action *final;
     qint8 captures = 0;
@@ -27,6 +27,7 @@
 #include "controller_p.h"
 #include "response.h"
 #include "response_p.h"
+#include "dispatcher_p.h"
 #include "dispatchtype.h"
 #include "view.h"
 #include "stats.h"
@@ -76,6 +77,7 @@ Application::Application(QObject *parent) :
 
 Application::~Application()
 {
+    qDeleteAll(d_ptr->contextPool);
     delete d_ptr;
 }
 
@@ -258,6 +260,7 @@ bool Application::setup(Engine *engine)
     d->useStats = CUTELYST_STATS().isDebugEnabled();
     d->engine = engine;
     d->config = engine->config(QLatin1String("Cutelyst"));
+    d->contextPoolSize = d->config.value(QLatin1String("context_pool_size")).toInt();
 
     d->setupHome();
 
@@ -342,6 +345,7 @@ bool Application::setup(Engine *engine)
             controller->d_ptr->init(this, d->dispatcher);
         }
 
+        d->dispatcher->d_ptr->routeCache.setMaxCost(d->config.value(QLatin1String("dispatcher_cache_size")).toInt());
         d->dispatcher->setupActions(d->controllers, d->dispatchers, d->engine->workerCore() == 0);
 
         if (zeroCore) {
@@ -363,20 +367,11 @@ void Application::handleRequest(EngineRequest *request)
 {
     Q_D(Application);
 
-    Engine *engine = d->engine;
+    Context *c = d->acquireContext(request);
+    ContextPrivate *priv = c->d_ptr;
 
-    auto priv = new ContextPrivate(this, engine, d->dispatcher, d->plugins);
-    auto c = new Context(priv);
-
-    request->context = c;
-    priv->engineRequest = request;
-    priv->response = new Response(d->headers, request);
-    priv->request = new Request(request);
-
-    Stats *stats = nullptr;
     if (d->useStats) {
-        stats = new Stats(this);
-        priv->stats = stats;
+        priv->stats = new Stats(this);
     }
 
     // Process request
@@ -395,16 +390,32 @@ void Application::handleRequest(EngineRequest *request)
 
         d->dispatcher->dispatch(c);
 
+        if (request->status & EngineRequest::Async) {
+            // Context::attachAsync() finishes it
+            priv->asyncSuspended = true;
+            return;
+        }
+
         Q_EMIT afterDispatch(c);
     }
 
+    d->finishRequest(c);
+}
+
+void ApplicationPrivate::finishRequest(Context *c)
+{
+    EngineRequest *request = c->d_ptr->engineRequest;
     request->finalize();
 
+    Stats *stats = c->d_ptr->stats;
     if (stats) {
+        const Headers &headers = c->response()->headers();
+        const QString contentType = headers.header(Headers::ContentType);
+        const QString contentLength = headers.header(Headers::ContentLength);
         qCDebug(CUTELYST_STATS, "Response Code: %d; Content-Type: %s; Content-Length: %s",
                 c->response()->status(),
-                qPrintable(c->response()->headers().header(QStringLiteral("CONTENT_TYPE"), QStringLiteral("unknown"))),
-                qPrintable(c->response()->headers().header(QStringLiteral("CONTENT_LENGTH"), QStringLiteral("unknown"))));
+                qPrintable(contentType.isEmpty() ? QStringLiteral("unknown") : contentType),
+                qPrintable(contentLength.isEmpty() ? QStringLiteral("unknown") : contentLength));
 
         quint64 endOfRequest = engine->time();
         double enlapsed = (endOfRequest - request->startOfRequest) / 1000000.0;
@@ -418,6 +429,7 @@ void Application::handleRequest(EngineRequest *request)
         qCInfo(CUTELYST_STATS) << qPrintable(QStringLiteral("Request took: %1s (%2/s)\n%3")
                                              .arg(QString::number(enlapsed, 'f'), average, QString::fromLatin1(stats->report())));
         delete stats;
+        c->d_ptr->stats = nullptr;
     }
 }
 
@@ -760,4 +772,108 @@ Component *ApplicationPrivate::createComponentPlugin(const QString &name, QObjec
     return component;
 }
 
+Context *ApplicationPrivate::acquireContext(EngineRequest *request)
+{
+    if (contextPoolSize && !contextsInUse++) {
+        idleRequestSignalReceivers = requestSignalReceivers();
+    }
+
+    Context *c;
+    if (!contextPool.isEmpty()) {
+        c = contextPool.takeLast();
+        ContextPrivate *priv = c->d_ptr;
+        priv->engineRequest = request;
+
+        Response *response = priv->response;
+        *response->d_ptr = ResponsePrivate(headers, request);
+        if (!response->isOpen()) {
+            response->open(QIODevice::WriteOnly);
+        }
+
+        priv->request->d_ptr->engineRequest = request;
+    } else {
+        Q_Q(Application);
+        auto priv = new ContextPrivate(q, engine, dispatcher, plugins);
+        c = new Context(priv);
+
+        priv->engineRequest = request;
+        priv->response = new Response(headers, request);
+        priv->request = new Request(request);
+    }
+
+    request->context = c;
+    return c;
+}
+
+void ApplicationPrivate::releaseContext(Context *c)
+{
+    if (!contextPoolSize) {
+        delete c;
+        return;
+    }
+
+    --contextsInUse;
+    if (contextPool.size() >= contextPoolSize) {
+        delete c;
+        return;
+    }
+
+    // Objects created for this request like ActionChain are parented to the Context
+    const QObjectList children = c->children();
+    qDeleteAll(children);
+    c->disconnect();
+
+    // disconnect() only drops connections where the Context is the sender,
+    // ones using it as receiver or context object would keep firing on the
+    // next requests with whatever they captured, so only deleting it is safe
+    if (requestSignalReceivers() > idleRequestSignalReceivers) {
+        delete c;
+        return;
+    }
+
+    ContextPrivate *priv = c->d_ptr;
+
+    priv->error.clear();
+    priv->stash.clear();
+    priv->locale = QLocale();
+    priv->stack.clear();
+    priv->engineRequest = nullptr;
+    priv->action = nullptr;
+    priv->view = nullptr;
+    priv->stats = nullptr;
+    priv->asyncController = nullptr;
+    priv->asyncChain = nullptr;
+    priv->asyncChainArgs.clear();
+    priv->asyncChainStep = 0;
+    priv->asyncStep = 0;
+    priv->asyncWait = 0;
+    priv->asyncRet = true;
+    priv->asyncSuspended = false;
+    priv->detached = false;
+    priv->state = false;
+
+    Request *request = priv->request;
+    request->disconnect();
+    qDeleteAll(request->d_ptr->uploads);
+    Engine *requestEngine = request->d_ptr->engine;
+    *request->d_ptr = RequestPrivate();
+    request->d_ptr->engine = requestEngine;
+
+    Response *response = priv->response;
+    response->disconnect();
+    delete response->d_ptr->bodyIODevice;
+    response->d_ptr->bodyIODevice = nullptr;
+    response->d_ptr->engineRequest = nullptr;
+
+    contextPool.append(c);
+}
+
+int ApplicationPrivate::requestSignalReceivers() const
+{
+    const Application *q = q_ptr;
+    return q->receivers(SIGNAL(beforePrepareAction(Context*,bool*))) +
+            q->receivers(SIGNAL(beforeDispatch(Context*))) +
+            q->receivers(SIGNAL(afterDispatch(Context*)));
+}
+
 #include "moc_application.cpp"
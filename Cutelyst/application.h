@@ -424,6 +424,7 @@ protected:
     void setConfig(const QString &key, const QVariant &value);
 
     friend class Engine;
+    friend class EngineRequest;
     friend class Context;
 
     /*!
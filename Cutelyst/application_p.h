@@ -38,6 +38,10 @@ public:
     void logRequestParameters(const ParamsMultiMap &params, const QString &title);
     void logRequestUploads(const QVector<Upload *> &uploads);
     Component *createComponentPlugin(const QString &name, QObject *parent, const QString &directory);
+    Context *acquireContext(EngineRequest *request);
+    void releaseContext(Context *c);
+    int requestSignalReceivers() const;
+    void finishRequest(Context *c);
 
     Application *q_ptr;
     Dispatcher *dispatcher;
@@ -53,6 +57,14 @@ public:
     bool useStats;
     bool init = false;
     QHash<QLocale, QVector<QTranslator*>> translators;
+    // Contexts kept for reuse when context_pool_size is set
+    QVector<Context *> contextPool;
+    int contextPoolSize = 0;
+    // Contexts handed out by the pool and the receivers of the per request
+    // signals the last time none was, anything above that at release time
+    // is connected to a Context being released
+    int contextsInUse = 0;
+    int idleRequestSignalReceivers = 0;
 };
 
 }
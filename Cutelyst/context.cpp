@@ -26,6 +26,9 @@
 #include "application.h"
 #include "stats.h"
 #include "enginerequest.h"
+#include "controller_p.h"
+#include "actionchain_p.h"
+#include "application_p.h"
 
 #include "config.h"
 
@@ -346,6 +349,60 @@ void Context::detach(Action *action)
     d->detached = true;
 }
 
+void Context::detachAsync()
+{
+    Q_D(Context);
+    d->engineRequest->status |= EngineRequest::Async;
+}
+
+void Context::attachAsync()
+{
+    Q_D(Context);
+    EngineRequest *request = d->engineRequest;
+    if (!request || !(request->status & EngineRequest::Async)) {
+        return;
+    }
+    request->status &= ~EngineRequest::Async;
+
+    // Attached before the action returned, the chain simply goes on
+    if (!d->asyncSuspended) {
+        return;
+    }
+    d->asyncSuspended = false;
+
+    if (d->asyncChain) {
+        ActionChain *chain = d->asyncChain;
+        d->asyncChain = nullptr;
+        if (!chain->d_ptr->dispatchLinks(this, d->asyncChainStep, d->asyncChainArgs)) {
+            d->asyncRet = false;
+        }
+
+        if (request->status & EngineRequest::Async) {
+            // Detached again by one of the remaining links
+            d->asyncSuspended = true;
+            return;
+        }
+    }
+
+    if (d->asyncController) {
+        Controller *controller = d->asyncController;
+        d->asyncController = nullptr;
+        controller->d_ptr->dispatchSteps(this, d->asyncStep, d->asyncRet);
+
+        if (request->status & EngineRequest::Async) {
+            // Detached again by one of the remaining actions
+            d->asyncSuspended = true;
+            return;
+        }
+    }
+
+    Q_EMIT d->app->afterDispatch(this);
+
+    d->app->d_ptr->finishRequest(this);
+
+    request->processingFinished();
+}
+
 bool Context::forward(Component *action)
 {
     Q_D(Context);
@@ -442,33 +499,29 @@ QString Context::translate(const char *context, const char *sourceText, const ch
 
 bool Context::wait(uint count)
 {
-    Q_UNUSED(count)
-//    Q_D(Context);
-//    if (d->loop) {
-//        d->loopWait += count;
-//        return false;
-//    }
-
-//    if (count) {
-//        d->loopWait = count;
-//        d->loop = new QEventLoop(this);
-//        d->loop->exec();
-//        return true;
-//    }
+    Q_D(Context);
+    if (d->asyncWait) {
+        d->asyncWait += count;
+        return false;
+    }
+
+    if (count) {
+        d->asyncWait = count;
+        detachAsync();
+        return true;
+    }
     return false;
 }
 
 void Context::next(bool force)
 {
-//    Q_D(Context);
-    Q_UNUSED(force)
-//    if (!d->loop || (--d->loopWait && !force)) {
-//        return;
-//    }
+    Q_D(Context);
+    if (!d->asyncWait || (--d->asyncWait && !force)) {
+        return;
+    }
 
-//    d->loop->quit();
-//    d->loop->deleteLater();
-//    d->loop = nullptr;
+    d->asyncWait = 0;
+    attachAsync();
 }
 
 QString ContextPrivate::statsStartExecute(Component *code)
@@ -355,6 +355,21 @@ public:
      */
     void detach(Action *action = nullptr);
 
+    /**
+     * Detaches this Context from the request processing so that the current action can
+     * return before the response is ready, e.g. while waiting for a database or network reply.
+     * The remaining actions of the chain (including End) and the response finalization
+     * only happen once attachAsync() is called, meanwhile the engine keeps the connection
+     * alive and serves other requests.
+     */
+    void detachAsync();
+
+    /**
+     * Reattaches a Context detached with detachAsync(), the remaining actions of the
+     * chain are executed and the response is finalized and sent to the client.
+     */
+    void attachAsync();
+
     /**
      * This is one way of calling another action (method) in the same or
      * a different controller. You can also use directly call another method
@@ -482,28 +497,23 @@ public:
     QString translate(const char *context, const char *sourceText, const char *disambiguation = nullptr, int n = -1) const;
 
     /*!
-     * This method is deprecated and no longer works, creating local event loops
-     * leads to crashes.
+     * Detaches this Context with detachAsync() until next() is called \p count times,
+     * no local event loop is created so the action must return after calling it.
      *
-     * This creates a local event loop that requires next() to be called \p count times.
+     * If wait() was already called and next() wasn't called enough times it will
+     * increase the counter of the unfinished wait().
      *
-     * If wait() was already called and didn't return it will increase the counter of
-     * the unfinished wait().
-     *
-     * Returns true when the event loop finishes and false if the call only increased
-     * the event loop counter.
+     * Returns true when the Context was detached and false if the call only increased
+     * the counter.
      */
-    Q_DECL_DEPRECATED bool wait(uint count = 1);
+    bool wait(uint count = 1);
 
 public Q_SLOTS:
     /*!
-     * This method is deprecated and no longer works, creating local event loops
-     * leads to crashes.
-     *
-     * Decreases the local event loop counter created by wait() eventually
-     * quitting it's execution if 0 is reached.
+     * Decreases the counter created by wait() calling attachAsync()
+     * once 0 is reached.
      *
-     * If you set force to true it will quit the loop immediately
+     * If you set force to true it will attach immediately
      * regardless of it's counter.
      */
     void next(bool force = false);
@@ -515,8 +525,12 @@ protected:
     Context(ContextPrivate *priv);
 
     friend class Application;
+    friend class ApplicationPrivate;
     friend class Action;
     friend class DispatchType;
+    friend class DispatcherPrivate;
+    friend class ControllerPrivate;
+    friend class ActionChainPrivate;
     friend class Plugin;
     friend class Engine;
     ContextPrivate *d_ptr;
@@ -27,10 +27,10 @@
 #include <QVariantHash>
 #include <QStack>
 
-class QEventLoop;
 namespace Cutelyst {
 
 class Stats;
+class ActionChain;
 class ContextPrivate
 {
 public:
@@ -62,8 +62,17 @@ public:
     Action *action = nullptr;
     View *view = nullptr;
     Stats *stats = nullptr;
-    QEventLoop *loop = nullptr;
-    uint loopWait = 0;
+    // Where the dispatch chain continues once attachAsync() is called
+    Controller *asyncController = nullptr;
+    // The chain link detached async, resumed before asyncController
+    ActionChain *asyncChain = nullptr;
+    QStringList asyncChainArgs;
+    int asyncChainStep = 0;
+    int asyncStep = 0;
+    uint asyncWait = 0;
+    bool asyncRet = true;
+    // The chain returned while detached async
+    bool asyncSuspended = false;
     bool detached = false;
     bool state = false;
 };
@@ -16,6 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include "controller_p.h"
+#include "context_p.h"
 
 #include "application.h"
 #include "dispatcher.h"
@@ -162,26 +163,39 @@ void ControllerPrivate::setupFinished()
 bool Controller::_DISPATCH(Context *c)
 {
     Q_D(Controller);
+    return d->dispatchSteps(c, 0, true);
+}
 
-    bool ret = true;
+// Dispatches to Begin and Auto, the Action and End starting at step,
+// when the Context is detached async the remaining steps are kept
+// for Context::attachAsync()
+bool ControllerPrivate::dispatchSteps(Context *c, int step, bool ret)
+{
+    ContextPrivate *priv = c->d_ptr;
+    const int beginAutoSize = beginAutoList.size();
+    while (step <= beginAutoSize + 1) {
+        Action *action;
+        if (step < beginAutoSize) {
+            action = beginAutoList.at(step);
+        } else if (step == beginAutoSize) {
+            // Skipped when Begin or Auto failed
+            action = ret ? c->action() : nullptr;
+        } else {
+            action = end;
+        }
+        ++step;
 
-    // Dispatch to Begin and Auto
-    const auto beginAutoList = d->beginAutoList;
-    for (Action *action : beginAutoList) {
-        if (!action->dispatch(c)) {
+        if (action && !action->dispatch(c)) {
             ret = false;
-            break;
+            step = qMax(step, beginAutoSize);
         }
-    }
-
-    // Dispatch to Action
-    if (ret && !c->action()->dispatch(c)) {
-        ret = false;
-    }
 
-    // Dispatch to End
-    if (d->end && !d->end->dispatch(c)) {
-        ret = false;
+        if (priv->engineRequest->status & EngineRequest::Async) {
+            priv->asyncController = q_ptr;
+            priv->asyncStep = step;
+            priv->asyncRet = ret;
+            break;
+        }
     }
 
     return ret;
@@ -173,6 +173,7 @@ private:
     Q_DECLARE_PRIVATE(Controller)
     friend class Application;
     friend class Dispatcher;
+    friend class Context;
 };
 
 }
@@ -40,6 +40,8 @@ public:
     QString parsePathAttr(const QString &value);
     QString parseChainedAttr(const QString &attr);
 
+    bool dispatchSteps(Context *c, int step, bool ret);
+
     QObject *instantiateClass(const QString &name, const QByteArray &super);
     bool superIsClassName(const QMetaObject *super, const QByteArray &className);
 
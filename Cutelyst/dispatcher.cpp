@@ -21,16 +21,22 @@
 #include "application.h"
 #include "engine.h"
 #include "context.h"
+#include "context_p.h"
 #include "controller.h"
 #include "controller_p.h"
 #include "action.h"
 #include "request_p.h"
 #include "dispatchtypepath.h"
 #include "dispatchtypechained.h"
+#include "dispatchtypepath_p.h"
+#include "actionchain.h"
 #include "utils.h"
 
 #include <QUrl>
 #include <QMetaMethod>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 using namespace Cutelyst;
 
@@ -116,6 +122,9 @@ void Dispatcher::setupActions(const QVector<Controller*> &controllers, const QVe
         ++i;
     }
 
+    d->buildRouteIndex();
+    d->routeCache.clear();
+
     if (printActions) {
         // List all public actions
         for (DispatchType *dispatch : dispatchers) {
@@ -166,7 +175,12 @@ void Dispatcher::prepareAction(Context *c)
     Q_D(Dispatcher);
 
     Request *request = c->request();
-    d->prepareAction(c, request->path());
+    // Custom dispatch types might not match by path alone
+    if (d->routeIndex && d->routeCache.maxCost()) {
+        d->prepareActionCached(c, request->path());
+    } else {
+        d->prepareAction(c, request->path());
+    }
 
     static const auto &log = CUTELYST_DISPATCHER();
     if (log.isDebugEnabled()) {
@@ -183,6 +197,60 @@ void Dispatcher::prepareAction(Context *c)
 void DispatcherPrivate::prepareAction(Context *c, const QString &requestPath) const
 {
     QString path = normalizePath(requestPath);
+
+    if (routeIndex) {
+        QVector<QStringRef> segments;
+        if (!path.isEmpty()) {
+            segments = path.splitRef(QLatin1Char('/'));
+        }
+
+        // Path nodes along the request path, depth 0 being the root
+        QVarLengthArray<int, 16> nodes;
+        nodes.append(0);
+        for (const QStringRef &segment : segments) {
+            const int child = routeChild(nodes.last(), segment);
+            if (child == -1) {
+                break;
+            }
+            nodes.append(child);
+        }
+
+        // Same order as stripping one segment at a time, but only
+        // the levels where some dispatch type can match are tried,
+        // Chained only matches the full path (without args)
+        const int size = segments.size();
+        for (int depth = size; depth >= 0; --depth) {
+            const bool hasPath = depth < nodes.size() && routes[size_t(nodes[depth])].hasPath;
+            if (!hasPath && depth != size) {
+                continue;
+            }
+
+            QString prefix;
+            if (depth == size) {
+                prefix = path;
+            } else if (depth) {
+                prefix = path.left(segments.at(depth).position() - 1);
+            }
+
+            QStringList args;
+            args.reserve(size - depth);
+            for (int i = depth; i < size; ++i) {
+                args.append(segments.at(i).toString());
+            }
+
+            for (DispatchType *type : dispatchers) {
+                if (type == pathType ? !hasPath : depth != size) {
+                    continue;
+                }
+
+                if (type->match(c, prefix, args) == DispatchType::ExactMatch) {
+                    return;
+                }
+            }
+        }
+        return;
+    }
+
     QStringList args;
 
     //  "foo/bar"
@@ -212,6 +280,106 @@ void DispatcherPrivate::prepareAction(Context *c, const QString &requestPath) co
     }
 }
 
+void DispatcherPrivate::prepareActionCached(Context *c, const QString &requestPath) const
+{
+    Request *request = c->request();
+
+    RouteCacheEntry *entry = routeCache.object(requestPath);
+    if (entry) {
+        if (entry->action || !entry->chain.isEmpty()) {
+            Action *action = entry->action;
+            if (!action) {
+                action = new ActionChain(entry->chain, c);
+                request->setCaptures(entry->captures);
+            }
+            request->setArguments(entry->args);
+            request->setMatch(entry->match);
+            c->d_ptr->action = action;
+        }
+        return;
+    }
+
+    prepareAction(c, requestPath);
+
+    // Paths that matched nothing are cached too, so
+    // hot 404s skip the matching as well
+    entry = new RouteCacheEntry;
+    Action *action = c->action();
+    if (action) {
+        auto chain = qobject_cast<ActionChain *>(action);
+        if (chain) {
+            entry->chain = chain->chain();
+            entry->captures = request->captures();
+        } else {
+            entry->action = action;
+        }
+        entry->args = request->args();
+        entry->match = request->match();
+    }
+    routeCache.insert(requestPath, entry);
+}
+
+void DispatcherPrivate::buildRouteIndex()
+{
+    routes.clear();
+    pathType = nullptr;
+    routeIndex = false;
+
+    // Only the built in types are known to match this way,
+    // custom ones still get called for every stripped segment
+    for (DispatchType *type : dispatchers) {
+        const QMetaObject *mo = type->metaObject();
+        if (mo == &DispatchTypePath::staticMetaObject && !pathType) {
+            pathType = type;
+        } else if (mo != &DispatchTypeChained::staticMetaObject) {
+            pathType = nullptr;
+            return;
+        }
+    }
+
+    routes.resize(1);
+    if (pathType) {
+        const StringActionsMap &paths = static_cast<DispatchTypePath *>(pathType)->d_ptr->paths;
+        for (auto it = paths.constBegin(); it != paths.constEnd(); ++it) {
+            int node = 0;
+            if (it.key() != QLatin1String("/")) {
+                const QStringList parts = it.key().split(QLatin1Char('/'));
+                for (const QString &part : parts) {
+                    std::vector<std::pair<QString, int>> &children = routes[size_t(node)].children;
+                    auto child = std::lower_bound(children.begin(), children.end(), part,
+                                                  [](const std::pair<QString, int> &a, const QString &b) {
+                        return a.first < b;
+                    });
+                    if (child != children.end() && child->first == part) {
+                        node = child->second;
+                    } else {
+                        const int index = int(routes.size());
+                        children.insert(child, { part, index });
+                        routes.emplace_back();
+                        node = index;
+                    }
+                }
+            }
+            routes[size_t(node)].hasPath = true;
+        }
+    }
+
+    routeIndex = true;
+}
+
+int DispatcherPrivate::routeChild(int node, const QStringRef &segment) const
+{
+    const std::vector<std::pair<QString, int>> &children = routes[size_t(node)].children;
+    auto child = std::lower_bound(children.begin(), children.end(), segment,
+                                  [](const std::pair<QString, int> &a, const QStringRef &b) {
+        return a.first.compare(b) < 0;
+    });
+    if (child != children.end() && child->first.compare(segment) == 0) {
+        return child->second;
+    }
+    return -1;
+}
+
 Action *Dispatcher::getAction(const QString &name, const QString &nameSpace) const
 {
     Q_D(const Dispatcher);
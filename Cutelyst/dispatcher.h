@@ -114,6 +114,9 @@ protected:
 
     /**
      * Used by Application to find a matching action for the current Context
+     *
+     * Setting dispatcher_cache_size on the Cutelyst config group keeps that many
+     * resolved request paths, so repeated URLs skip matching entirely.
      */
     void prepareAction(Context *c);
 
@@ -20,8 +20,30 @@
 
 #include "dispatcher.h"
 
+#include <QtCore/QCache>
+
+#include <vector>
+
 namespace Cutelyst {
 
+// Segment trie of the Path actions, a request path is walked
+// once instead of being looked up again for every stripped segment
+struct RouteNode {
+    // Sorted by segment
+    std::vector<std::pair<QString, int>> children;
+    bool hasPath = false;
+};
+
+// What a request path resolved to, replayed on cache hits
+struct RouteCacheEntry {
+    // Null for chains since their ActionChain belongs to the Context
+    Action *action = nullptr;
+    ActionList chain;
+    QStringList args;
+    QStringList captures;
+    QString match;
+};
+
 class DispatcherPrivate
 {
     Q_DECLARE_PUBLIC(Dispatcher)
@@ -29,6 +51,9 @@ public:
     DispatcherPrivate(Dispatcher *q) : q_ptr(q) {}
 
     inline void prepareAction(Context *c, const QString &requestPath) const;
+    inline void prepareActionCached(Context *c, const QString &requestPath) const;
+    void buildRouteIndex();
+    inline int routeChild(int node, const QStringRef &segment) const;
 
     void printActions() const;
     inline ActionList getContainers(const QString &ns) const;
@@ -44,6 +69,12 @@ public:
     ActionList rootActions;
     QMap<QString, Controller *> controllers;
     QVector<DispatchType*> dispatchers;
+    std::vector<RouteNode> routes;
+    DispatchType *pathType = nullptr;
+    // Per worker LRU of request paths, disabled unless
+    // dispatcher_cache_size is set and only used with the route index
+    mutable QCache<QString, RouteCacheEntry> routeCache{0};
+    bool routeIndex = false;
     Dispatcher *q_ptr;
 };
 
@@ -23,6 +23,8 @@
 
 #include <QtCore/QUrl>
 
+#include <algorithm>
+
 using namespace Cutelyst;
 
 DispatchTypeChained::DispatchTypeChained(QObject *parent) : DispatchType(parent)
@@ -170,23 +172,37 @@ DispatchType::MatchType DispatchTypeChained::match(Context *c, const QString &pa
 
     Q_D(const DispatchTypeChained);
 
-    const BestActionMatch ret = d->recurseMatch(args.size(), QStringLiteral("/"), path.split(QLatin1Char('/')));
-    const ActionList chain = ret.actions;
-    if (ret.isNull || chain.isEmpty()) {
+    if (!d->compiled) {
+        const_cast<DispatchTypeChainedPrivate *>(d)->compile();
+    }
+
+    const QVector<QStringRef> segments = path.splitRef(QLatin1Char('/'));
+    const ChainedMatch ret = d->walk(d->rootNode, segments, 0);
+    if (ret.isNull || ret.actions.isEmpty()) {
         return NoMatch;
     }
 
     QStringList decodedArgs;
-    const QStringList parts = ret.parts;
-    for (const QString &arg : parts) {
-        QString aux = arg;
+    for (int i = ret.argsBegin; i < segments.size(); ++i) {
+        QString aux = segments.at(i).toString();
         decodedArgs.append(Utils::decodePercentEncoding(&aux));
     }
 
+    QStringList captures;
+    for (int index : ret.captures) {
+        captures.append(segments.at(index).toString());
+    }
+
+    ActionList chain;
+    chain.reserve(ret.actions.size());
+    for (Action *action : ret.actions) {
+        chain.append(action);
+    }
+
     ActionChain *action = new ActionChain(chain, c);
     Request *request = c->request();
     request->setArguments(decodedArgs);
-    request->setCaptures(ret.captures);
+    request->setCaptures(captures);
     request->setMatch(QLatin1Char('/') + action->reverse());
     setupMatchedAction(c, action);
 
@@ -260,6 +276,8 @@ bool DispatchTypeChained::registerAction(Action *action)
         d->endPoints.push_back(action);
     }
 
+    d->compiled = false;
+
     return true;
 }
 
@@ -345,111 +363,168 @@ Action *DispatchTypeChained::expandAction(const Context *c, Action *action) cons
 
 bool DispatchTypeChained::inUse()
 {
-    Q_D(const DispatchTypeChained);
+    Q_D(DispatchTypeChained);
 
     if (d->actions.isEmpty()) {
         return false;
     }
 
-    // Optimize end points
+    // All actions are registered by now
+    d->compile();
 
     return true;
 }
 
-BestActionMatch DispatchTypeChainedPrivate::recurseMatch(int reqArgsSize, const QString &parent, const QStringList &pathParts) const
+void DispatchTypeChainedPrivate::compile()
 {
-    BestActionMatch bestAction;
-    auto it = childrenOf.constFind(parent);
-    if (it == childrenOf.constEnd()) {
+    nodes.clear();
+
+    QHash<QString, int> nodeIndex;
+    for (auto it = childrenOf.constBegin(); it != childrenOf.constEnd(); ++it) {
+        nodeIndex.insert(it.key(), nodeIndex.size());
+    }
+    nodes.resize(size_t(nodeIndex.size()));
+
+    for (auto it = childrenOf.constBegin(); it != childrenOf.constEnd(); ++it) {
+        ChainedNode &node = nodes[size_t(nodeIndex.value(it.key()))];
+
+        const StringActionsMap &children = it.value();
+        QStringList keys = children.keys();
+        std::stable_sort(keys.begin(), keys.end(), [](const QString &a, const QString &b) -> bool {
+            // action2 then action1 to try the longest part first
+            return b.size() < a.size();
+        });
+
+        for (const QString &tryPart : keys) {
+            ChainedEdge edge;
+            if (!tryPart.isEmpty()) {
+                edge.segments = tryPart.split(QLatin1Char('/'));
+            }
+
+            const Actions &tryActions = children.constFind(tryPart).value();
+            for (Action *action : tryActions) {
+                const QMap<QString, QString> attributes = action->attributes();
+
+                ChainedCandidate candidate;
+                candidate.action = action;
+                candidate.pathParts = attributes.value(QStringLiteral("PathPart")).count(QLatin1Char('/')) + 1;
+                if (attributes.contains(QStringLiteral("CaptureArgs"))) {
+                    candidate.isCapture = true;
+                    candidate.captureCount = action->numberOfCaptures();
+                    candidate.children = nodeIndex.value(QLatin1Char('/') + action->reverse(), -1);
+                } else {
+                    candidate.hasArgsAttr = !attributes.value(QStringLiteral("Args")).isEmpty();
+                }
+                edge.candidates.push_back(candidate);
+            }
+
+            node.edges.push_back(edge);
+        }
+    }
+
+    rootNode = nodeIndex.value(QStringLiteral("/"), -1);
+    compiled = true;
+}
+
+ChainedMatch DispatchTypeChainedPrivate::walk(int nodeIndex, const QVector<QStringRef> &segments, int pos) const
+{
+    ChainedMatch bestAction;
+    if (nodeIndex == -1) {
         return bestAction;
     }
 
-    const StringActionsMap &children = it.value();
-    QStringList keys = children.keys();
-    std::sort(keys.begin(), keys.end(), [](const QString &a, const QString &b) -> bool {
-        // action2 then action1 to try the longest part first
-        return b.size() < a.size();
-    });
+    const int size = segments.size();
+    const ChainedNode &node = nodes[size_t(nodeIndex)];
+    for (const ChainedEdge &edge : node.edges) {
+        int partsPos = pos;
+        const int edgeSize = edge.segments.size();
+        if (edgeSize) {
+            if (size - pos < edgeSize) {
+                continue;
+            }
 
-    for (const QString &tryPart : keys) {
-        QStringList parts = pathParts;
-        if (!tryPart.isEmpty()) {
-            // We want to count the number of parts a split would give
-            // and remove the number of parts from tryPart
-            int tryPartCount = tryPart.count(QLatin1Char('/')) + 1;
-            const QStringList possiblePart = parts.mid(0, tryPartCount);
-            if (tryPart != possiblePart.join(QLatin1Char('/'))) {
+            bool matched = true;
+            for (int i = 0; i < edgeSize; ++i) {
+                if (segments.at(pos + i) != edge.segments.at(i)) {
+                    matched = false;
+                    break;
+                }
+            }
+            if (!matched) {
                 continue;
             }
-            parts = parts.mid(tryPartCount);
+            partsPos += edgeSize;
         }
 
-        const Actions tryActions = children.value(tryPart);
-        for (Action *action : tryActions) {
-            const QMap<QString, QString> attributes = action->attributes();
-            if (attributes.contains(QStringLiteral("CaptureArgs"))) {
-                const int captureCount = action->numberOfCaptures();
-                // Short-circuit if not enough remaining parts
-                if (parts.size() < captureCount) {
+        const int remaining = size - partsPos;
+        for (const ChainedCandidate &candidate : edge.candidates) {
+            Action *action = candidate.action;
+            if (candidate.isCapture) {
+                int captureCount = candidate.captureCount;
+                int localPos = partsPos;
+                if (captureCount < 0) {
+                    // CaptureArgs without a value captures all remaining parts
+                    // and still offers them to the children
+                    captureCount = remaining;
+                } else if (remaining < captureCount) {
+                    // Short-circuit if not enough remaining parts
                     continue;
+                } else {
+                    localPos += captureCount;
                 }
 
-                // strip CaptureArgs into list
-                const QStringList captures = parts.mid(0, captureCount);
-
                 // check if the action may fit, depending on a given test by the app
-                if (!action->matchCaptures(captures.size())) {
+                if (!action->matchCaptures(captureCount)) {
                     continue;
                 }
 
-                const QStringList localParts = parts.mid(captureCount);
-
                 // try the remaining parts against children of this action
-                const BestActionMatch ret = recurseMatch(reqArgsSize, QLatin1Char('/') + action->reverse(), localParts);
+                const ChainedMatch ret = walk(candidate.children, segments, localPos);
 
                 //    No best action currently
                 // OR The action has less parts
                 // OR The action has equal parts but less captured data (ergo more defined)
-                ActionList actions = ret.actions;
-                const QStringList actionCaptures = ret.captures;
-                const QStringList actionParts = ret.parts;
-                int bestActionParts = bestAction.parts.size();
-
-                if (!actions.isEmpty() &&
+                const int actionParts = size - ret.argsBegin;
+                const int bestActionParts = size - bestAction.argsBegin;
+                if (!ret.actions.isEmpty() &&
                         (bestAction.isNull ||
-                         actionParts.size() < bestActionParts ||
-                         (actionParts.size() == bestActionParts &&
-                          actionCaptures.size() < bestAction.captures.size() &&
+                         actionParts < bestActionParts ||
+                         (actionParts == bestActionParts &&
+                          ret.captures.size() < bestAction.captures.size() &&
                           ret.n_pathParts > bestAction.n_pathParts))) {
-                    actions.prepend(action);
-                    int pathparts = attributes.value(QStringLiteral("PathPart")).count(QLatin1Char('/')) + 1;
-                    bestAction.actions = actions;
-                    bestAction.captures = captures + actionCaptures;
-                    bestAction.parts = actionParts;
-                    bestAction.n_pathParts = pathparts + ret.n_pathParts;
+                    bestAction.actions.clear();
+                    bestAction.actions.append(action);
+                    bestAction.actions.append(ret.actions.constData(), ret.actions.size());
+
+                    bestAction.captures.clear();
+                    for (int i = 0; i < captureCount; ++i) {
+                        bestAction.captures.append(partsPos + i);
+                    }
+                    bestAction.captures.append(ret.captures.constData(), ret.captures.size());
+
+                    bestAction.argsBegin = ret.argsBegin;
+                    bestAction.n_pathParts = candidate.pathParts + ret.n_pathParts;
                     bestAction.isNull = false;
                 }
             } else {
-                if (!action->match(reqArgsSize + parts.size())) {
+                if (!action->match(remaining)) {
                     continue;
                 }
 
-                const QString argsAttr = attributes.value(QStringLiteral("Args"));
-                const int pathparts = attributes.value(QStringLiteral("PathPart")).count(QLatin1Char('/')) + 1;
                 //    No best action currently
                 // OR This one matches with fewer parts left than the current best action,
                 //    And therefore is a better match
                 // OR No parts and this expects 0
                 //    The current best action might also be Args(0),
                 //    but we couldn't chose between then anyway so we'll take the last seen
-
                 if (bestAction.isNull ||
-                        parts.size() < bestAction.parts.size() ||
-                        (parts.isEmpty() && !argsAttr.isEmpty() && action->numberOfArgs() == 0)) {
-                    bestAction.actions = { action };
-                    bestAction.captures = QStringList();
-                    bestAction.parts = parts;
-                    bestAction.n_pathParts = pathparts;
+                        remaining < size - bestAction.argsBegin ||
+                        (remaining == 0 && candidate.hasArgsAttr && action->numberOfArgs() == 0)) {
+                    bestAction.actions.clear();
+                    bestAction.actions.append(action);
+                    bestAction.captures.clear();
+                    bestAction.argsBegin = partsPos;
+                    bestAction.n_pathParts = candidate.pathParts;
                     bestAction.isNull = false;
                 }
             }
@@ -19,6 +19,9 @@
 #define DISPATCHTYPECHAINED_P_H
 
 #include "dispatchtypechained.h"
+
+#include <QtCore/QVarLengthArray>
+
 #include <vector>
 
 namespace Cutelyst {
@@ -28,10 +31,35 @@ typedef std::vector<Action *> Actions;
 typedef QHash<QString, Actions> StringActionsMap;
 typedef QHash<QString, StringActionsMap> StringStringActionsMap;
 
-struct BestActionMatch {
-    ActionList actions;
-    QStringList captures;
-    QStringList parts;
+// An action reachable from a ChainedNode through a PathPart
+struct ChainedCandidate {
+    Action *action;
+    // Index of the node with the actions chained to this one
+    int children = -1;
+    int captureCount = 0;
+    int pathParts = 1;
+    bool isCapture = false;
+    bool hasArgsAttr = false;
+};
+
+// A PathPart split into segments and the actions using it
+struct ChainedEdge {
+    QStringList segments;
+    std::vector<ChainedCandidate> candidates;
+};
+
+// Compiled form of childrenOf for a given parent,
+// edges are sorted to try the longest PathPart first
+struct ChainedNode {
+    std::vector<ChainedEdge> edges;
+};
+
+// Best match found while walking the compiled tree, captures are
+// indexes of the path segments and args are the segments from argsBegin
+struct ChainedMatch {
+    QVarLengthArray<Action *, 16> actions;
+    QVarLengthArray<int, 16> captures;
+    int argsBegin = 0;
     int n_pathParts = 0;
     bool isNull = true;
 };
@@ -39,7 +67,8 @@ struct BestActionMatch {
 class DispatchTypeChainedPrivate
 {
 public:
-    BestActionMatch recurseMatch(int reqArgsSize, const QString &parent, const QStringList &pathParts) const;
+    void compile();
+    ChainedMatch walk(int node, const QVector<QStringRef> &segments, int pos) const;
     bool checkArgsAttr(Action *action, const QString &name) const;
     static QString listExtraHttpMethods(Action *action);
     static QString listExtraConsumes(Action *action);
@@ -47,6 +76,11 @@ public:
     Actions endPoints;
     StringActionMap actions;
     StringStringActionsMap childrenOf;
+
+    // Built once all actions are registered
+    std::vector<ChainedNode> nodes;
+    int rootNode = -1;
+    bool compiled = false;
 };
 
 }
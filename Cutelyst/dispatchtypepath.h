@@ -51,6 +51,7 @@ public:
     virtual QString uriForAction(Action *action, const QStringList &captures) const override;
 
 protected:
+    friend class DispatcherPrivate;
     DispatchTypePathPrivate *d_ptr;
 };
 
@@ -311,7 +311,10 @@ void Engine::processRequest(EngineRequest *request)
 
     d->app->handleRequest(request);
 
-    request->processingFinished();
+    // Detached requests are finished by Context::attachAsync()
+    if (!(request->status & EngineRequest::Async)) {
+        request->processingFinished();
+    }
 }
 
 QVariantMap Engine::opts() const
@@ -20,6 +20,7 @@
 #include "common.h"
 
 #include <Cutelyst/response_p.h>
+#include <Cutelyst/application_p.h>
 #include <Cutelyst/Context>
 
 #include <QLoggingCategory>
@@ -38,6 +39,14 @@ EngineRequest::~EngineRequest()
     delete context;
 }
 
+void EngineRequest::releaseContext()
+{
+    if (context) {
+        context->app()->d_ptr->releaseContext(context);
+        context = nullptr;
+    }
+}
+
 void EngineRequest::finalizeBody()
 {
     if (!(status & EngineRequest::Chunked)) {
@@ -45,10 +54,16 @@ void EngineRequest::finalizeBody()
         QIODevice *body = response->bodyDevice();
 
         if (body) {
-            body->seek(0);
+            body->seek(bodyOffset);
+            qint64 remaining = bodyLength;
             char block[64 * 1024];
-            while (!body->atEnd()) {
-                qint64 in = body->read(block, sizeof(block));
+            while (remaining != 0 && !body->atEnd()) {
+                qint64 len = sizeof(block);
+                if (remaining > 0 && remaining < len) {
+                    len = remaining;
+                }
+
+                qint64 in = body->read(block, len);
                 if (in <= 0) {
                     break;
                 }
@@ -57,6 +72,10 @@ void EngineRequest::finalizeBody()
                     qCWarning(CUTELYST_ENGINEREQUEST) << "Failed to write body";
                     break;
                 }
+
+                if (remaining > 0) {
+                    remaining -= in;
+                }
             }
         } else {
             const QByteArray bodyByteArray = response->body();
@@ -111,6 +130,111 @@ void EngineRequest::finalizeCookies()
     }
 }
 
+// Parses a single "bytes=first-last" range of a body with \p size bytes
+static bool parseByteRange(const QString &range, qint64 size, qint64 &start, qint64 &length)
+{
+    if (!range.startsWith(QLatin1String("bytes=")) || range.contains(QLatin1Char(','))) {
+        return false;
+    }
+
+    const QStringRef spec = range.midRef(6);
+    const int dash = spec.indexOf(QLatin1Char('-'));
+    if (dash == -1) {
+        return false;
+    }
+
+    bool ok;
+    const QStringRef firstPart = spec.left(dash).trimmed();
+    const QStringRef lastPart = spec.mid(dash + 1).trimmed();
+    if (firstPart.isEmpty()) {
+        // Suffix range, the last N bytes
+        const qint64 suffix = lastPart.toLongLong(&ok);
+        if (!ok || suffix <= 0 || size <= 0) {
+            return false;
+        }
+        start = qMax<qint64>(0, size - suffix);
+        length = size - start;
+        return true;
+    }
+
+    const qint64 first = firstPart.toLongLong(&ok);
+    if (!ok || first < 0 || first >= size) {
+        return false;
+    }
+
+    qint64 last = size - 1;
+    if (!lastPart.isEmpty()) {
+        last = lastPart.toLongLong(&ok);
+        if (!ok || last < first) {
+            return false;
+        }
+        last = qMin(last, size - 1);
+    }
+
+    start = first;
+    length = last - first + 1;
+    return true;
+}
+
+void EngineRequest::finalizeRange()
+{
+    Response *response = context->response();
+    QIODevice *device = response->bodyDevice();
+    if (!device || device->isSequential() || response->status() != Response::OK) {
+        return;
+    }
+
+    Headers &responseHeaders = response->headers();
+    if (responseHeaders.header(Headers::AcceptRanges).isEmpty()) {
+        responseHeaders.setHeader(Headers::AcceptRanges, QStringLiteral("bytes"));
+    }
+
+    // RFC 9110 14.2 Range is only defined for GET (and HEAD)
+    if (method != QLatin1String("GET") && method != QLatin1String("HEAD")) {
+        return;
+    }
+
+    const QString range = headers.header(Headers::Range);
+    if (range.isEmpty()) {
+        return;
+    }
+
+    if (!responseHeaders.header(Headers::ContentRange).isEmpty()) {
+        return;
+    }
+
+    // Only honour the range if the client still has the same representation,
+    // entity tags must match using the strong comparison
+    const QString ifRange = headers.header(Headers::IfRange);
+    if (!ifRange.isEmpty()) {
+        if (ifRange.startsWith(QLatin1Char('"'))) {
+            if (ifRange != responseHeaders.header(Headers::Etag)) {
+                return;
+            }
+        } else if (ifRange.startsWith(QLatin1String("W/")) ||
+                   ifRange != responseHeaders.header(Headers::LastModified)) {
+            return;
+        }
+    }
+
+    // Ranges that can't be satisfied are ignored and the whole body is sent
+    const qint64 size = device->size();
+    qint64 start;
+    qint64 length;
+    if (!parseByteRange(range, size, start, length)) {
+        return;
+    }
+
+    bodyOffset = start;
+    bodyLength = length;
+
+    response->setStatus(Response::PartialContent);
+    responseHeaders.setHeader(Headers::ContentRange,
+                              QLatin1String("bytes ") + QString::number(start) + QLatin1Char('-') +
+                              QString::number(start + length - 1) + QLatin1Char('/') + QString::number(size));
+    responseHeaders.setContentLength(length);
+}
+
 bool EngineRequest::finalizeHeaders()
 {
     Response *response = context->response();
@@ -124,6 +248,8 @@ bool EngineRequest::finalizeHeaders()
         }
     }
 
+    finalizeRange();
+
     finalizeCookies();
 
     // Done
@@ -136,24 +262,41 @@ qint64 EngineRequest::write(const char *data, qint64 len)
     if (!(status & EngineRequest::Chunked)) {
         return doWrite(data, len);
     } else if (!(status & EngineRequest::ChunkedDone)) {
-        const QByteArray chunkSize = QByteArray::number(len, 16).toUpper();
-        QByteArray chunk;
-        chunk.reserve(int(len + chunkSize.size() + 4));
-        chunk.append(chunkSize).append("\r\n", 2)
-                .append(data, int(len)).append("\r\n", 2);
-
-        qint64 retWrite = doWrite(chunk.data(), chunk.size());
+        // Upper case hex size followed by CRLF, built backwards
+        char chunkSize[20];
+        int pos = sizeof(chunkSize);
+        chunkSize[--pos] = '\n';
+        chunkSize[--pos] = '\r';
+        quint64 value = quint64(len);
+        do {
+            chunkSize[--pos] = "0123456789ABCDEF"[value & 0xF];
+            value >>= 4;
+        } while (value);
+        const qint64 chunkSizeLen = qint64(sizeof(chunkSize)) - pos;
+
+        qint64 retWrite = doWriteFramed(chunkSize + pos, chunkSizeLen, data, len, "\r\n", 2);
 
         // Flag if we wrote an empty chunk
         if (!len) {
             status |= EngineRequest::ChunkedDone;
         }
 
-        return retWrite == chunk.size() ? len : -1;
+        return retWrite == chunkSizeLen + len + 2 ? len : -1;
     }
     return -1;
 }
 
+qint64 EngineRequest::doWriteFramed(const char *header, qint64 headerLen, const char *data, qint64 len, const char *footer, qint64 footerLen)
+{
+    QByteArray buffer;
+    buffer.reserve(int(headerLen + len + footerLen));
+    buffer.append(header, int(headerLen))
+            .append(data, int(len))
+            .append(footer, int(footerLen));
+
+    return doWrite(buffer.constData(), buffer.size());
+}
+
 bool EngineRequest::webSocketHandshake(const QString &key, const QString &origin, const QString &protocol)
 {
     if (status & EngineRequest::FinalizedHeaders) {
@@ -197,6 +340,22 @@ void EngineRequest::processingFinished()
 {
 }
 
+bool EngineRequest::push(const QString &path, const Headers &headers)
+{
+    if (status & EngineRequest::FinalizedHeaders || !path.startsWith(QLatin1Char('/'))) {
+        return false;
+    }
+
+    return pushDo(path, headers);
+}
+
+bool EngineRequest::pushDo(const QString &path, const Headers &headers)
+{
+    Q_UNUSED(path)
+    Q_UNUSED(headers)
+    return false;
+}
+
 bool EngineRequest::webSocketHandshakeDo(const QString &key, const QString &origin, const QString &protocol)
 {
     Q_UNUSED(key)
@@ -31,6 +31,7 @@ class CUTELYST_LIBRARY EngineRequest
 {
     Q_GADGET
     friend class Engine;
+    friend class Context;
 public:
     enum StatusFlag {
         InitialState = 0x00,
@@ -38,6 +39,7 @@ public:
         IOWrite = 0x02,
         Chunked = 0x04,
         ChunkedDone = 0x08,
+        Async = 0x10,
     };
     Q_DECLARE_FLAGS(Status, StatusFlag)
 
@@ -65,6 +67,14 @@ public:
      */
     void finalize();
 
+    /*!
+     * Called by Engines once the request is done to
+     * dispose the Context, when the Application has
+     * context_pool_size set it's reset and kept for the
+     * next request instead of being deleted
+     */
+    void releaseContext();
+
     /*!
      * Reimplement if you need a custom way
      * to Set-Cookie, the default implementation
@@ -79,6 +89,13 @@ public:
      */
     virtual bool finalizeHeaders();
 
+    /*!
+     * Called by finalizeHeaders(), when the request has a single satisfiable
+     * Range and the response body is a random access device, it sets the
+     * status to 206 with the matching Content-Range, bodyOffset and bodyLength
+     */
+    void finalizeRange();
+
     /*!
      * Called by Response to manually write data
      */
@@ -94,12 +111,27 @@ public:
 
     virtual bool webSocketClose(quint16 code, const QString &reason);
 
+    /*!
+     * Called by Response to push the resource at the absolute \p path together
+     * with this response, returns false if the headers were already finalized
+     * or the engine can not push on this connection.
+     */
+    bool push(const QString &path, const Headers &headers);
+
 protected:
     /*!
      * Reimplement this to do the RAW writing to the client
      */
     virtual qint64 doWrite(const char *data, qint64 len) = 0;
 
+    /*!
+     * Writes \p data between \p header and \p footer, used for chunked framing.
+     * The default implementation copies them into a single doWrite() call,
+     * reimplement this if the engine can do scatter/gather writes.
+     * Returns the total number of bytes written or -1
+     */
+    virtual qint64 doWriteFramed(const char *header, qint64 headerLen, const char *data, qint64 len, const char *footer, qint64 footerLen);
+
     /*!
      * This is called when the Application chain is finished
      * processing this request, here the request can send final
@@ -119,6 +151,12 @@ protected:
 
     virtual bool webSocketHandshakeDo(const QString &key, const QString &origin, const QString &protocol);
 
+    /*!
+     * Reimplement this to promise \p path to the client and process it as
+     * a new request with \p headers, the default implementation returns false.
+     */
+    virtual bool pushDo(const QString &path, const Headers &headers);
+
 public:
     /*!
      * This method sets the path and already does the decoding so that it is
@@ -168,6 +206,12 @@ public:
      * \note It's deleted on processingFinished() or destructor */
     QIODevice *body = nullptr;
 
+    /*! Where finalizeBody() starts writing the response body device from */
+    qint64 bodyOffset = 0;
+
+    /*! How many bytes of the response body device finalizeBody() writes, -1 up to the end */
+    qint64 bodyLength = -1;
+
     /*! The Cutelyst::Context of this request
      * \note It's deleted on processingFinished() or destructor */
     Context *context = nullptr;
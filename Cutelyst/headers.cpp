@@ -22,36 +22,107 @@
 #include "engine.h"
 
 #include <QStringList>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 using namespace Cutelyst;
 
 inline QString normalizeHeaderKey(const QString &field);
 inline QByteArray decodeBasicAuth(const QString &auth);
 inline std::pair<QString, QString> decodeBasicAuthPair(const QString &auth);
+inline int knownHeaderFromKey(const QString &key);
+
+namespace {
+struct KnownHeaderName {
+    const char *name;
+    int size;
+};
+
+// Must be kept sorted and in sync with Headers::KnownHeader
+const KnownHeaderName knownHeaderNames[Headers::KnownHeaderCount] = {
+    { "ACCEPT", 6 },
+    { "ACCEPT_CHARSET", 14 },
+    { "ACCEPT_ENCODING", 15 },
+    { "ACCEPT_LANGUAGE", 15 },
+    { "ACCEPT_RANGES", 13 },
+    { "ACCESS_CONTROL_ALLOW_ORIGIN", 27 },
+    { "AGE", 3 },
+    { "ALLOW", 5 },
+    { "AUTHORIZATION", 13 },
+    { "CACHE_CONTROL", 13 },
+    { "CONNECTION", 10 },
+    { "CONTENT_DISPOSITION", 19 },
+    { "CONTENT_ENCODING", 16 },
+    { "CONTENT_LANGUAGE", 16 },
+    { "CONTENT_LENGTH", 14 },
+    { "CONTENT_LOCATION", 16 },
+    { "CONTENT_RANGE", 13 },
+    { "CONTENT_TYPE", 12 },
+    { "COOKIE", 6 },
+    { "DATE", 4 },
+    { "ETAG", 4 },
+    { "EXPECT", 6 },
+    { "EXPIRES", 7 },
+    { "HOST", 4 },
+    { "IF_MATCH", 8 },
+    { "IF_MODIFIED_SINCE", 17 },
+    { "IF_NONE_MATCH", 13 },
+    { "IF_RANGE", 8 },
+    { "IF_UNMODIFIED_SINCE", 19 },
+    { "LAST_MODIFIED", 13 },
+    { "LINK", 4 },
+    { "LOCATION", 8 },
+    { "ORIGIN", 6 },
+    { "PRAGMA", 6 },
+    { "PROXY_AUTHENTICATE", 18 },
+    { "PROXY_AUTHORIZATION", 19 },
+    { "RANGE", 5 },
+    { "REFERER", 7 },
+    { "SERVER", 6 },
+    { "SET_COOKIE", 10 },
+    { "STRICT_TRANSPORT_SECURITY", 25 },
+    { "TRANSFER_ENCODING", 17 },
+    { "UPGRADE", 7 },
+    { "USER_AGENT", 10 },
+    { "VARY", 4 },
+    { "VIA", 3 },
+    { "WWW_AUTHENTICATE", 16 },
+    { "X_FORWARDED_FOR", 15 },
+    { "X_REQUESTED_WITH", 16 },
+};
+}
 
 Headers::Headers()
 {
+    std::fill_n(m_known, int(KnownHeaderCount), -1);
+}
 
+Headers::Headers(const Headers &other) : m_entries(other.m_entries)
+{
+    std::copy_n(other.m_known, int(KnownHeaderCount), m_known);
 }
 
-Headers::Headers(const Headers &other)
+Headers &Headers::operator=(const Headers &other)
 {
-    m_data = other.m_data;
+    m_entries = other.m_entries;
+    std::copy_n(other.m_known, int(KnownHeaderCount), m_known);
+    return *this;
 }
 
 QString Headers::contentDisposition() const
 {
-    return m_data.value(QStringLiteral("CONTENT_DISPOSITION"));
+    return header(Headers::ContentDisposition);
 }
 
 void Headers::setCacheControl(const QString &value)
 {
-    m_data.insert(QStringLiteral("CACHE_CONTROL"), value);
+    setHeader(Headers::CacheControl, value);
 }
 
 void Headers::setContentDisposition(const QString &contentDisposition)
 {
-    m_data.insert(QStringLiteral("CONTENT_DISPOSITION"), contentDisposition);
+    setHeader(Headers::ContentDisposition, contentDisposition);
 }
 
 void Headers::setContentDispositionAttachment(const QString &filename)
@@ -65,20 +136,20 @@ void Headers::setContentDispositionAttachment(const QString &filename)
 
 QString Headers::contentEncoding() const
 {
-    return m_data.value(QStringLiteral("CONTENT_ENCODING"));
+    return header(Headers::ContentEncoding);
 }
 
 void Headers::setContentEncoding(const QString &encoding)
 {
-    m_data.insert(QStringLiteral("CONTENT_ENCODING"), encoding);
+    setHeader(Headers::ContentEncoding, encoding);
 }
 
 QString Headers::contentType() const
 {
     QString ret;
-    const auto it = m_data.constFind(QStringLiteral("CONTENT_TYPE"));
-    if (it != m_data.constEnd()) {
-        const QString &ct = it.value();
+    const int ix = m_known[Headers::ContentType];
+    if (ix != -1) {
+        const QString &ct = m_entries.at(ix).value;
         ret = ct.mid(0, ct.indexOf(QLatin1Char(';'))).toLower();
     }
     return ret;
@@ -86,15 +157,15 @@ QString Headers::contentType() const
 
 void Headers::setContentType(const QString &contentType)
 {
-    m_data.insert(QStringLiteral("CONTENT_TYPE"), contentType);
+    setHeader(Headers::ContentType, contentType);
 }
 
 QString Headers::contentTypeCharset() const
 {
     QString ret;
-    const auto it = m_data.constFind(QStringLiteral("CONTENT_TYPE"));
-    if (it != m_data.constEnd()) {
-        const QString &contentType = it.value();
+    const int ix = m_known[Headers::ContentType];
+    if (ix != -1) {
+        const QString &contentType = m_entries.at(ix).value;
         int pos = contentType.indexOf(QLatin1String("charset="), 0, Qt::CaseInsensitive);
         if (pos != -1) {
             int endPos = contentType.indexOf(QLatin1Char(';'), pos);
@@ -107,13 +178,13 @@ QString Headers::contentTypeCharset() const
 
 void Headers::setContentTypeCharset(const QString &charset)
 {
-    const auto it = m_data.constFind(QStringLiteral("CONTENT_TYPE"));
-    if (it == m_data.constEnd() || (it.value().isEmpty() && !charset.isEmpty())) {
-        m_data.insert(QStringLiteral("CONTENT_TYPE"), QLatin1String("charset=") + charset);
+    const int ix = m_known[Headers::ContentType];
+    if (ix == -1 || (m_entries.at(ix).value.isEmpty() && !charset.isEmpty())) {
+        setHeader(Headers::ContentType, QLatin1String("charset=") + charset);
         return;
     }
 
-    QString contentType = it.value();
+    QString contentType = m_entries.at(ix).value;
     int pos = contentType.indexOf(QLatin1String("charset="), 0, Qt::CaseInsensitive);
     if (pos != -1) {
         int endPos = contentType.indexOf(QLatin1Char(';'), pos);
@@ -121,7 +192,7 @@ void Headers::setContentTypeCharset(const QString &charset)
             if (charset.isEmpty()) {
                 int lastPos = contentType.lastIndexOf(QLatin1Char(';'), pos);
                 if (lastPos == -1) {
-                    m_data.remove(QStringLiteral("CONTENT_TYPE"));
+                    remove(knownHeaderKey(Headers::ContentType));
                     return;
                 } else {
                     contentType.remove(lastPos, contentType.length() - lastPos);
@@ -135,12 +206,12 @@ void Headers::setContentTypeCharset(const QString &charset)
     } else if (!charset.isEmpty()) {
         contentType.append(QLatin1String("; charset=") + charset);
     }
-    m_data.insert(QStringLiteral("CONTENT_TYPE"), contentType);
+    setHeader(Headers::ContentType, contentType);
 }
 
 bool Headers::contentIsText() const
 {
-    return m_data.value(QStringLiteral("CONTENT_TYPE")).startsWith(QLatin1String("text/"));
+    return header(Headers::ContentType).startsWith(QLatin1String("text/"));
 }
 
 bool Headers::contentIsHtml() const
@@ -168,16 +239,16 @@ bool Headers::contentIsXml() const
 
 qint64 Headers::contentLength() const
 {
-    auto it = m_data.constFind(QStringLiteral("CONTENT_LENGTH"));
-    if (it != m_data.constEnd()) {
-        return it.value().toLongLong();
+    const int ix = m_known[Headers::ContentLength];
+    if (ix != -1) {
+        return m_entries.at(ix).value.toLongLong();
     }
     return -1;
 }
 
 void Headers::setContentLength(qint64 value)
 {
-    m_data.insert(QStringLiteral("CONTENT_LENGTH"), QString::number(value));
+    setHeader(Headers::ContentLength, QString::number(value));
 }
 
 QString Headers::setDateWithDateTime(const QDateTime &date)
@@ -186,16 +257,16 @@ QString Headers::setDateWithDateTime(const QDateTime &date)
     // and follow RFC 822
     const QString dt = QLocale::c().toString(date.toUTC(),
                                              QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT"));
-    m_data.insert(QStringLiteral("DATE"), dt);
+    setHeader(Headers::Date, dt);
     return dt;
 }
 
 QDateTime Headers::date() const
 {
     QDateTime ret;
-    auto it = m_data.constFind(QStringLiteral("DATE"));
-    if (it != m_data.constEnd()) {
-        const QString &date = it.value();
+    const int ix = m_known[Headers::Date];
+    if (ix != -1) {
+        const QString &date = m_entries.at(ix).value;
 
         if (date.endsWith(QLatin1String(" GMT"))) {
             ret = QLocale::c().toDateTime(date.left(date.size() - 4),
@@ -212,15 +283,15 @@ QDateTime Headers::date() const
 
 QString Headers::ifModifiedSince() const
 {
-    return m_data.value(QStringLiteral("IF_MODIFIED_SINCE"));
+    return header(Headers::IfModifiedSince);
 }
 
 QDateTime Headers::ifModifiedSinceDateTime() const
 {
     QDateTime ret;
-    auto it = m_data.constFind(QStringLiteral("IF_MODIFIED_SINCE"));
-    if (it != m_data.constEnd()) {
-        const QString &ifModifiedStr = it.value();
+    const int ix = m_known[Headers::IfModifiedSince];
+    if (ix != -1) {
+        const QString &ifModifiedStr = m_entries.at(ix).value;
 
         if (ifModifiedStr.endsWith(QLatin1String(" GMT"))) {
             ret = QLocale::c().toDateTime(ifModifiedStr.left(ifModifiedStr.size() - 4),
@@ -237,9 +308,9 @@ QDateTime Headers::ifModifiedSinceDateTime() const
 
 bool Headers::ifModifiedSince(const QDateTime &lastModified) const
 {
-    auto it = m_data.constFind(QStringLiteral("IF_MODIFIED_SINCE"));
-    if (it != m_data.constEnd()) {
-        return it.value() != QLocale::c().toString(lastModified.toUTC(),
+    const int ix = m_known[Headers::IfModifiedSince];
+    if (ix != -1) {
+        return m_entries.at(ix).value != QLocale::c().toString(lastModified.toUTC(),
                                                    QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT"));
     }
     return true;
@@ -247,12 +318,12 @@ bool Headers::ifModifiedSince(const QDateTime &lastModified) const
 
 QString Headers::lastModified() const
 {
-    return m_data.value(QStringLiteral("LAST_MODIFIED"));
+    return header(Headers::LastModified);
 }
 
 void Headers::setLastModified(const QString &value)
 {
-    m_data.insert(QStringLiteral("LAST_MODIFIED"), value);
+    setHeader(Headers::LastModified, value);
 }
 
 QString Headers::setLastModified(const QDateTime &lastModified)
@@ -267,32 +338,32 @@ QString Headers::setLastModified(const QDateTime &lastModified)
 
 QString Headers::server() const
 {
-    return m_data.value(QStringLiteral("SERVER"));
+    return header(Headers::Server);
 }
 
 void Headers::setServer(const QString &value)
 {
-    m_data.insert(QStringLiteral("SERVER"), value);
+    setHeader(Headers::Server, value);
 }
 
 QString Headers::connection() const
 {
-    return m_data.value(QStringLiteral("CONNECTION"));
+    return header(Headers::Connection);
 }
 
 QString Headers::host() const
 {
-    return m_data.value(QStringLiteral("HOST"));
+    return header(Headers::Host);
 }
 
 QString Headers::userAgent() const
 {
-    return m_data.value(QStringLiteral("USER_AGENT"));
+    return header(Headers::UserAgent);
 }
 
 QString Headers::referer() const
 {
-    return m_data.value(QStringLiteral("REFERER"));
+    return header(Headers::Referer);
 }
 
 void Headers::setReferer(const QString &uri)
@@ -300,25 +371,25 @@ void Headers::setReferer(const QString &uri)
     int fragmentPos = uri.indexOf(QLatin1Char('#'));
     if (fragmentPos != -1) {
         // Strip fragment per RFC 2616, section 14.36.
-        m_data.insert(QStringLiteral("REFERER"), uri.mid(0, fragmentPos));
+        setHeader(Headers::Referer, uri.mid(0, fragmentPos));
     } else {
-        m_data.insert(QStringLiteral("REFERER"), uri);
+        setHeader(Headers::Referer, uri);
     }
 }
 
 void Headers::setWwwAuthenticate(const QString &value)
 {
-    m_data.insert(QStringLiteral("WWW_AUTHENTICATE"), value);
+    setHeader(Headers::WwwAuthenticate, value);
 }
 
 void Headers::setProxyAuthenticate(const QString &value)
 {
-    m_data.insert(QStringLiteral("PROXY_AUTHENTICATE"), value);
+    setHeader(Headers::ProxyAuthenticate, value);
 }
 
 QString Headers::authorization() const
 {
-    return m_data.value(QStringLiteral("AUTHORIZATION"));
+    return header(Headers::Authorization);
 }
 
 QString Headers::authorizationBasic() const
@@ -341,13 +412,13 @@ QString Headers::setAuthorizationBasic(const QString &username, const QString &p
 
     const QString result = username + QLatin1Char(':') + password;
     ret = QStringLiteral("Basic ") + QString::fromLatin1(result.toLatin1().toBase64());
-    m_data.insert(QStringLiteral("AUTHORIZATION"), ret);
+    setHeader(Headers::Authorization, ret);
     return ret;
 }
 
 QString Headers::proxyAuthorization() const
 {
-    return m_data.value(QStringLiteral("PROXY_AUTHORIZATION"));
+    return header(Headers::ProxyAuthorization);
 }
 
 QString Headers::proxyAuthorizationBasic() const
@@ -362,17 +433,19 @@ std::pair<QString, QString> Headers::proxyAuthorizationBasicPair() const
 
 QString Headers::header(const QString &field) const
 {
-    return m_data.value(normalizeHeaderKey(field));
+    const int ix = indexOf(normalizeHeaderKey(field));
+    return ix != -1 ? m_entries.at(ix).value : QString();
 }
 
 QString Headers::header(const QString &field, const QString &defaultValue) const
 {
-    return m_data.value(normalizeHeaderKey(field), defaultValue);
+    const int ix = indexOf(normalizeHeaderKey(field));
+    return ix != -1 ? m_entries.at(ix).value : defaultValue;
 }
 
 void Headers::setHeader(const QString &field, const QString &value)
 {
-    m_data.insert(normalizeHeaderKey(field), value);
+    insert(normalizeHeaderKey(field), value);
 }
 
 void Headers::setHeader(const QString &field, const QStringList &values)
@@ -382,32 +455,268 @@ void Headers::setHeader(const QString &field, const QStringList &values)
 
 void Headers::pushHeader(const QString &field, const QString &value)
 {
-    m_data.insertMulti(normalizeHeaderKey(field), value);
+    pushRawHeader(normalizeHeaderKey(field), value);
 }
 
 void Headers::pushHeader(const QString &field, const QStringList &values)
 {
-    m_data.insertMulti(normalizeHeaderKey(field), values.join(QStringLiteral(", ")));
+    pushRawHeader(normalizeHeaderKey(field), values.join(QStringLiteral(", ")));
+}
+
+void Headers::pushRawHeader(const QString &field, const QString &value)
+{
+    const int known = knownHeaderFromKey(field);
+    if (known != -1) {
+        pushRawHeader(KnownHeader(known), value);
+    } else {
+        m_entries.append({ field, value });
+    }
+}
+
+void Headers::pushRawHeader(KnownHeader field, const QString &value)
+{
+    m_known[field] = m_entries.size();
+    m_entries.append({ knownHeaderKey(field), value });
+}
+
+QString Headers::header(KnownHeader field) const
+{
+    const int ix = m_known[field];
+    return ix != -1 ? m_entries.at(ix).value : QString();
+}
+
+void Headers::setHeader(KnownHeader field, const QString &value)
+{
+    const int ix = m_known[field];
+    if (ix != -1) {
+        m_entries[ix].value = value;
+    } else {
+        pushRawHeader(field, value);
+    }
+}
+
+int Headers::knownHeader(const char *field, int size)
+{
+    int low = 0;
+    int high = KnownHeaderCount - 1;
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        const KnownHeaderName &known = knownHeaderNames[mid];
+
+        int cmp = 0;
+        const int len = qMin(size, known.size);
+        for (int i = 0; i < len && cmp == 0; ++i) {
+            char c = field[i];
+            if (c >= 'a' && c <= 'z') {
+                c -= 0x20;
+            } else if (c == '-') {
+                c = '_';
+            }
+            cmp = uchar(c) - uchar(known.name[i]);
+        }
+        if (cmp == 0) {
+            cmp = size - known.size;
+        }
+
+        if (cmp == 0) {
+            return mid;
+        } else if (cmp < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return -1;
+}
+
+QString Headers::knownHeaderKey(KnownHeader field)
+{
+    static const QString keys[KnownHeaderCount] = {
+        QStringLiteral("ACCEPT"),
+        QStringLiteral("ACCEPT_CHARSET"),
+        QStringLiteral("ACCEPT_ENCODING"),
+        QStringLiteral("ACCEPT_LANGUAGE"),
+        QStringLiteral("ACCEPT_RANGES"),
+        QStringLiteral("ACCESS_CONTROL_ALLOW_ORIGIN"),
+        QStringLiteral("AGE"),
+        QStringLiteral("ALLOW"),
+        QStringLiteral("AUTHORIZATION"),
+        QStringLiteral("CACHE_CONTROL"),
+        QStringLiteral("CONNECTION"),
+        QStringLiteral("CONTENT_DISPOSITION"),
+        QStringLiteral("CONTENT_ENCODING"),
+        QStringLiteral("CONTENT_LANGUAGE"),
+        QStringLiteral("CONTENT_LENGTH"),
+        QStringLiteral("CONTENT_LOCATION"),
+        QStringLiteral("CONTENT_RANGE"),
+        QStringLiteral("CONTENT_TYPE"),
+        QStringLiteral("COOKIE"),
+        QStringLiteral("DATE"),
+        QStringLiteral("ETAG"),
+        QStringLiteral("EXPECT"),
+        QStringLiteral("EXPIRES"),
+        QStringLiteral("HOST"),
+        QStringLiteral("IF_MATCH"),
+        QStringLiteral("IF_MODIFIED_SINCE"),
+        QStringLiteral("IF_NONE_MATCH"),
+        QStringLiteral("IF_RANGE"),
+        QStringLiteral("IF_UNMODIFIED_SINCE"),
+        QStringLiteral("LAST_MODIFIED"),
+        QStringLiteral("LINK"),
+        QStringLiteral("LOCATION"),
+        QStringLiteral("ORIGIN"),
+        QStringLiteral("PRAGMA"),
+        QStringLiteral("PROXY_AUTHENTICATE"),
+        QStringLiteral("PROXY_AUTHORIZATION"),
+        QStringLiteral("RANGE"),
+        QStringLiteral("REFERER"),
+        QStringLiteral("SERVER"),
+        QStringLiteral("SET_COOKIE"),
+        QStringLiteral("STRICT_TRANSPORT_SECURITY"),
+        QStringLiteral("TRANSFER_ENCODING"),
+        QStringLiteral("UPGRADE"),
+        QStringLiteral("USER_AGENT"),
+        QStringLiteral("VARY"),
+        QStringLiteral("VIA"),
+        QStringLiteral("WWW_AUTHENTICATE"),
+        QStringLiteral("X_FORWARDED_FOR"),
+        QStringLiteral("X_REQUESTED_WITH"),
+    };
+    return keys[field];
 }
 
 void Headers::removeHeader(const QString &field)
 {
-    m_data.remove(normalizeHeaderKey(field));
+    remove(normalizeHeaderKey(field));
+}
+
+void Headers::clear()
+{
+    m_entries.clear();
+    std::fill_n(m_known, int(KnownHeaderCount), -1);
+}
+
+QHash<QString, QString> Headers::data() const
+{
+    QHash<QString, QString> ret;
+    ret.reserve(m_entries.size());
+    for (const HeaderKeyValue &entry : m_entries) {
+        ret.insertMulti(entry.key, entry.value);
+    }
+    return ret;
 }
 
 bool Headers::contains(const QString &field)
 {
-    return m_data.contains(normalizeHeaderKey(field));
+    return indexOf(normalizeHeaderKey(field)) != -1;
 }
 
 QString &Headers::operator[](const QString &key)
 {
-    return m_data[key];
+    int ix = indexOf(key);
+    if (ix == -1) {
+        ix = m_entries.size();
+        pushRawHeader(key, QString());
+    }
+    return m_entries[ix].value;
 }
 
 const QString Headers::operator[](const QString &key) const
 {
-    return m_data[key];
+    const int ix = indexOf(key);
+    return ix != -1 ? m_entries.at(ix).value : QString();
+}
+
+bool Headers::operator==(const Headers &other) const
+{
+    const int size = m_entries.size();
+    if (size != other.m_entries.size()) {
+        return false;
+    }
+
+    // Same fields and values regardless of the order they were added,
+    // each entry of other can only match once
+    QVarLengthArray<bool, 64> matched(size);
+    std::fill_n(matched.data(), size, false);
+    for (const HeaderKeyValue &entry : m_entries) {
+        int i = 0;
+        while (i < size && (matched[i] || !(other.m_entries.at(i) == entry))) {
+            ++i;
+        }
+        if (i == size) {
+            return false;
+        }
+        matched[i] = true;
+    }
+    return true;
+}
+
+int Headers::indexOf(const QString &key) const
+{
+    const int known = knownHeaderFromKey(key);
+    if (known != -1) {
+        return m_known[known];
+    }
+
+    // Like QHash::insertMulti the most recent value wins
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        if (m_entries.at(i).key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Headers::insert(const QString &key, const QString &value)
+{
+    const int ix = indexOf(key);
+    if (ix != -1) {
+        m_entries[ix].value = value;
+    } else {
+        pushRawHeader(key, value);
+    }
+}
+
+void Headers::remove(const QString &key)
+{
+    auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&key] (const HeaderKeyValue &entry) {
+        return entry.key == key;
+    });
+    if (it != m_entries.end()) {
+        m_entries.erase(it, m_entries.end());
+        rebuildKnown();
+    }
+}
+
+void Headers::rebuildKnown()
+{
+    std::fill_n(m_known, int(KnownHeaderCount), -1);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const int known = knownHeaderFromKey(m_entries.at(i).key);
+        if (known != -1) {
+            m_known[known] = i;
+        }
+    }
+}
+
+int knownHeaderFromKey(const QString &key)
+{
+    // Keys here are already normalized, so only an exact match is accepted
+    const int size = key.size();
+    if (size > 32) {
+        return -1;
+    }
+
+    char latin1[32];
+    const QChar *data = key.constData();
+    for (int i = 0; i < size; ++i) {
+        const ushort c = data[i].unicode();
+        if (c > 0x7f || (c >= 'a' && c <= 'z') || c == '-') {
+            return -1;
+        }
+        latin1[i] = char(c);
+    }
+    return Headers::knownHeader(latin1, size);
 }
 
 QString normalizeHeaderKey(const QString &field)
@@ -458,12 +767,11 @@ std::pair<QString, QString> decodeBasicAuthPair(const QString &auth)
 
 QDebug operator<<(QDebug debug, const Headers &headers)
 {
-    const QHash<QString, QString> data = headers.data();
+    const Headers::HeaderKeyValueList &entries = headers.entries();
     const bool oldSetting = debug.autoInsertSpaces();
     debug.nospace() << "Headers(";
-    for (auto it = data.constBegin();
-         it != data.constEnd(); ++it) {
-        debug << '(' << Engine::camelCaseHeader(it.key()) + QLatin1Char('=') + it.value() << ')';
+    for (const Headers::HeaderKeyValue &entry : entries) {
+        debug << '(' << Engine::camelCaseHeader(entry.key) + QLatin1Char('=') + entry.value << ')';
     }
     debug << ')';
     debug.setAutoInsertSpaces(oldSetting);
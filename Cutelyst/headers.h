@@ -21,6 +21,7 @@
 #include <QtCore/QVariant>
 #include <QtCore/QDateTime>
 #include <QtCore/QMetaType>
+#include <QtCore/QVector>
 
 #include <Cutelyst/cutelyst_global.h>
 
@@ -29,6 +30,77 @@ namespace Cutelyst {
 class CUTELYST_LIBRARY Headers
 {
 public:
+    /**
+     * Well known header fields, these are stored in fixed slots
+     * so that looking them up doesn't require hashing the field name.
+     * The order matches the CGI like key sorting.
+     */
+    enum KnownHeader {
+        Accept,
+        AcceptCharset,
+        AcceptEncoding,
+        AcceptLanguage,
+        AcceptRanges,
+        AccessControlAllowOrigin,
+        Age,
+        Allow,
+        Authorization,
+        CacheControl,
+        Connection,
+        ContentDisposition,
+        ContentEncoding,
+        ContentLanguage,
+        ContentLength,
+        ContentLocation,
+        ContentRange,
+        ContentType,
+        Cookie,
+        Date,
+        Etag,
+        Expect,
+        Expires,
+        Host,
+        IfMatch,
+        IfModifiedSince,
+        IfNoneMatch,
+        IfRange,
+        IfUnmodifiedSince,
+        LastModified,
+        Link,
+        Location,
+        Origin,
+        Pragma,
+        ProxyAuthenticate,
+        ProxyAuthorization,
+        Range,
+        Referer,
+        Server,
+        SetCookie,
+        StrictTransportSecurity,
+        TransferEncoding,
+        Upgrade,
+        UserAgent,
+        Vary,
+        Via,
+        WwwAuthenticate,
+        XForwardedFor,
+        XRequestedWith,
+        KnownHeaderCount
+    };
+
+    /**
+     * A header field in it's CGI like form and it's value.
+     */
+    struct HeaderKeyValue {
+        QString key;
+        QString value;
+
+        inline bool operator==(const HeaderKeyValue &other) const {
+            return key == other.key && value == other.value;
+        }
+    };
+    typedef QVector<HeaderKeyValue> HeaderKeyValueList;
+
     /**
      * Construct an empty header object.
      */
@@ -43,7 +115,7 @@ public:
     /**
      * Construct a header from a std::initializer_list given by list.
      */
-    inline Headers(std::initializer_list<std::pair<QString,QString> > list)
+    inline Headers(std::initializer_list<std::pair<QString,QString> > list) : Headers()
     {
         for (std::initializer_list<std::pair<QString,QString> >::const_iterator it = list.begin(); it != list.end(); ++it)
             pushHeader(it->first, it->second);
@@ -322,7 +394,35 @@ public:
      * this method should be used only by Engines to get faster performance
      * and avoiding normalization.
      */
-    inline void pushRawHeader(const QString &field, const QString &value);
+    void pushRawHeader(const QString &field, const QString &value);
+
+    /**
+     * Appends the well known header \p field to values without any
+     * key lookup, this method should be used only by Engines.
+     */
+    void pushRawHeader(KnownHeader field, const QString &value);
+
+    /**
+     * Returns the value associated with the well known header \p field
+     */
+    QString header(KnownHeader field) const;
+
+    /**
+     * Sets the well known header \p field to value
+     */
+    void setHeader(KnownHeader field, const QString &value);
+
+    /**
+     * Returns the well known header matching the first \p size bytes of \p field,
+     * the comparison is case insensitive and '-' matches '_', so 'content-type',
+     * 'Content-Type' and 'CONTENT_TYPE' are all found, or -1 if it's not a known header.
+     */
+    static int knownHeader(const char *field, int size);
+
+    /**
+     * Returns the CGI like key of the well known header \p field.
+     */
+    static QString knownHeaderKey(KnownHeader field);
 
     /**
      * This method appends a header to internal data normalizing the key.
@@ -337,15 +437,20 @@ public:
     /**
      * Clears all headers.
      */
-    inline void clear() {
-        m_data.clear();
-    }
+    void clear();
 
     /**
-     * Returns the internal structure of headers, to be used by Engine subclasses.
+     * Returns the headers as a hash, when a field has multiple values
+     * they are all inserted.
      */
-    inline QHash<QString, QString> data() const {
-        return m_data;
+    QHash<QString, QString> data() const;
+
+    /**
+     * Returns the internal structure of headers in the order they
+     * were added, to be used by Engine subclasses.
+     */
+    inline const HeaderKeyValueList &entries() const {
+        return m_entries;
     }
 
     /**
@@ -366,41 +471,38 @@ public:
     /**
      * Assigns \p other to this Header and returns a reference to this Header.
      */
-    inline Headers &operator=(const Headers &other)
-    {
-        m_data = other.m_data;
-        return *this;
-    }
+    Headers &operator=(const Headers &other);
 
     /**
      * Compares if another Header object has the same data as this.
      */
-    inline bool operator==(const Headers &other) const {
-        return m_data == other.m_data;
-    }
+    bool operator==(const Headers &other) const;
 
     /**
      * Compares if another Header object does not have the same data as this.
      */
     inline bool operator!=(const Headers &other) const {
-        return m_data != other.m_data;
+        return !(*this == other);
     }
 
     /**
      * Returns this Header internal data as a QVariant for easiness with Q_PROPERTY.
      */
     inline operator QVariant() const {
-        return QVariant::fromValue(m_data);
+        return QVariant::fromValue(data());
     }
 
 private:
-    QHash<QString, QString> m_data;
+    int indexOf(const QString &key) const;
+    void insert(const QString &key, const QString &value);
+    void remove(const QString &key);
+    void rebuildKnown();
+
+    HeaderKeyValueList m_entries;
+    // Index in m_entries of the last value of each well known header or -1
+    int m_known[KnownHeaderCount];
 };
 
-void Headers::pushRawHeader(const QString &field, const QString &value) {
-    m_data.insertMulti(field, value);
-}
-
 }
 
 Q_DECLARE_METATYPE(Cutelyst::Headers)
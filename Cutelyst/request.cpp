@@ -488,7 +488,7 @@ void RequestPrivate::parseBody() const
             engineRequest->body->seek(0);
         }
 
-        const Uploads ups = MultiPartFormDataParser::parse(engineRequest->body, engineRequest->headers.header(QStringLiteral("CONTENT_TYPE")));
+        const Uploads ups = MultiPartFormDataParser::parse(engineRequest->body, engineRequest->headers.header(Headers::ContentType));
         for (Upload *upload : ups) {
             if (upload->filename().isEmpty() && upload->contentType().isEmpty()) {
                 bodyParam.insertMulti(upload->name(), QString::fromUtf8(upload->readAll()));
@@ -582,7 +582,7 @@ static std::pair<QString, QString> nextField(const QString &text, int &position)
 
 void RequestPrivate::parseCookies() const
 {
-    const QString cookieString = engineRequest->headers.header(QStringLiteral("COOKIE"));
+    const QString cookieString = engineRequest->headers.header(Headers::Cookie);
     int position = 0;
     const int length = cookieString.length();
     while (position < length) {
@@ -515,6 +515,7 @@ protected:
 
 private:
     friend class Application;
+    friend class ApplicationPrivate;
     friend class Dispatcher;
     friend class DispatchType;
     friend class Context;
@@ -52,12 +52,12 @@ qint64 Response::writeData(const char *data, qint64 len)
 
     // Finalize headers if someone manually writes output
     if (!(d->engineRequest->status & EngineRequest::FinalizedHeaders)) {
-        if (d->headers.header(QStringLiteral("TRANSFER_ENCODING")) == QLatin1String("chunked")) {
+        if (d->headers.header(Headers::TransferEncoding) == QLatin1String("chunked")) {
             d->engineRequest->status |= EngineRequest::IOWrite | EngineRequest::Chunked;
         } else {
             // When chunked encoding is not set the client can only know
             // that data is finished if we close the connection
-            d->headers.setHeader(QStringLiteral("CONNECTION"), QStringLiteral("close"));
+            d->headers.setHeader(Headers::Connection, QStringLiteral("close"));
             d->engineRequest->status |= EngineRequest::IOWrite;
         }
         delete d->bodyIODevice;
@@ -245,7 +245,7 @@ void Response::redirect(const QUrl &url, quint16 status)
         const QString location = QString::fromLatin1(url.toEncoded(QUrl::FullyEncoded));
         qCDebug(CUTELYST_RESPONSE) << "Redirecting to" << location << status;
 
-        d->headers.setHeader(QStringLiteral("LOCATION"), location);
+        d->headers.setHeader(Headers::Location, location);
         d->headers.setContentType(QStringLiteral("text/html; charset=utf-8"));
 
         const QString buf = QStringLiteral(
@@ -317,6 +317,21 @@ qint64 Response::size() const
     }
 }
 
+bool Response::push(const QString &path, const Headers &headers)
+{
+    Q_D(Response);
+    Q_ASSERT_X(!(d->engineRequest->status & EngineRequest::FinalizedHeaders),
+               "push",
+               "pushing a resource after finalize_headers and the response callback has been called. Not what you want.");
+
+    if (d->engineRequest->push(path, headers)) {
+        return true;
+    }
+
+    d->headers.pushRawHeader(Headers::Link, QLatin1Char('<') + path + QLatin1String(">; rel=preload"));
+    return false;
+}
+
 bool Response::webSocketHandshake(const QString &key, const QString &origin, const QString &protocol)
 {
     Q_D(Response);
@@ -305,6 +305,16 @@ public:
     virtual qint64 size() const override;
 
 
+    /*!
+     * Tells the user-agent it will need the resource at the absolute \p path, like
+     * "/static/app.css", to render this response. On HTTP/2 connections that allow
+     * server push a PUSH_PROMISE is sent and \p path is processed as a new GET request
+     * with \p headers, otherwise a "Link: </static/app.css>; rel=preload" header is added.
+     * This must be called before the headers are finalized.
+     * Returns true if the resource was pushed.
+     */
+    bool push(const QString &path, const Headers &headers = Headers());
+
     /*!
      * Sends the websocket handshake, if no parameters are defined it will use header data.
      * Returns true in case of success, false otherwise, which can be due missing support on
@@ -355,6 +365,7 @@ protected:
 
     ResponsePrivate *d_ptr;
     friend class Application;
+    friend class ApplicationPrivate;
     friend class Engine;
     friend class EngineConnection;
     friend class Context;
@@ -81,6 +81,37 @@ void EventDispatcherEPoll::unregisterSocketNotifier(QSocketNotifier* notifier)
     d->unregisterSocketNotifier(notifier);
 }
 
+bool EventDispatcherEPoll::registerNativeSocket(int fd, quint32 events, EventDispatcherEPollWatcher *watcher)
+{
+#ifndef QT_NO_DEBUG
+    if (fd < 0 || !watcher) {
+        qWarning("%s: invalid arguments", Q_FUNC_INFO);
+        return false;
+    }
+
+    if (thread() != QThread::currentThread()) {
+        qWarning("%s: native sockets cannot be enabled from another thread", Q_FUNC_INFO);
+        return false;
+    }
+#endif
+
+    Q_D(EventDispatcherEPoll);
+    return d->registerNativeSocket(fd, events, watcher);
+}
+
+void EventDispatcherEPoll::unregisterNativeSocket(int fd)
+{
+#ifndef QT_NO_DEBUG
+    if (thread() != QThread::currentThread()) {
+        qWarning("%s: native sockets cannot be disabled from another thread", Q_FUNC_INFO);
+        return;
+    }
+#endif
+
+    Q_D(EventDispatcherEPoll);
+    d->unregisterNativeSocket(fd);
+}
+
 void EventDispatcherEPoll::registerTimer(
         int timerId,
         int interval,
@@ -28,6 +28,18 @@ class EventDispatcherEPollPrivate;
 #  define CUTELYST_EVENTLOOP_EPOLL_EXPORT Q_DECL_IMPORT
 #endif
 
+/**
+ * Receives the raw epoll events of a descriptor registered
+ * with EventDispatcherEPoll::registerNativeSocket()
+ */
+class CUTELYST_EVENTLOOP_EPOLL_EXPORT EventDispatcherEPollWatcher
+{
+public:
+    virtual ~EventDispatcherEPollWatcher() {}
+
+    virtual void epollEvent(quint32 events) = 0;
+};
+
 class CUTELYST_EVENTLOOP_EPOLL_EXPORT EventDispatcherEPoll : public QAbstractEventDispatcher {
     Q_OBJECT
 public:
@@ -40,6 +52,15 @@ public:
     virtual void registerSocketNotifier(QSocketNotifier *notifier) override;
     virtual void unregisterSocketNotifier(QSocketNotifier *notifier) override;
 
+    /**
+     * Watches \p fd for the epoll \p events, which might include EPOLLET,
+     * calling \p watcher directly without QSocketNotifier or QEvent, the
+     * descriptor must not have socket notifiers and must be unregistered
+     * before it's closed. Must be called from the dispatcher's thread.
+     */
+    bool registerNativeSocket(int fd, quint32 events, EventDispatcherEPollWatcher *watcher);
+    void unregisterNativeSocket(int fd);
+
     virtual void registerTimer(
             int timerId,
             int interval,
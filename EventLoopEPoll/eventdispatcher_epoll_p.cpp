@@ -45,6 +45,12 @@ EventDispatcherEPollPrivate::~EventDispatcherEPollPrivate()
         delete it.value();
         ++it;
     }
+
+    auto itNative = m_natives.constBegin();
+    while (itNative != m_natives.constEnd()) {
+        delete itNative.value();
+        ++itNative;
+    }
     delete m_event_fd_info;
 }
 
@@ -193,6 +199,13 @@ void SocketNotifierInfo::process(quint32 events)
     }
 }
 
+void NativeSocketInfo::process(quint32 events)
+{
+    if (Q_LIKELY(watcher)) {
+        watcher->epollEvent(events);
+    }
+}
+
 void EventFdInfo::process(quint32 events)
 {
     if (Q_LIKELY(events & EPOLLIN)) {
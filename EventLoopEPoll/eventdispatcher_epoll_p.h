@@ -64,6 +64,19 @@ public:
     quint32 events;
 };
 
+class EventDispatcherEPollWatcher;
+class NativeSocketInfo : public EpollAbastractEvent
+{
+public:
+    NativeSocketInfo(int _fd, quint32 _events, EventDispatcherEPollWatcher *_watcher)
+        : EpollAbastractEvent(_fd), watcher(_watcher), events(_events) { }
+
+    virtual void process(quint32 events);
+
+    EventDispatcherEPollWatcher *watcher;
+    quint32 events;
+};
+
 class ZeroTimer : public EpollAbastractEvent
 {
 public:
@@ -101,6 +114,8 @@ public:
     bool processEvents(QEventLoop::ProcessEventsFlags flags);
     void registerSocketNotifier(QSocketNotifier *notifier);
     void unregisterSocketNotifier(QSocketNotifier *notifier);
+    bool registerNativeSocket(int fd, quint32 events, EventDispatcherEPollWatcher *watcher);
+    void unregisterNativeSocket(int fd);
     void registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object);
     void registerZeroTimer(int timerId, QObject *object);
     bool unregisterTimer(int timerId);
@@ -123,6 +138,7 @@ private:
     QAtomicInt m_wakeups;
     QHash<int, EpollAbastractEvent*> m_handles;
     QHash<QSocketNotifier*, SocketNotifierInfo*> m_notifiers;
+    QHash<int, NativeSocketInfo*> m_natives;
     QHash<int, TimerInfo*> m_timers;
     QHash<int, ZeroTimer*> m_zero_timers;
 
@@ -173,6 +173,50 @@ void EventDispatcherEPollPrivate::unregisterSocketNotifier(QSocketNotifier *noti
     }
 }
 
+bool EventDispatcherEPollPrivate::registerNativeSocket(int fd, quint32 events, EventDispatcherEPollWatcher *watcher)
+{
+    if (Q_UNLIKELY(m_handles.contains(fd) || m_natives.contains(fd))) {
+        qWarning("%s: descriptor %d is already registered", Q_FUNC_INFO, fd);
+        return false;
+    }
+
+    auto data = new NativeSocketInfo(fd, events, watcher);
+
+    epoll_event e;
+    e.events = events;
+    e.data.ptr = data;
+    int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &e);
+    if (Q_UNLIKELY(res != 0)) {
+        qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        delete data;
+        return false;
+    }
+
+    m_natives.insert(fd, data);
+    return true;
+}
+
+void EventDispatcherEPollPrivate::unregisterNativeSocket(int fd)
+{
+    auto it = m_natives.find(fd);
+    if (Q_LIKELY(it != m_natives.end())) {
+        NativeSocketInfo *info = it.value();
+
+        struct epoll_event e;
+        e.data.ptr = info;
+        int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &e);
+        if (Q_UNLIKELY(res != 0 && EBADF != errno)) {
+            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        }
+
+        m_natives.erase(it);
+
+        // Events already fetched for it in this iteration are dropped
+        info->watcher = nullptr;
+        info->deref();
+    }
+}
+
 bool EventDispatcherEPollPrivate::disableSocketNotifiers(bool disable)
 {
     epoll_event e;
@@ -191,5 +235,19 @@ bool EventDispatcherEPollPrivate::disableSocketNotifiers(bool disable)
         ++it;
     }
 
+    auto itNative = m_natives.constBegin();
+    while (itNative != m_natives.constEnd()) {
+        NativeSocketInfo *info  = itNative.value();
+
+        e.events = disable ? 0 : info->events;
+        e.data.ptr = info;
+        int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, info->fd, &e);
+        if (Q_UNLIKELY(res != 0)) {
+            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        }
+
+        ++itNative;
+    }
+
     return true;
 }
@@ -2,6 +2,8 @@
 #include "enginerequest.h"
 
 #include <QTest>
+#include <QCoreApplication>
+#include <QEventLoop>
 #include <QMetaObject>
 #include <QString>
 #include <QDebug>
@@ -19,12 +21,14 @@ public:
 protected:
     virtual qint64 doWrite(const char *data, qint64 len) final;
     virtual bool writeHeaders(quint16 status, const Headers &headers) final;
+    virtual void processingFinished() final { m_finished = true; }
 
 public:
     QByteArray m_responseData;
     QByteArray m_status;
     Headers m_headers;
     quint16 m_statusCode;
+    bool m_finished = false;
 };
 
 void CoverageObject::init()
@@ -111,6 +115,11 @@ QVariantMap TestEngine::createRequest(const QString &method, const QString &path
 
     processRequest(&req);
 
+    // Requests detached with Context::detachAsync()
+    while (!req.m_finished) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+
     ret = {
         {QStringLiteral("body"), req.m_responseData},
         {QStringLiteral("status"), req.m_status},
@@ -118,6 +127,8 @@ QVariantMap TestEngine::createRequest(const QString &method, const QString &path
         {QStringLiteral("headers"), QVariant::fromValue(req.m_headers)}
     };
 
+    req.releaseContext();
+
     return ret;
 }
 
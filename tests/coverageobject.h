@@ -154,6 +154,13 @@ public:
         c->response()->setBody(QStringLiteral("path /%1 args %2").arg(c->request()->path(), c->request()->args().join(QLatin1Char('/'))));
     }
 
+    // Not returning void or bool makes it go through QMetaMethod::invoke()
+    C_ATTR(twoInvoke, :Local :Args(2))
+    int twoInvoke(Context *c) {
+        c->response()->setBody(QStringLiteral("path /%1 args %2").arg(c->request()->path(), c->request()->args().join(QLatin1Char('/'))));
+        return 0;
+    }
+
 
     C_ATTR(root, :Chained("/"))
     void root(Context *c) {
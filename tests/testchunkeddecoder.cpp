@@ -0,0 +1,197 @@
+#ifndef CHUNKEDDECODERTEST_H
+#define CHUNKEDDECODERTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+
+#include "chunkeddecoder.h"
+#include "coverageobject.h"
+
+using namespace CWSGI;
+
+class TestChunkedDecoder : public CoverageObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testDecode_data();
+    void testDecode();
+
+    void testSplit_data() {
+        testDecode_data();
+    }
+    void testSplit();
+
+    void testSinkFailure();
+
+private:
+    qint64 decode(ChunkedDecoder &decoder, const QByteArray &input, int step, QByteArray &output, quint16 *error);
+};
+
+// Feeds input step bytes at a time like reads ending at arbitrary boundaries
+qint64 TestChunkedDecoder::decode(ChunkedDecoder &decoder, const QByteArray &input, int step, QByteArray &output, quint16 *error)
+{
+    const ChunkedDecoder::Sink sink = [&output] (const char *data, qint64 len) {
+        output.append(data, int(len));
+        return true;
+    };
+
+    qint64 consumed = 0;
+    while (consumed < input.size() && !decoder.isDone()) {
+        const qint64 len = qMin<qint64>(step, input.size() - consumed);
+        const qint64 ret = decoder.decode(input.constData() + consumed, len, error, sink);
+        if (ret == -1) {
+            return -1;
+        }
+        consumed += ret;
+    }
+    return consumed;
+}
+
+void TestChunkedDecoder::testDecode_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<qint64>("chunkLimit");
+    QTest::addColumn<qint64>("maxSize");
+    QTest::addColumn<QByteArray>("output");
+    QTest::addColumn<quint16>("error");
+    QTest::addColumn<qint64>("consumed");
+    QTest::addColumn<bool>("done");
+
+    const QByteArray wiki = QByteArrayLiteral("4\r\nWiki\r\n5\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\n\r\n");
+    QTest::newRow("chunked-test00") << wiki << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wikipedia in\r\n\r\nchunks.") << quint16(0) << qint64(wiki.size()) << true;
+
+    QTest::newRow("chunked-test01") << QByteArrayLiteral("0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(0) << qint64(5) << true;
+
+    QTest::newRow("chunked-test02") << QByteArrayLiteral("a\r\n0123456789\r\nA\r\n0123456789\r\n0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("01234567890123456789") << quint16(0) << qint64(35) << true;
+
+    // Extensions are ignored, with and without BWS
+    QTest::newRow("chunked-test03") << QByteArrayLiteral("4;name=value\r\nWiki\r\n5 ;quoted=\"a;b\"\r\npedia\r\n0;last\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wikipedia") << quint16(0) << qint64(54) << true;
+
+    // Trailers are skipped
+    QTest::newRow("chunked-test04") << QByteArrayLiteral("4\r\nWiki\r\n0\r\nX-Checksum: abc\r\nX-Other: d\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wiki") << quint16(0) << qint64(43) << true;
+
+    // A pipelined request stays in the buffer
+    QTest::newRow("chunked-test05") << QByteArrayLiteral("4\r\nWiki\r\n0\r\n\r\nGET / HTTP/1.1\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wiki") << quint16(0) << qint64(14) << true;
+
+    // Not finished yet
+    QTest::newRow("chunked-test06") << QByteArrayLiteral("4\r\nWiki\r\n5\r\nped") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wikiped") << quint16(0) << qint64(15) << false;
+
+    // Malformed
+    QTest::newRow("chunked-test07") << QByteArrayLiteral("\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(400) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test08") << QByteArrayLiteral("4x\r\nWiki\r\n0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(400) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test09") << QByteArrayLiteral("4\r\nWikipedia\r\n0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArrayLiteral("Wiki") << quint16(400) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test10") << QByteArrayLiteral("4\rWiki\r\n0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(400) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test11") << QByteArrayLiteral("-4\r\nWiki\r\n0\r\n\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(400) << qint64(-1) << false;
+
+    // Chunk limit
+    QTest::newRow("chunked-test12") << QByteArrayLiteral("a\r\n0123456789\r\n0\r\n\r\n") << qint64(10) << qint64(0)
+                                    << QByteArrayLiteral("0123456789") << quint16(0) << qint64(20) << true;
+
+    QTest::newRow("chunked-test13") << QByteArrayLiteral("b\r\n0123456789a\r\n0\r\n\r\n") << qint64(10) << qint64(0)
+                                    << QByteArray() << quint16(413) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test14") << QByteArrayLiteral("5\r\n01234\r\n0\r\n\r\n") << qint64(4) << qint64(0)
+                                    << QByteArray() << quint16(413) << qint64(-1) << false;
+
+    QTest::newRow("chunked-test15") << QByteArrayLiteral("ffffffffffffffffffff\r\n") << qint64(1048576) << qint64(0)
+                                    << QByteArray() << quint16(413) << qint64(-1) << false;
+
+    // Leading zeros don't count
+    QTest::newRow("chunked-test16") << QByteArrayLiteral("0000000004\r\nWiki\r\n0\r\n\r\n") << qint64(4) << qint64(0)
+                                    << QByteArrayLiteral("Wiki") << quint16(0) << qint64(23) << true;
+
+    // Total size limit
+    QTest::newRow("chunked-test17") << QByteArrayLiteral("4\r\nWiki\r\n5\r\npedia\r\n0\r\n\r\n") << qint64(1048576) << qint64(9)
+                                    << QByteArrayLiteral("Wikipedia") << quint16(0) << qint64(24) << true;
+
+    QTest::newRow("chunked-test18") << QByteArrayLiteral("4\r\nWiki\r\n5\r\npedia\r\n1\r\n!\r\n0\r\n\r\n") << qint64(1048576) << qint64(9)
+                                    << QByteArrayLiteral("Wikipedia") << quint16(413) << qint64(-1) << false;
+}
+
+void TestChunkedDecoder::testDecode()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(qint64, chunkLimit);
+    QFETCH(qint64, maxSize);
+    QFETCH(QByteArray, output);
+    QFETCH(quint16, error);
+    QFETCH(qint64, consumed);
+    QFETCH(bool, done);
+
+    ChunkedDecoder decoder(chunkLimit, maxSize);
+    QByteArray result;
+    quint16 resultError = 0;
+    QCOMPARE(decode(decoder, input, input.size(), result, &resultError), consumed);
+    QCOMPARE(resultError, error);
+    QCOMPARE(decoder.isDone(), done);
+    if (!error) {
+        QCOMPARE(result, output);
+        QCOMPARE(decoder.size, qint64(output.size()));
+    }
+
+    decoder.reset();
+    QVERIFY(!decoder.isDone());
+    QCOMPARE(decoder.size, qint64(0));
+}
+
+void TestChunkedDecoder::testSplit()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(qint64, chunkLimit);
+    QFETCH(qint64, maxSize);
+    QFETCH(QByteArray, output);
+    QFETCH(quint16, error);
+    QFETCH(qint64, consumed);
+    QFETCH(bool, done);
+
+    // Every read size, so CRLFs, sizes and extensions get split everywhere
+    for (int step = 1; step < input.size(); ++step) {
+        ChunkedDecoder decoder(chunkLimit, maxSize);
+        QByteArray result;
+        quint16 resultError = 0;
+        QCOMPARE(decode(decoder, input, step, result, &resultError), consumed);
+        QCOMPARE(resultError, error);
+        QCOMPARE(decoder.isDone(), done);
+        if (!error) {
+            QCOMPARE(result, output);
+        } else {
+            // Data before the error was delivered as it arrived
+            QVERIFY(output.startsWith(result));
+        }
+    }
+}
+
+void TestChunkedDecoder::testSinkFailure()
+{
+    ChunkedDecoder decoder;
+    const QByteArray input = QByteArrayLiteral("4\r\nWiki\r\n0\r\n\r\n");
+    quint16 error = 0;
+    const qint64 ret = decoder.decode(input.constData(), input.size(), &error, [] (const char *data, qint64 len) {
+        Q_UNUSED(data)
+        Q_UNUSED(len)
+        return false;
+    });
+    QCOMPARE(ret, qint64(-1));
+    QCOMPARE(error, quint16(500));
+}
+
+QTEST_MAIN(TestChunkedDecoder)
+#include "testchunkeddecoder.moc"
+
+#endif
@@ -4,6 +4,7 @@
 #include <QTest>
 #include <QObject>
 #include <QUrlQuery>
+#include <QTimer>
 
 #include "headers.h"
 #include "coverageobject.h"
@@ -125,6 +126,91 @@ private:
     bool End(Context *) { return true; }
 };
 
+class ContextAsyncTest : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("context/async")
+public:
+    explicit ContextAsyncTest(QObject *parent) : Controller(parent) {}
+
+    C_ATTR(detach, :Local :AutoArgs)
+    void detach(Context *c) {
+        c->detachAsync();
+        QTimer::singleShot(0, c, [c] () {
+            c->response()->body().append("detached");
+            c->attachAsync();
+        });
+    }
+
+    C_ATTR(detachTwice, :Local :AutoArgs)
+    void detachTwice(Context *c) {
+        c->detachAsync();
+        QTimer::singleShot(0, c, [c] () {
+            c->response()->body().append("first");
+            c->attachAsync();
+        });
+    }
+
+    C_ATTR(attachedBeforeReturn, :Local :AutoArgs)
+    void attachedBeforeReturn(Context *c) {
+        c->detachAsync();
+        c->response()->body().append("sync");
+        c->attachAsync();
+    }
+
+    C_ATTR(wait, :Local :AutoArgs)
+    void wait(Context *c) {
+        c->wait(2);
+        QTimer::singleShot(0, c, [c] () {
+            c->response()->body().append("one");
+            c->next();
+        });
+        QTimer::singleShot(1, c, [c] () {
+            c->response()->body().append("two");
+            c->next();
+        });
+    }
+
+    C_ATTR(chainRoot, :Chained("/") :PathPart("asyncChain") :CaptureArgs(1))
+    void chainRoot(Context *c, const QString &id) {
+        c->detachAsync();
+        QTimer::singleShot(0, c, [c, id] () {
+            c->response()->body().append(QByteArrayLiteral("root-") + id.toLatin1());
+            c->attachAsync();
+        });
+    }
+
+    C_ATTR(chainMiddle, :Chained("chainRoot") :PathPart("middle") :CaptureArgs(1))
+    void chainMiddle(Context *c, const QString &id) {
+        c->response()->body().append(QByteArrayLiteral("-middle-") + id.toLatin1());
+        c->detachAsync();
+        QTimer::singleShot(0, c, [c] () {
+            c->response()->body().append("-resumed");
+            c->attachAsync();
+        });
+    }
+
+    C_ATTR(chainFinal, :Chained("chainMiddle") :PathPart("final") :Args(1))
+    void chainFinal(Context *c, const QString &arg) {
+        c->response()->body().append(QByteArrayLiteral("-final-") + arg.toLatin1());
+    }
+
+private:
+    C_ATTR(End,)
+    bool End(Context *c) {
+        if (c->actionName() == QLatin1String("detachTwice") && !c->stash(QStringLiteral("again")).toBool()) {
+            c->setStash(QStringLiteral("again"), true);
+            c->detachAsync();
+            QTimer::singleShot(0, c, [c] () {
+                c->response()->body().append("-second");
+                c->attachAsync();
+            });
+        }
+        c->response()->body().append("-end");
+        return true;
+    }
+};
+
 void TestContext::initTestCase()
 {
     m_engine = getEngine();
@@ -138,6 +224,7 @@ TestEngine* TestContext::getEngine()
     auto engine = new TestEngine(app, QVariantMap());
     new ContextGetActionsTest(app);
     new ContextTest_NS(app);
+    new ContextAsyncTest(app);
     if (!engine->init()) {
         return nullptr;
     }
@@ -472,6 +559,18 @@ void TestContext::testController_data()
     query.addQueryItem(QStringLiteral("ns"), QStringLiteral("context/test_ns/with/this/extra/invalid/namespace/will/match"));
     QTest::newRow("getactions-test00") << QStringLiteral("/context/test_ns/getActions?") + query.toString(QUrl::FullyEncoded)
                                        << QByteArrayLiteral("context/test_ns/ns;");
+
+    // Async
+    QTest::newRow("async-test00") << QStringLiteral("/context/async/detach")
+                                  << QByteArrayLiteral("detached-end");
+    QTest::newRow("async-test01") << QStringLiteral("/context/async/attachedBeforeReturn")
+                                  << QByteArrayLiteral("sync-end");
+    QTest::newRow("async-test02") << QStringLiteral("/context/async/wait")
+                                  << QByteArrayLiteral("onetwo-end");
+    QTest::newRow("async-test03") << QStringLiteral("/context/async/detachTwice")
+                                  << QByteArrayLiteral("first-end-second");
+    QTest::newRow("async-test04") << QStringLiteral("/asyncChain/a/middle/b/final/c")
+                                  << QByteArrayLiteral("root-a-middle-b-resumed-final-c-end");
 }
 
 QTEST_MAIN(TestContext)
@@ -0,0 +1,237 @@
+#ifndef CONTEXTPOOLTEST_H
+#define CONTEXTPOOLTEST_H
+
+#include <QTest>
+#include <QObject>
+
+#include "headers.h"
+#include "coverageobject.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/Plugins/Session/Session>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace Cutelyst;
+
+// Counts operator new calls, Qt containers use malloc directly
+// so this measures the objects the context pool is able to recycle
+static std::atomic<quint64> s_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    ++s_allocations;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Calls made to a lambda using the Context as context object
+static int s_afterDispatchCalls = 0;
+
+class TestContextPool : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestContextPool(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testReuse();
+    void testSessionStore();
+    void testInboundConnection();
+
+    void benchmarkAllocations_data();
+    void benchmarkAllocations();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine;
+    TestEngine *m_enginePool;
+    TestEngine *m_engineSession;
+
+    TestEngine* getEngine(int poolSize, bool session = false);
+    QByteArray request(TestEngine *engine, const QString &path);
+};
+
+class ContextPoolApplication : public TestApplication
+{
+    Q_OBJECT
+public:
+    explicit ContextPoolApplication(QObject *parent = nullptr) : TestApplication(parent) {}
+
+    int afterDispatchReceivers() const {
+        return receivers(SIGNAL(afterDispatch(Context*)));
+    }
+};
+
+class ContextPoolTest : public Controller
+{
+    Q_OBJECT
+public:
+    explicit ContextPoolTest(QObject *parent) : Controller(parent) {}
+
+    C_ATTR(context, :Local :AutoArgs)
+    void context(Context *c) {
+        const bool clean = c->stash().isEmpty() && c->request()->arguments().isEmpty();
+        c->setStash(QStringLiteral("dirty"), true);
+        c->response()->setBody(QByteArray::number(quintptr(c)) + (clean ? "-clean" : "-dirty"));
+    }
+
+    C_ATTR(hello, :Local :AutoArgs)
+    void hello(Context *c) {
+        c->response()->setBody(QStringLiteral("Hello World!"));
+    }
+
+    // The file store connects to afterDispatch for each request
+    C_ATTR(session, :Local :AutoArgs)
+    void session(Context *c) {
+        Session::setValue(c, QStringLiteral("visits"), Session::value(c, QStringLiteral("visits")).toInt() + 1);
+        c->response()->setBody(QByteArray::number(quintptr(c)));
+    }
+
+    C_ATTR(connectContext, :Local :AutoArgs)
+    void connectContext(Context *c) {
+        connect(c->app(), &Application::afterDispatch, c, [] {
+            ++s_afterDispatchCalls;
+        });
+    }
+};
+
+void TestContextPool::initTestCase()
+{
+    m_engine = getEngine(0);
+    QVERIFY(m_engine);
+
+    m_enginePool = getEngine(4);
+    QVERIFY(m_enginePool);
+
+    m_engineSession = getEngine(4, true);
+    QVERIFY(m_engineSession);
+}
+
+TestEngine* TestContextPool::getEngine(int poolSize, bool session)
+{
+    auto app = new ContextPoolApplication;
+    auto engine = new TestEngine(app, QVariantMap());
+    engine->setConfig({
+                          {QStringLiteral("Cutelyst"), QVariantMap{
+                               {QStringLiteral("context_pool_size"), poolSize}
+                           }}
+                      });
+    new ContextPoolTest(app);
+    if (session) {
+        new Session(app);
+    }
+    if (!engine->init()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+QByteArray TestContextPool::request(TestEngine *engine, const QString &path)
+{
+    return engine->createRequest(QStringLiteral("GET"),
+                                 path,
+                                 QByteArray(),
+                                 Headers(),
+                                 nullptr).value(QStringLiteral("body")).toByteArray();
+}
+
+void TestContextPool::cleanupTestCase()
+{
+    delete m_engine;
+    delete m_enginePool;
+    delete m_engineSession;
+}
+
+void TestContextPool::testReuse()
+{
+    const QByteArray first = m_enginePool->createRequest(QStringLiteral("GET"),
+                                                         QStringLiteral("/context/pool/test/context"),
+                                                         QByteArray(),
+                                                         Headers(),
+                                                         nullptr).value(QStringLiteral("body")).toByteArray();
+    const QByteArray second = m_enginePool->createRequest(QStringLiteral("GET"),
+                                                          QStringLiteral("/context/pool/test/context"),
+                                                          QByteArray(),
+                                                          Headers(),
+                                                          nullptr).value(QStringLiteral("body")).toByteArray();
+
+    QVERIFY(first.endsWith("-clean"));
+    QCOMPARE(second, first);
+}
+
+void TestContextPool::testSessionStore()
+{
+    auto app = qobject_cast<ContextPoolApplication *>(m_engineSession->app());
+    QVERIFY(app);
+
+    const QByteArray first = request(m_engineSession, QStringLiteral("/context/pool/test/session"));
+    const int receivers = app->afterDispatchReceivers();
+    const QByteArray second = request(m_engineSession, QStringLiteral("/context/pool/test/session"));
+
+    // The store's connection went away with its file, and the Context was recycled
+    QCOMPARE(app->afterDispatchReceivers(), receivers);
+    QCOMPARE(second, first);
+}
+
+void TestContextPool::testInboundConnection()
+{
+    s_afterDispatchCalls = 0;
+    request(m_enginePool, QStringLiteral("/context/pool/test/connectContext"));
+    QCOMPARE(s_afterDispatchCalls, 1);
+
+    // A Context still connected isn't recycled, so later requests don't fire it
+    request(m_enginePool, QStringLiteral("/context/pool/test/hello"));
+    request(m_enginePool, QStringLiteral("/context/pool/test/hello"));
+    QCOMPARE(s_afterDispatchCalls, 1);
+}
+
+void TestContextPool::benchmarkAllocations_data()
+{
+    QTest::addColumn<bool>("pool");
+
+    QTest::newRow("no-pool") << false;
+    QTest::newRow("pool") << true;
+}
+
+void TestContextPool::benchmarkAllocations()
+{
+    QFETCH(bool, pool);
+
+    TestEngine *engine = pool ? m_enginePool : m_engine;
+
+    // warm up
+    engine->createRequest(QStringLiteral("GET"), QStringLiteral("/context/pool/test/hello"), QByteArray(), Headers(), nullptr);
+
+    const quint64 before = s_allocations;
+    const int requests = 1000;
+    for (int i = 0; i < requests; ++i) {
+        engine->createRequest(QStringLiteral("GET"), QStringLiteral("/context/pool/test/hello"), QByteArray(), Headers(), nullptr);
+    }
+    QTest::setBenchmarkResult(qreal(s_allocations - before) / requests, QTest::Events);
+}
+
+QTEST_MAIN(TestContextPool)
+
+#include "testcontextpool.moc"
+
+#endif
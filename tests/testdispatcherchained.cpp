@@ -24,17 +24,30 @@ private Q_SLOTS:
 
     void testController_data();
     void testController() {
-        doTest();
+        doTest(m_engine);
     }
 
+    void testControllerCached_data() {
+        testController_data();
+    }
+    void testControllerCached() {
+        // The second request is served from the dispatcher cache
+        doTest(m_engineCached);
+        doTest(m_engineCached);
+    }
+
+    void benchmark_data();
+    void benchmark();
+
     void cleanupTestCase();
 
 private:
     TestEngine *m_engine;
+    TestEngine *m_engineCached;
 
-    TestEngine* getEngine();
+    TestEngine* getEngine(int cacheSize = 0);
 
-    void doTest();
+    void doTest(TestEngine *engine);
 
 };
 
@@ -42,12 +55,20 @@ void TestDispatcherChained::initTestCase()
 {
     m_engine = getEngine();
     QVERIFY(m_engine);
+
+    m_engineCached = getEngine(100);
+    QVERIFY(m_engineCached);
 }
 
-TestEngine* TestDispatcherChained::getEngine()
+TestEngine* TestDispatcherChained::getEngine(int cacheSize)
 {
     auto app = new TestApplication;
     auto engine = new TestEngine(app, QVariantMap());
+    engine->setConfig({
+                          {QStringLiteral("Cutelyst"), QVariantMap{
+                               {QStringLiteral("dispatcher_cache_size"), cacheSize}
+                           }}
+                      });
     if (!engine->init()) {
         return nullptr;
     }
@@ -58,24 +79,46 @@ TestEngine* TestDispatcherChained::getEngine()
 void TestDispatcherChained::cleanupTestCase()
 {
     delete m_engine;
+    delete m_engineCached;
 }
 
-void TestDispatcherChained::doTest()
+void TestDispatcherChained::doTest(TestEngine *engine)
 {
     QFETCH(QString, url);
     QFETCH(QByteArray, output);
 
     QUrl urlAux(url.mid(1));
 
-    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
-                                                 urlAux.path(),
-                                                 urlAux.query(QUrl::FullyEncoded).toLatin1(),
-                                                 Headers(),
-                                                 nullptr);
+    QVariantMap result = engine->createRequest(QStringLiteral("GET"),
+                                               urlAux.path(),
+                                               urlAux.query(QUrl::FullyEncoded).toLatin1(),
+                                               Headers(),
+                                               nullptr);
 
     QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
 }
 
+void TestDispatcherChained::benchmark_data()
+{
+    QTest::addColumn<QString>("url");
+
+    QTest::newRow("chained-root") << QStringLiteral("root/item");
+    QTest::newRow("chained-deep") << QStringLiteral("chain/midle/TWO/ONE/end/1/2/3/4/5");
+}
+
+void TestDispatcherChained::benchmark()
+{
+    QFETCH(QString, url);
+
+    QBENCHMARK {
+        m_engine->createRequest(QStringLiteral("GET"),
+                                url,
+                                QByteArray(),
+                                Headers(),
+                                nullptr);
+    }
+}
+
 void TestDispatcherChained::testController_data()
 {
     QTest::addColumn<QString>("url");
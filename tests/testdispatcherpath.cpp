@@ -24,29 +24,50 @@ private Q_SLOTS:
 
     void testController_data();
     void testController() {
-        doTest();
+        doTest(m_engine);
     }
 
+    void testControllerCached_data() {
+        testController_data();
+    }
+    void testControllerCached() {
+        // The second request is served from the dispatcher cache
+        doTest(m_engineCached);
+        doTest(m_engineCached);
+    }
+
+    void benchmark_data();
+    void benchmark();
+
     void cleanupTestCase();
 
 private:
     TestEngine *m_engine;
+    TestEngine *m_engineCached;
 
-    TestEngine* getEngine();
+    TestEngine* getEngine(int cacheSize = 0);
 
-    void doTest();
+    void doTest(TestEngine *engine);
 };
 
 void TestDispatcherPath::initTestCase()
 {
     m_engine = getEngine();
     QVERIFY(m_engine);
+
+    m_engineCached = getEngine(100);
+    QVERIFY(m_engineCached);
 }
 
-TestEngine* TestDispatcherPath::getEngine()
+TestEngine* TestDispatcherPath::getEngine(int cacheSize)
 {
     auto app = new TestApplication;
     auto engine = new TestEngine(app, QVariantMap());
+    engine->setConfig({
+                          {QStringLiteral("Cutelyst"), QVariantMap{
+                               {QStringLiteral("dispatcher_cache_size"), cacheSize}
+                           }}
+                      });
     if (!engine->init()) {
         return nullptr;
     }
@@ -57,24 +78,47 @@ TestEngine* TestDispatcherPath::getEngine()
 void TestDispatcherPath::cleanupTestCase()
 {
     delete m_engine;
+    delete m_engineCached;
 }
 
-void TestDispatcherPath::doTest()
+void TestDispatcherPath::doTest(TestEngine *engine)
 {
     QFETCH(QString, url);
     QFETCH(QByteArray, output);
 
     QUrl urlAux(url.mid(1));
 
-    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
-                                                 urlAux.path(),
-                                                 urlAux.query(QUrl::FullyEncoded).toLatin1(),
-                                                 Headers(),
-                                                 nullptr);
+    QVariantMap result = engine->createRequest(QStringLiteral("GET"),
+                                               urlAux.path(),
+                                               urlAux.query(QUrl::FullyEncoded).toLatin1(),
+                                               Headers(),
+                                               nullptr);
 
     QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
 }
 
+void TestDispatcherPath::benchmark_data()
+{
+    QTest::addColumn<QString>("url");
+
+    QTest::newRow("path-controller") << QStringLiteral("test/controller/hello");
+    QTest::newRow("path-args") << QStringLiteral("test/controller/twoOld/1/2");
+    QTest::newRow("path-args-invoke") << QStringLiteral("test/controller/twoInvoke/1/2");
+}
+
+void TestDispatcherPath::benchmark()
+{
+    QFETCH(QString, url);
+
+    QBENCHMARK {
+        m_engine->createRequest(QStringLiteral("GET"),
+                                url,
+                                QByteArray(),
+                                Headers(),
+                                nullptr);
+    }
+}
+
 void TestDispatcherPath::testController_data()
 {
     QTest::addColumn<QString>("url");
@@ -103,6 +147,7 @@ void TestDispatcherPath::testController_data()
     QTest::newRow("path-test19") << QStringLiteral("/test/controller/twoOld/1/2") << QByteArrayLiteral("path /test/controller/twoOld/1/2 args 1/2");
     QTest::newRow("path-test20") << QStringLiteral("/test/controller/twoOld/1/2//") << QByteArrayLiteral("path /test/controller/twoOld/1/2// args 1/2");
     QTest::newRow("path-test21") << QStringLiteral("/") << QByteArrayLiteral("rootAction");
+    QTest::newRow("path-test22") << QStringLiteral("/test/controller/twoInvoke/1/2") << QByteArrayLiteral("path /test/controller/twoInvoke/1/2 args 1/2");
 }
 
 QTEST_MAIN(TestDispatcherPath)
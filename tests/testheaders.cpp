@@ -34,6 +34,7 @@ class TestHeaders : public CoverageObject
     Q_OBJECT
 private Q_SLOTS:
     void testCombining();
+    void testKnownHeaders();
 };
 
 void TestHeaders::testCombining()
@@ -162,6 +163,49 @@ void TestHeaders::testCombining()
     QCOMPARE(headers.contentDisposition(), QStringLiteral("attachment; filename=\"foo.txt\""));
 }
 
+void TestHeaders::testKnownHeaders()
+{
+    QCOMPARE(Headers::knownHeader("Content-Type", 12), int(Headers::ContentType));
+    QCOMPARE(Headers::knownHeader("content-type", 12), int(Headers::ContentType));
+    QCOMPARE(Headers::knownHeader("CONTENT_TYPE", 12), int(Headers::ContentType));
+    QCOMPARE(Headers::knownHeader("Accept", 6), int(Headers::Accept));
+    QCOMPARE(Headers::knownHeader("X-Requested-With", 16), int(Headers::XRequestedWith));
+    QCOMPARE(Headers::knownHeader("Content", 7), -1);
+    QCOMPARE(Headers::knownHeader("X-Custom", 8), -1);
+
+    for (int i = 0; i < Headers::KnownHeaderCount; ++i) {
+        const QByteArray key = Headers::knownHeaderKey(Headers::KnownHeader(i)).toLatin1();
+        QCOMPARE(Headers::knownHeader(key.constData(), key.size()), i);
+    }
+
+    Headers headers;
+    headers.pushRawHeader(Headers::Vary, QStringLiteral("Accept"));
+    headers.pushRawHeader(QStringLiteral("X_CUSTOM"), QStringLiteral("custom"));
+    headers.pushHeader(QStringLiteral("vary"), QStringLiteral("Cookie"));
+    QCOMPARE(headers.header(Headers::Vary), QStringLiteral("Cookie"));
+    QCOMPARE(headers.header(QStringLiteral("Vary")), QStringLiteral("Cookie"));
+    QCOMPARE(headers.data().values(QStringLiteral("VARY")).size(), 2);
+    QCOMPARE(headers.entries().size(), 3);
+    QCOMPARE(headers.header(QStringLiteral("x-custom")), QStringLiteral("custom"));
+
+    headers.removeHeader(QStringLiteral("x-custom"));
+    QCOMPARE(headers.contains(QStringLiteral("x-custom")), false);
+    QCOMPARE(headers.header(Headers::Vary), QStringLiteral("Cookie"));
+
+    headers.removeHeader(QStringLiteral("vary"));
+    QCOMPARE(headers.header(Headers::Vary).isNull(), true);
+    QCOMPARE(headers.entries().isEmpty(), true);
+
+    headers.setHeader(Headers::Server, QStringLiteral("cutelyst"));
+    QCOMPARE(headers.server(), QStringLiteral("cutelyst"));
+    headers[QStringLiteral("SERVER")] = QStringLiteral("other");
+    QCOMPARE(headers.header(Headers::Server), QStringLiteral("other"));
+
+    const Headers copy = headers;
+    QCOMPARE(copy.header(Headers::Server), QStringLiteral("other"));
+    QVERIFY(copy == headers);
+}
+
 QTEST_MAIN(TestHeaders)
 #include "testheaders.moc"
 
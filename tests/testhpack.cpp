@@ -0,0 +1,436 @@
+#ifndef HPACKTEST_H
+#define HPACKTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+
+#include "hpack.h"
+#include "protocolhttp2.h"
+#include "socket.h"
+#include "cwsgiengine.h"
+#include "coverageobject.h"
+
+#include <Cutelyst/Headers>
+
+using namespace CWSGI;
+using namespace Cutelyst;
+
+class TestHPack : public CoverageObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testRequestHuffman();
+    void testResponseHuffmanEviction();
+
+    void testHuffman_data();
+    void testHuffman();
+
+    void testRoundTrip_data();
+    void testRoundTrip();
+
+    void benchmarkEncode_data();
+    void benchmarkEncode();
+
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+
+    void benchmarkCompression_data();
+    void benchmarkCompression();
+
+private:
+    int decode(HPack &hpack, const QByteArray &block, H2Stream &stream);
+
+    TcpSocket *m_sock = nullptr;
+    ProtoRequestHttp2 *m_protoRequest = nullptr;
+};
+
+void TestHPack::initTestCase()
+{
+    // Streams only read the connection addresses from these
+    m_sock = new TcpSocket(nullptr, this);
+    m_protoRequest = new ProtoRequestHttp2(m_sock, 16);
+}
+
+void TestHPack::cleanupTestCase()
+{
+    delete m_protoRequest;
+}
+
+int TestHPack::decode(HPack &hpack, const QByteArray &block, H2Stream &stream)
+{
+    // The block is only read
+    auto it = reinterpret_cast<unsigned char *>(const_cast<char *>(block.constData()));
+    return hpack.decode(it, it + block.size(), &stream);
+}
+
+// RFC 7541 C.4, requests with Huffman coding sharing the dynamic table
+void TestHPack::testRequestHuffman()
+{
+    HPack hpack(4096);
+    {
+        H2Stream stream(1, 65535, m_protoRequest);
+        QCOMPARE(decode(hpack, QByteArray::fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), stream), 0);
+        QCOMPARE(stream.method, QStringLiteral("GET"));
+        QCOMPARE(stream.scheme, QStringLiteral("http"));
+        QCOMPARE(stream.path, QStringLiteral("/"));
+        QCOMPARE(stream.serverAddress, QStringLiteral("www.example.com"));
+        QVERIFY(stream.headers.entries().isEmpty());
+    }
+    {
+        H2Stream stream(3, 65535, m_protoRequest);
+        QCOMPARE(decode(hpack, QByteArray::fromHex("828684be5886a8eb10649cbf"), stream), 0);
+        QCOMPARE(stream.method, QStringLiteral("GET"));
+        QCOMPARE(stream.scheme, QStringLiteral("http"));
+        QCOMPARE(stream.path, QStringLiteral("/"));
+        QCOMPARE(stream.serverAddress, QStringLiteral("www.example.com"));
+        QCOMPARE(stream.headers.entries().size(), 1);
+        QCOMPARE(stream.headers.header(QStringLiteral("Cache-Control")), QStringLiteral("no-cache"));
+    }
+    {
+        H2Stream stream(5, 65535, m_protoRequest);
+        QCOMPARE(decode(hpack, QByteArray::fromHex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), stream), 0);
+        QCOMPARE(stream.method, QStringLiteral("GET"));
+        QCOMPARE(stream.scheme, QStringLiteral("https"));
+        QCOMPARE(stream.path, QStringLiteral("/index.html"));
+        QCOMPARE(stream.serverAddress, QStringLiteral("www.example.com"));
+        QCOMPARE(stream.headers.entries().size(), 1);
+        QCOMPARE(stream.headers.header(QStringLiteral("Custom-Key")), QStringLiteral("custom-value"));
+    }
+}
+
+// RFC 7541 C.6, responses with Huffman coding on a 256 bytes table so
+// entries get evicted. Requests can't carry :status, so the literal
+// :status fields are replaced by x-state ones of the same table size,
+// 88 is dropped and the request pseudo headers are prepended
+void TestHPack::testResponseHuffmanEviction()
+{
+    const QByteArray pseudo = QByteArray::fromHex("828684");
+    const QByteArray xState = QByteArray::fromHex("4007") + QByteArrayLiteral("x-state");
+    const QString date21 = QStringLiteral("Mon, 21 Oct 2013 20:13:21 GMT");
+    const QString location = QStringLiteral("https://www.example.com");
+
+    HPack hpack(256);
+    {
+        H2Stream stream(1, 65535, m_protoRequest);
+        const QByteArray block = pseudo + xState + QByteArray::fromHex(
+                    "82640258"
+                    "85aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3");
+        QCOMPARE(decode(hpack, block, stream), 0);
+        QCOMPARE(stream.headers.entries().size(), 4);
+        QCOMPARE(stream.headers.header(QStringLiteral("X-State")), QStringLiteral("302"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Cache-Control")), QStringLiteral("private"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Date")), date21);
+        QCOMPARE(stream.headers.header(QStringLiteral("Location")), location);
+    }
+    {
+        // Inserting x-state 307 evicts x-state 302
+        H2Stream stream(3, 65535, m_protoRequest);
+        const QByteArray block = pseudo + xState + QByteArray::fromHex("83640effc1c0bf");
+        QCOMPARE(decode(hpack, block, stream), 0);
+        QCOMPARE(stream.headers.entries().size(), 4);
+        QCOMPARE(stream.headers.header(QStringLiteral("X-State")), QStringLiteral("307"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Cache-Control")), QStringLiteral("private"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Date")), date21);
+        QCOMPARE(stream.headers.header(QStringLiteral("Location")), location);
+    }
+    {
+        // Inserting date, content-encoding and set-cookie evicts most of the table
+        H2Stream stream(5, 65535, m_protoRequest);
+        const QByteArray block = pseudo + QByteArray::fromHex(
+                    "c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b39"
+                    "60d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007");
+        QCOMPARE(decode(hpack, block, stream), 0);
+        QCOMPARE(stream.headers.entries().size(), 5);
+        QCOMPARE(stream.headers.header(QStringLiteral("Cache-Control")), QStringLiteral("private"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Date")), QStringLiteral("Mon, 21 Oct 2013 20:13:22 GMT"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Location")), location);
+        QCOMPARE(stream.headers.header(QStringLiteral("Content-Encoding")), QStringLiteral("gzip"));
+        QCOMPARE(stream.headers.header(QStringLiteral("Set-Cookie")), QStringLiteral("foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"));
+    }
+    {
+        // Only set-cookie, content-encoding and date are left
+        H2Stream stream(7, 65535, m_protoRequest);
+        QCOMPARE(decode(hpack, pseudo + QByteArray::fromHex("c0"), stream), 0);
+        QCOMPARE(stream.headers.header(QStringLiteral("Date")), QStringLiteral("Mon, 21 Oct 2013 20:13:22 GMT"));
+
+        H2Stream evicted(9, 65535, m_protoRequest);
+        // COMPRESSION_ERROR
+        QCOMPARE(decode(hpack, pseudo + QByteArray::fromHex("c1"), evicted), 9);
+    }
+}
+
+void TestHPack::testHuffman_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("output");
+
+    // Literal x-test value without indexing
+    QTest::newRow("huffman-test00") << QByteArray::fromHex("8cf1e3c2e5f23a6ba0ab90f4ff") << true << QStringLiteral("www.example.com");
+    QTest::newRow("huffman-test01") << QByteArray::fromHex("96d07abe941054d444a8200595040b8166e082a62d1bff") << true << QStringLiteral("Mon, 21 Oct 2013 20:13:21 GMT");
+    // Shortest and longest valid padding, and a symbol cut short
+    QTest::newRow("huffman-test02") << QByteArray::fromHex("811f") << true << QStringLiteral("a");
+    QTest::newRow("huffman-test03") << QByteArray::fromHex("83640eff") << true << QStringLiteral("307");
+    QTest::newRow("huffman-test04") << QByteArray::fromHex("82640e") << false << QString();
+    // Empty strings, Huffman coded or not
+    QTest::newRow("huffman-test05") << QByteArray::fromHex("80") << true << QString();
+    QTest::newRow("huffman-test06") << QByteArray::fromHex("00") << true << QString();
+    // The EOS symbol inside the string
+    QTest::newRow("huffman-test07") << QByteArray::fromHex("851fffffffff") << false << QString();
+    QTest::newRow("huffman-test08") << QByteArray::fromHex("84ffffffff") << false << QString();
+    // Padding longer than 7 bits
+    QTest::newRow("huffman-test09") << QByteArray::fromHex("821fff") << false << QString();
+    QTest::newRow("huffman-test10") << QByteArray::fromHex("81ff") << false << QString();
+    // Padding that isn't the EOS prefix
+    QTest::newRow("huffman-test11") << QByteArray::fromHex("8118") << false << QString();
+    // Length past the end of the block
+    QTest::newRow("huffman-test12") << QByteArray::fromHex("8d f1e3c2e5f23a6ba0ab90f4ff") << false << QString();
+}
+
+void TestHPack::testHuffman()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(bool, valid);
+    QFETCH(QString, output);
+
+    HPack hpack(4096);
+    H2Stream stream(1, 65535, m_protoRequest);
+    const QByteArray block = QByteArray::fromHex("82868400") + char(6) + QByteArrayLiteral("x-test") + value;
+    const int ret = decode(hpack, block, stream);
+    if (valid) {
+        QCOMPARE(ret, 0);
+        QCOMPARE(stream.headers.entries().size(), 1);
+        QCOMPARE(stream.headers.header(QStringLiteral("X-Test")), output);
+    } else {
+        QVERIFY(ret != 0);
+    }
+}
+
+void TestHPack::testRoundTrip_data()
+{
+    QTest::addColumn<QVector<int>>("tableSizes");
+
+    QTest::newRow("roundtrip-test00") << QVector<int>{ 4096 };
+    QTest::newRow("roundtrip-test01") << QVector<int>{ 0 };
+    QTest::newRow("roundtrip-test02") << QVector<int>{ 256, 64, 4096 };
+    QTest::newRow("roundtrip-test03") << QVector<int>{ 4096, 100, 0, 300 };
+    QTest::newRow("roundtrip-test04") << QVector<int>{ 8192, 16 };
+}
+
+void TestHPack::testRoundTrip()
+{
+    QFETCH(QVector<int>, tableSizes);
+
+    QVector<Headers> blocks;
+    {
+        Headers headers;
+        headers.setHeader(QStringLiteral("User-Agent"), QStringLiteral("Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0"));
+        headers.setHeader(QStringLiteral("Accept"), QStringLiteral("text/html,application/xhtml+xml"));
+        headers.setHeader(QStringLiteral("Accept-Encoding"), QStringLiteral("gzip, deflate, br"));
+        headers.setHeader(QStringLiteral("Cookie"), QStringLiteral("session=0123456789abcdef"));
+        blocks.append(headers);
+    }
+    {
+        Headers headers;
+        headers.setHeader(QStringLiteral("User-Agent"), QStringLiteral("Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0"));
+        headers.setHeader(QStringLiteral("Accept"), QStringLiteral("image/webp,*/*"));
+        headers.setHeader(QStringLiteral("Authorization"), QStringLiteral("Basic Zm9vOmJhcg=="));
+        headers.setHeader(QStringLiteral("X-Requested-With"), QStringLiteral("XMLHttpRequest"));
+        headers.setHeader(QStringLiteral("Content-Length"), QStringLiteral("42"));
+        blocks.append(headers);
+    }
+    {
+        Headers headers;
+        headers.setHeader(QStringLiteral("X-Long"), QString(600, QLatin1Char('x')));
+        headers.setHeader(QStringLiteral("X-Requested-With"), QStringLiteral("XMLHttpRequest"));
+        headers.setHeader(QStringLiteral("Accept-Encoding"), QStringLiteral("gzip, deflate, br"));
+        headers.setHeader(QStringLiteral("X-Latin1"), QStringLiteral("café"));
+        blocks.append(headers);
+    }
+
+    HPack encoder(4096);
+    HPack decoder(4096);
+    quint32 streamId = 1;
+    for (int tableSize : tableSizes) {
+        encoder.setEncoderMaxTableSize(quint32(tableSize));
+
+        // Every block twice so the second one references the table
+        for (int i = 0; i < blocks.size() * 2; ++i) {
+            const Headers &headers = blocks.at(i % blocks.size());
+            const QString path = QLatin1String("/round/trip/") + QString::number(i) + QLatin1String("?size=") + QString::number(tableSize);
+
+            QByteArray buf;
+            encoder.encodePushHeaders(QStringLiteral("https"), QStringLiteral("www.example.com"), path, headers, buf);
+
+            H2Stream stream(streamId, 65535, m_protoRequest);
+            streamId += 2;
+            QCOMPARE(decode(decoder, buf, stream), 0);
+            QCOMPARE(stream.method, QStringLiteral("GET"));
+            QCOMPARE(stream.scheme, QStringLiteral("https"));
+            QCOMPARE(stream.serverAddress, QStringLiteral("www.example.com"));
+            QCOMPARE(stream.path, QString(QLatin1String("/round/trip/") + QString::number(i)));
+            QCOMPARE(stream.query, QByteArray(QByteArrayLiteral("size=") + QByteArray::number(tableSize)));
+
+            const auto &entries = headers.entries();
+            QCOMPARE(stream.headers.entries().size(), entries.size());
+            for (const auto &entry : entries) {
+                QCOMPARE(stream.headers.header(entry.key), entry.value);
+            }
+        }
+    }
+}
+
+static Headers responseHeaders(int count)
+{
+    Headers headers;
+    headers.setHeader(QStringLiteral("Date"), QStringLiteral("Mon, 21 Oct 2013 20:13:21 GMT"));
+    headers.setContentType(QStringLiteral("text/html; charset=utf-8"));
+    headers.setContentLength(4711);
+    headers.setHeader(QStringLiteral("Server"), QStringLiteral("cutelyst/2"));
+    headers.setHeader(QStringLiteral("Cache-Control"), QStringLiteral("private, max-age=0"));
+    headers.setHeader(QStringLiteral("Set-Cookie"), QStringLiteral("session=0123456789abcdef; HttpOnly"));
+    headers.setHeader(QStringLiteral("X-Frame-Options"), QStringLiteral("SAMEORIGIN"));
+    headers.setHeader(QStringLiteral("Vary"), QStringLiteral("Accept-Encoding"));
+    for (int i = 8; i < count; ++i) {
+        headers.setHeader(QLatin1String("X-Custom-") + QString::number(i), QStringLiteral("custom value ") + QString::number(i));
+    }
+    return headers;
+}
+
+void TestHPack::benchmarkEncode_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("warm");
+
+    QTest::newRow("encode-8-cold") << 8 << false;
+    QTest::newRow("encode-8-warm") << 8 << true;
+    QTest::newRow("encode-24-cold") << 24 << false;
+    QTest::newRow("encode-24-warm") << 24 << true;
+}
+
+// Reports nanoseconds per encoded header, cold uses a new encoder each
+// time while warm keeps it like a keep-alive connection does
+void TestHPack::benchmarkEncode()
+{
+    QFETCH(int, count);
+    QFETCH(bool, warm);
+
+    const Headers headers = responseHeaders(count);
+    const int iterations = 10000;
+    QByteArray buf;
+    buf.reserve(4096);
+
+    HPack hpack(4096);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        buf.resize(0);
+        if (warm) {
+            hpack.encodeHeaders(200, headers, buf, nullptr);
+        } else {
+            HPack cold(4096);
+            cold.encodeHeaders(200, headers, buf, nullptr);
+        }
+    }
+    QTest::setBenchmarkResult(qreal(timer.nsecsElapsed()) / (qint64(iterations) * headers.entries().size()), QTest::WalltimeNanoseconds);
+}
+
+void TestHPack::benchmarkDecode_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("warm");
+
+    QTest::newRow("decode-8-cold") << 8 << false;
+    QTest::newRow("decode-8-warm") << 8 << true;
+    QTest::newRow("decode-24-cold") << 24 << false;
+    QTest::newRow("decode-24-warm") << 24 << true;
+}
+
+// Reports nanoseconds per decoded header, the cold block is mostly
+// Huffman coded literals while the warm one mostly table references
+void TestHPack::benchmarkDecode()
+{
+    QFETCH(int, count);
+    QFETCH(bool, warm);
+
+    Headers headers = responseHeaders(count);
+    headers.removeHeader(QStringLiteral("Date"));
+
+    HPack encoder(4096);
+    QByteArray first;
+    encoder.encodePushHeaders(QStringLiteral("https"), QStringLiteral("www.example.com"), QStringLiteral("/"), headers, first);
+    QByteArray second;
+    encoder.encodePushHeaders(QStringLiteral("https"), QStringLiteral("www.example.com"), QStringLiteral("/"), headers, second);
+
+    HPack decoder(4096);
+    {
+        H2Stream stream(1, 65535, m_protoRequest);
+        QCOMPARE(decode(decoder, first, stream), 0);
+    }
+
+    const int iterations = 10000;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        H2Stream stream(1, 65535, m_protoRequest);
+        if (warm) {
+            decode(decoder, second, stream);
+        } else {
+            HPack cold(4096);
+            decode(cold, first, stream);
+        }
+    }
+    // The pseudo headers are counted too
+    QTest::setBenchmarkResult(qreal(timer.nsecsElapsed()) / (qint64(iterations) * (headers.entries().size() + 4)), QTest::WalltimeNanoseconds);
+}
+
+void TestHPack::benchmarkCompression_data()
+{
+    QTest::addColumn<bool>("hpack");
+
+    QTest::newRow("compression-http1") << false;
+    QTest::newRow("compression-hpack") << true;
+}
+
+// Reports the bytes per response header block over 100 responses on one
+// connection, as HTTP/1.1 lines and as HPACK
+void TestHPack::benchmarkCompression()
+{
+    QFETCH(bool, hpack);
+
+    const Headers headers = responseHeaders(8);
+    const int responses = 100;
+
+    HPack encoder(4096);
+    qint64 total = 0;
+    QByteArray buf;
+    for (int i = 0; i < responses; ++i) {
+        buf.resize(0);
+        if (hpack) {
+            encoder.encodeHeaders(200, headers, buf, nullptr);
+        } else {
+            buf.append(QByteArrayLiteral("HTTP/1.1 200 OK"));
+            const auto &entries = headers.entries();
+            for (const auto &entry : entries) {
+                CWsgiEngine::appendHeaderLine(buf, entry.key, entry.value);
+            }
+            buf.append(QByteArrayLiteral("\r\n\r\n"));
+        }
+        total += buf.size();
+    }
+
+    if (hpack) {
+        // Only the status, date and content length aren't fully indexed
+        QVERIFY(buf.size() < 40);
+    }
+    QTest::setBenchmarkResult(qreal(total) / responses, QTest::Events);
+}
+
+QTEST_MAIN(TestHPack)
+#include "testhpack.moc"
+
+#endif
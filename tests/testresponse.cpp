@@ -11,6 +11,7 @@
 #include <QNetworkCookie>
 #include <QCryptographicHash>
 #include <QUrlQuery>
+#include <QBuffer>
 
 #include "headers.h"
 #include "coverageobject.h"
@@ -106,6 +107,21 @@ public:
         c->response()->body() = QByteArrayLiteral("abcd").repeated(1024 * 1024);
     }
 
+    C_ATTR(rangeBody, :Local :AutoArgs)
+    void rangeBody(Context *c) {
+        auto buffer = new QBuffer;
+        buffer->setData(QByteArrayLiteral("0123456789"));
+        buffer->open(QIODevice::ReadOnly);
+        c->response()->headers().setHeader(Headers::Etag, QStringLiteral("\"v1\""));
+        c->response()->setBody(buffer);
+    }
+
+    C_ATTR(pushAsset, :Local :AutoArgs)
+    void pushAsset(Context *c) {
+        c->response()->push(QStringLiteral("/static/app.css"));
+        c->response()->setBody(QByteArrayLiteral("page"));
+    }
+
     C_ATTR(redirect, :Local :AutoArgs)
     void redirect(Context *c) {
         c->response()->redirect(c->request()->queryParam(QStringLiteral("url")));
@@ -278,6 +294,73 @@ void TestResponse::testController_data()
                                           << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("1")} }
                                           << QByteArrayLiteral("5");
 
+    const QString etag = QStringLiteral("\"v1\"");
+    QTest::newRow("range-test00") << get << QStringLiteral("/response/test/rangeBody") << headers << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("10")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")} }
+                                  << QByteArrayLiteral("0123456789");
+
+    QTest::newRow("range-test01") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=2-5")} } << QByteArray()
+                                  << QByteArrayLiteral("206 Partial Content")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("4")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")},
+                                              {QStringLiteral("Content-Range"), QStringLiteral("bytes 2-5/10")} }
+                                  << QByteArrayLiteral("2345");
+
+    QTest::newRow("range-test02") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=7-")} } << QByteArray()
+                                  << QByteArrayLiteral("206 Partial Content")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("3")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")},
+                                              {QStringLiteral("Content-Range"), QStringLiteral("bytes 7-9/10")} }
+                                  << QByteArrayLiteral("789");
+
+    QTest::newRow("range-test03") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=-4")}, {QStringLiteral("If-Range"), etag} } << QByteArray()
+                                  << QByteArrayLiteral("206 Partial Content")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("4")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")},
+                                              {QStringLiteral("Content-Range"), QStringLiteral("bytes 6-9/10")} }
+                                  << QByteArrayLiteral("6789");
+
+    QTest::newRow("range-test04") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=20-30")} } << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("10")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")} }
+                                  << QByteArrayLiteral("0123456789");
+
+    QTest::newRow("range-test05") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=2-5")}, {QStringLiteral("If-Range"), QStringLiteral("\"v0\"")} } << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("10")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")} }
+                                  << QByteArrayLiteral("0123456789");
+
+    // Weak entity tags can't validate a range
+    QTest::newRow("range-test06") << get << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=2-5")}, {QStringLiteral("If-Range"), QStringLiteral("W/\"v1\"")} } << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("10")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")} }
+                                  << QByteArrayLiteral("0123456789");
+
+    QTest::newRow("range-test07") << post << QStringLiteral("/response/test/rangeBody")
+                                  << Headers{ {QStringLiteral("Range"), QStringLiteral("bytes=2-5")} } << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("10")}, {QStringLiteral("ETag"), etag},
+                                              {QStringLiteral("Accept-Ranges"), QStringLiteral("bytes")} }
+                                  << QByteArrayLiteral("0123456789");
+
+    // The test engine can't push so a preload hint is sent instead
+    QTest::newRow("push-test00") << get << QStringLiteral("/response/test/pushAsset") << headers << QByteArray()
+                                 << QByteArrayLiteral("200 OK")
+                                 << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("4")},
+                                             {QStringLiteral("Link"), QStringLiteral("</static/app.css>; rel=preload")} }
+                                 << QByteArrayLiteral("page");
+
     query.clear();
     query.addQueryItem(QStringLiteral("data"), QStringLiteral("appplication/json"));
     QTest::newRow("contentType-test00") << get << QStringLiteral("/response/test/contentType?") + query.toString(QUrl::FullyEncoded) << headers << QByteArray()
@@ -0,0 +1,734 @@
+#ifndef WSGISERVERTEST_H
+#define WSGISERVERTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QFile>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+
+#include "wsgi.h"
+#include "coverageobject.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace CWSGI;
+using namespace Cutelyst;
+
+namespace {
+
+inline qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Blocking POSIX client, it runs on its own thread so it never competes
+// with the server for an event loop
+class LoopbackClient
+{
+public:
+    explicit LoopbackClient(quint16 port) : m_port(port) {}
+    ~LoopbackClient() { disconnect(); }
+
+    bool connectToServer();
+    void disconnect();
+    bool send(const char *data, size_t len);
+    inline bool send(const std::string &data) { return send(data.data(), data.size()); }
+
+    // Reads a whole HTTP/1.1 response, returns its status or -1
+    int readResponse(std::string *body = nullptr);
+
+protected:
+    ssize_t fill();
+
+    std::string m_buf;
+    int m_fd = -1;
+    quint16 m_port;
+};
+
+bool LoopbackClient::connectToServer()
+{
+    m_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd == -1) {
+        return false;
+    }
+
+    // Generous, a SYN dropped by a full backlog is only retried after a second
+    const struct timeval timeout = { 10, 0 };
+    ::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(m_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    const int one = 1;
+    ::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(m_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+void LoopbackClient::disconnect()
+{
+    if (m_fd != -1) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_buf.clear();
+}
+
+bool LoopbackClient::send(const char *data, size_t len)
+{
+    while (len) {
+        const ssize_t ret = ::send(m_fd, data, len, MSG_NOSIGNAL);
+        if (ret <= 0) {
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += ret;
+        len -= size_t(ret);
+    }
+    return true;
+}
+
+ssize_t LoopbackClient::fill()
+{
+    char buf[65536];
+    ssize_t ret;
+    do {
+        ret = ::recv(m_fd, buf, sizeof(buf), 0);
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret > 0) {
+        m_buf.append(buf, size_t(ret));
+    }
+    return ret;
+}
+
+int LoopbackClient::readResponse(std::string *body)
+{
+    size_t headerEnd;
+    while ((headerEnd = m_buf.find("\r\n\r\n")) == std::string::npos) {
+        if (fill() <= 0) {
+            return -1;
+        }
+    }
+
+    if (m_buf.compare(0, 9, "HTTP/1.1 ") != 0) {
+        return -1;
+    }
+    const int status = atoi(m_buf.c_str() + 9);
+
+    qint64 length = -1;
+    size_t pos = 0;
+    while ((pos = m_buf.find("\r\n", pos)) < headerEnd) {
+        pos += 2;
+        if (strncasecmp(m_buf.c_str() + pos, "content-length:", 15) == 0) {
+            length = atoll(m_buf.c_str() + pos + 15);
+        }
+    }
+
+    const size_t bodyStart = headerEnd + 4;
+    if (length == -1) {
+        // Delimited by the server closing
+        while (fill() > 0) {}
+        length = qint64(m_buf.size() - bodyStart);
+    }
+
+    while (m_buf.size() < bodyStart + size_t(length)) {
+        if (fill() <= 0) {
+            return -1;
+        }
+    }
+
+    if (body) {
+        body->assign(m_buf, bodyStart, size_t(length));
+    }
+    m_buf.erase(0, bodyStart + size_t(length));
+    return status;
+}
+
+struct Http2Stream {
+    std::string path;
+    // RFC 9218 priority field value, sent when not empty
+    std::string priority;
+    quint32 id = 0;
+    int status = 0;
+    qint64 bytes = 0;
+    // Nanoseconds since the request went out
+    qint64 firstByte = -1;
+    qint64 finished = -1;
+};
+
+// Prior knowledge h2c client, requests only use the HPACK static table so it
+// doesn't need a dynamic one, and it returns window as soon as data arrives
+class Http2Client : public LoopbackClient
+{
+public:
+    explicit Http2Client(quint16 port) : LoopbackClient(port) {}
+
+    bool handshake(quint32 initialWindowSize);
+    bool request(Http2Stream &stream);
+    // Reads frames until every stream ended
+    bool run(std::vector<Http2Stream> &streams);
+
+private:
+    bool sendFrame(quint8 type, quint8 flags, quint32 streamId, const std::string &payload);
+    bool sendWindowUpdate(quint32 streamId, quint32 increment);
+
+    qint64 m_start = 0;
+    quint32 m_nextStreamId = 1;
+};
+
+bool Http2Client::sendFrame(quint8 type, quint8 flags, quint32 streamId, const std::string &payload)
+{
+    const quint32 len = quint32(payload.size());
+    const char header[9] = {
+        char(len >> 16), char(len >> 8), char(len),
+        char(type), char(flags),
+        char(streamId >> 24), char(streamId >> 16), char(streamId >> 8), char(streamId)
+    };
+    return send(header, sizeof(header)) && send(payload);
+}
+
+bool Http2Client::sendWindowUpdate(quint32 streamId, quint32 increment)
+{
+    const char payload[4] = { char(increment >> 24), char(increment >> 16), char(increment >> 8), char(increment) };
+    return sendFrame(0x8, 0, streamId, std::string(payload, sizeof(payload)));
+}
+
+bool Http2Client::handshake(quint32 initialWindowSize)
+{
+    const char settings[12] = {
+        0x00, 0x02, 0x00, 0x00, 0x00, 0x00, // SETTINGS_ENABLE_PUSH
+        0x00, 0x04, char(initialWindowSize >> 24), char(initialWindowSize >> 16), char(initialWindowSize >> 8), char(initialWindowSize)
+    };
+    return send(std::string("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n")) &&
+            sendFrame(0x4, 0, 0, std::string(settings, sizeof(settings)));
+}
+
+bool Http2Client::request(Http2Stream &stream)
+{
+    // Single byte lengths only
+    if (stream.path.size() > 126 || stream.priority.size() > 126) {
+        return false;
+    }
+
+    // :method GET, :scheme http, then literals without indexing
+    // for :authority and :path using their static table names
+    std::string block("\x82\x86", 2);
+    const std::string authority("127.0.0.1");
+    block.push_back(char(0x01));
+    block.push_back(char(authority.size()));
+    block.append(authority);
+    block.push_back(char(0x04));
+    block.push_back(char(stream.path.size()));
+    block.append(stream.path);
+    if (!stream.priority.empty()) {
+        block.append("\x00\x08priority", 10);
+        block.push_back(char(stream.priority.size()));
+        block.append(stream.priority);
+    }
+
+    if (!m_start) {
+        m_start = nowNs();
+    }
+    stream.id = m_nextStreamId;
+    m_nextStreamId += 2;
+    // END_STREAM | END_HEADERS
+    return sendFrame(0x1, 0x1 | 0x4, stream.id, block);
+}
+
+bool Http2Client::run(std::vector<Http2Stream> &streams)
+{
+    size_t open = streams.size();
+    while (open) {
+        while (m_buf.size() < 9) {
+            if (fill() <= 0) {
+                return false;
+            }
+        }
+        const auto header = reinterpret_cast<const quint8 *>(m_buf.data());
+        const quint32 len = quint32(header[0]) << 16 | quint32(header[1]) << 8 | header[2];
+        const quint8 type = header[3];
+        const quint8 flags = header[4];
+        const quint32 streamId = (quint32(header[5]) << 24 | quint32(header[6]) << 16 | quint32(header[7]) << 8 | header[8]) & 0x7FFFFFFF;
+        while (m_buf.size() < 9 + len) {
+            if (fill() <= 0) {
+                return false;
+            }
+        }
+        const std::string payload = m_buf.substr(9, len);
+        m_buf.erase(0, 9 + len);
+
+        if (type == 0x4) {
+            if (!(flags & 0x1) && !sendFrame(0x4, 0x1, 0, std::string())) {
+                return false;
+            }
+            continue;
+        } else if (type == 0x6) {
+            if (!(flags & 0x1) && !sendFrame(0x6, 0x1, 0, payload)) {
+                return false;
+            }
+            continue;
+        } else if (type == 0x7 || type == 0x3) {
+            // GOAWAY or RST_STREAM
+            return false;
+        } else if (type != 0x0 && type != 0x1) {
+            continue;
+        }
+
+        auto it = std::find_if(streams.begin(), streams.end(), [streamId] (const Http2Stream &stream) {
+            return stream.id == streamId;
+        });
+        if (it == streams.end()) {
+            return false;
+        }
+
+        size_t pos = 0;
+        size_t padding = 0;
+        if (flags & 0x8) {
+            padding = quint8(payload[0]);
+            pos = 1;
+        }
+
+        if (it->firstByte == -1) {
+            it->firstByte = nowNs() - m_start;
+        }
+
+        if (type == 0x1) {
+            if (flags & 0x20) {
+                // PRIORITY
+                pos += 5;
+            }
+            // Static table :status entries are all this server uses for them
+            static const int statuses[] = { 200, 204, 206, 304, 400, 404, 500 };
+            const quint8 first = quint8(payload[pos]);
+            if (first >= 0x88 && first <= 0x8e) {
+                it->status = statuses[first - 0x88];
+            }
+        } else if (len) {
+            it->bytes += qint64(len - pos - padding);
+            if (!sendWindowUpdate(0, len) || (!(flags & 0x1) && !sendWindowUpdate(streamId, len))) {
+                return false;
+            }
+        }
+
+        if (flags & 0x1) {
+            it->finished = nowNs() - m_start;
+            --open;
+        }
+    }
+    return true;
+}
+
+
+struct StormResult {
+    qint64 elapsed = 0;
+    int failures = 0;
+    // Connects that waited for a SYN retransmission
+    int retransmitted = 0;
+};
+
+// Every connection is opened before any request goes out, so they pile up
+// in the accept queue the way a reconnect wave does
+StormResult connectStorm(quint16 port, int threads, int connectionsPerThread)
+{
+    std::atomic<int> failures(0);
+    std::atomic<int> retransmitted(0);
+    const qint64 start = nowNs();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            std::vector<std::unique_ptr<LoopbackClient>> clients;
+            for (int j = 0; j < connectionsPerThread; ++j) {
+                std::unique_ptr<LoopbackClient> client(new LoopbackClient(port));
+                const qint64 begin = nowNs();
+                if (!client->connectToServer()) {
+                    ++failures;
+                    continue;
+                }
+                // The initial RTO is one second, loopback never gets near it
+                if (nowNs() - begin > 500000000) {
+                    ++retransmitted;
+                }
+                clients.push_back(std::move(client));
+            }
+
+            for (const auto &client : clients) {
+                if (!client->send(std::string("GET /bench/hello HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n")) ||
+                        client->readResponse() != 200) {
+                    ++failures;
+                }
+            }
+        });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    StormResult result;
+    result.elapsed = nowNs() - start;
+    result.failures = failures;
+    result.retransmitted = retransmitted;
+    return result;
+}
+
+}
+
+class BenchController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("bench")
+public:
+    explicit BenchController(QObject *parent) : Controller(parent) {}
+
+    C_ATTR(hello, :Local :AutoArgs)
+    void hello(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Hello World!"));
+    }
+
+    C_ATTR(blob, :Local :AutoArgs)
+    void blob(Context *c, const QString &size) {
+        c->response()->setBody(QByteArray(size.toInt(), 'x'));
+    }
+};
+
+class BenchApplication : public Application
+{
+    Q_OBJECT
+public:
+    // Each engine thread creates its own instance
+    Q_INVOKABLE explicit BenchApplication(QObject *parent = nullptr) : Application(parent) {}
+
+    virtual bool init() override {
+        new BenchController(this);
+        return true;
+    }
+};
+
+class TestWsgiServer : public CoverageObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchmarkKeepAlive_data();
+    void benchmarkKeepAlive();
+
+    void benchmarkConnectStorm_data();
+    void benchmarkConnectStorm();
+
+    void benchmarkHttp2Downloads_data();
+    void benchmarkHttp2Downloads();
+
+    void benchmarkHttp2Priority_data();
+    void benchmarkHttp2Priority();
+
+private:
+    WSGI *startServer(bool http2, bool nativeSockets, int listenBacklog, quint16 *port);
+    void stopServer(WSGI *wsgi);
+    void runClient(const std::function<void()> &client);
+};
+
+WSGI *TestWsgiServer::startServer(bool http2, bool nativeSockets, int listenBacklog, quint16 *port)
+{
+    QTcpServer probe;
+    if (!probe.listen(QHostAddress::LocalHost)) {
+        return nullptr;
+    }
+    *port = probe.serverPort();
+    probe.close();
+
+    auto wsgi = new WSGI(this);
+    const QStringList socket = { QStringLiteral("127.0.0.1:%1").arg(*port) };
+    if (http2) {
+        wsgi->setHttp2Socket(socket);
+    } else {
+        wsgi->setHttpSocket(socket);
+    }
+    // Threaded engines run on the EPoll dispatcher like a deployed
+    // server, which native sockets need
+    wsgi->setThreads(QStringLiteral("2"));
+    wsgi->setNativeSockets(nativeSockets);
+    if (listenBacklog) {
+        wsgi->setListenBacklog(listenBacklog);
+    }
+
+    if (!wsgi->start(new BenchApplication)) {
+        delete wsgi;
+        return nullptr;
+    }
+
+    // Engines start asynchronously, a first request waits for them
+    bool ready = false;
+    const quint16 serverPort = *port;
+    runClient([&ready, http2, serverPort] {
+        if (http2) {
+            Http2Client client(serverPort);
+            std::vector<Http2Stream> streams(1);
+            streams[0].path = "/bench/hello";
+            ready = client.connectToServer() && client.handshake(65535) && client.request(streams[0]) &&
+                    client.run(streams) && streams[0].status == 200;
+        } else {
+            LoopbackClient client(serverPort);
+            ready = client.connectToServer() &&
+                    client.send(std::string("GET /bench/hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")) &&
+                    client.readResponse() == 200;
+        }
+    });
+
+    if (!ready) {
+        stopServer(wsgi);
+        return nullptr;
+    }
+    return wsgi;
+}
+
+void TestWsgiServer::stopServer(WSGI *wsgi)
+{
+    bool stopped = false;
+    QEventLoop loop;
+    connect(wsgi, &WSGI::stopped, &loop, [&stopped, &loop] {
+        stopped = true;
+        loop.quit();
+    });
+    QTimer::singleShot(30 * 1000, &loop, &QEventLoop::quit);
+    wsgi->stop();
+    loop.exec();
+
+    // Engines still running would use the protocols WSGI owns
+    if (stopped) {
+        delete wsgi;
+    }
+}
+
+void TestWsgiServer::runClient(const std::function<void()> &client)
+{
+    // The listening sockets belong to this thread, so it keeps
+    // running its event loop while the client blocks
+    QEventLoop loop;
+    std::thread thread([&client, &loop] {
+        client();
+        QMetaObject::invokeMethod(&loop, "quit", Qt::QueuedConnection);
+    });
+    loop.exec();
+    thread.join();
+}
+
+void TestWsgiServer::benchmarkKeepAlive_data()
+{
+    QTest::addColumn<bool>("nativeSockets");
+    QTest::addColumn<int>("connections");
+
+    QTest::newRow("qtcpsocket-1") << false << 1;
+    QTest::newRow("qtcpsocket-8") << false << 8;
+    QTest::newRow("native-1") << true << 1;
+    QTest::newRow("native-8") << true << 8;
+}
+
+// Plaintext keep-alive through QTcpSocket or the native EPoll sockets
+void TestWsgiServer::benchmarkKeepAlive()
+{
+    QFETCH(bool, nativeSockets);
+    QFETCH(int, connections);
+
+    quint16 port;
+    WSGI *wsgi = startServer(false, nativeSockets, 0, &port);
+    QVERIFY(wsgi);
+
+    const int requests = 2000;
+    std::atomic<int> failures(0);
+    qint64 elapsed = 0;
+    runClient([&] {
+        const std::string request("GET /bench/hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+        const qint64 start = nowNs();
+        std::vector<std::thread> workers;
+        for (int i = 0; i < connections; ++i) {
+            workers.emplace_back([&] {
+                LoopbackClient client(port);
+                if (!client.connectToServer()) {
+                    failures += requests;
+                    return;
+                }
+
+                std::string body;
+                for (int j = 0; j < requests; ++j) {
+                    if (!client.send(request) || client.readResponse(&body) != 200 || body != "Hello World!") {
+                        failures += requests - j;
+                        return;
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        elapsed = nowNs() - start;
+    });
+
+    stopServer(wsgi);
+    QCOMPARE(failures.load(), 0);
+    // Time per request, one second over it gives requests/s
+    QTest::setBenchmarkResult(qreal(elapsed) / (qint64(connections) * requests), QTest::WalltimeNanoseconds);
+}
+
+void TestWsgiServer::benchmarkConnectStorm_data()
+{
+    QTest::addColumn<int>("listenBacklog");
+
+    // 8 threads opening 128 connections each
+    QTest::newRow("backlog-16") << 16;
+    QTest::newRow("backlog-100") << 100;
+    QTest::newRow("backlog-1024") << 1024;
+}
+
+void TestWsgiServer::benchmarkConnectStorm()
+{
+    QFETCH(int, listenBacklog);
+
+    quint16 port;
+    WSGI *wsgi = startServer(false, false, listenBacklog, &port);
+    QVERIFY(wsgi);
+
+    StormResult result;
+    runClient([&result, port] {
+        result = connectStorm(port, 8, 128);
+    });
+
+    stopServer(wsgi);
+    QCOMPARE(result.failures, 0);
+
+    // A backlog holding the whole storm must not drop a single SYN,
+    // unless the kernel caps it lower
+    QFile somaxconn(QStringLiteral("/proc/sys/net/core/somaxconn"));
+    if (listenBacklog >= 1024 && somaxconn.open(QFile::ReadOnly) &&
+            somaxconn.readAll().trimmed().toInt() >= listenBacklog) {
+        QCOMPARE(result.retransmitted, 0);
+    }
+    QTest::setBenchmarkResult(qreal(result.elapsed) / 1000000, QTest::WalltimeMilliseconds);
+}
+
+void TestWsgiServer::benchmarkHttp2Downloads_data()
+{
+    QTest::addColumn<quint32>("windowSize");
+
+    QTest::newRow("window-16384") << quint32(16384);
+    QTest::newRow("window-65535") << quint32(65535);
+}
+
+// Concurrent large downloads where every stream keeps running out of window
+void TestWsgiServer::benchmarkHttp2Downloads()
+{
+    QFETCH(quint32, windowSize);
+
+    quint16 port;
+    WSGI *wsgi = startServer(true, false, 0, &port);
+    QVERIFY(wsgi);
+
+    const qint64 size = 1048576;
+    std::vector<Http2Stream> streams(16);
+    bool ok = false;
+    runClient([&] {
+        Http2Client client(port);
+        ok = client.connectToServer() && client.handshake(windowSize);
+        for (auto &stream : streams) {
+            stream.path = "/bench/blob/" + std::to_string(size);
+            ok = ok && client.request(stream);
+        }
+        ok = ok && client.run(streams);
+    });
+
+    stopServer(wsgi);
+    QVERIFY(ok);
+    qint64 elapsed = 0;
+    for (const auto &stream : streams) {
+        QCOMPARE(stream.status, 200);
+        QCOMPARE(stream.bytes, size);
+        elapsed = qMax(elapsed, stream.finished);
+    }
+    QTest::setBenchmarkResult(qreal(elapsed) / 1000000, QTest::WalltimeMilliseconds);
+}
+
+void TestWsgiServer::benchmarkHttp2Priority_data()
+{
+    QTest::addColumn<QByteArray>("imagePriority");
+    QTest::addColumn<QByteArray>("stylePriority");
+
+    QTest::newRow("priority-none") << QByteArray() << QByteArray();
+    QTest::newRow("priority-urgency") << QByteArrayLiteral("u=5") << QByteArrayLiteral("u=1");
+}
+
+// A large image requested before the small style sheets of the same page,
+// measuring the slowest style sheet time to first byte
+void TestWsgiServer::benchmarkHttp2Priority()
+{
+    QFETCH(QByteArray, imagePriority);
+    QFETCH(QByteArray, stylePriority);
+
+    quint16 port;
+    WSGI *wsgi = startServer(true, false, 0, &port);
+    QVERIFY(wsgi);
+
+    std::vector<Http2Stream> streams(9);
+    streams[0].path = "/bench/blob/8388608";
+    streams[0].priority = imagePriority.toStdString();
+    for (size_t i = 1; i < streams.size(); ++i) {
+        streams[i].path = "/bench/blob/2048";
+        streams[i].priority = stylePriority.toStdString();
+    }
+
+    bool ok = false;
+    runClient([&] {
+        Http2Client client(port);
+        ok = client.connectToServer() && client.handshake(65535);
+        for (auto &stream : streams) {
+            ok = ok && client.request(stream);
+        }
+        ok = ok && client.run(streams);
+    });
+
+    stopServer(wsgi);
+    QVERIFY(ok);
+    qint64 firstByte = 0;
+    for (size_t i = 1; i < streams.size(); ++i) {
+        QCOMPARE(streams[i].status, 200);
+        QCOMPARE(streams[i].bytes, qint64(2048));
+        if (!stylePriority.isEmpty()) {
+            // More urgent streams aren't kept behind the image
+            QVERIFY(streams[i].finished < streams[0].finished);
+        }
+        firstByte = qMax(firstByte, streams[i].firstByte);
+    }
+    QCOMPARE(streams[0].bytes, qint64(8388608));
+    QTest::setBenchmarkResult(qreal(firstByte), QTest::WalltimeNanoseconds);
+}
+
+QTEST_MAIN(TestWsgiServer)
+#include "testwsgiserver.moc"
+
+#endif
@@ -122,12 +122,10 @@ bool uwsgiConnection::writeHeaders(quint16 status, const Headers &headers)
         return false;
     }
 
-    const auto headersData = headers.data();
-    auto it = headersData.constBegin();
-    const auto endIt = headersData.constEnd();
-    while (it != endIt) {
-        const QByteArray key = uWSGI::camelCaseHeader(it.key()).toLatin1();
-        const QByteArray value = it.value().toLatin1();
+    const auto &headersData = headers.entries();
+    for (const auto &entry : headersData) {
+        const QByteArray key = uWSGI::camelCaseHeader(entry.key).toLatin1();
+        const QByteArray value = entry.value.toLatin1();
 
         if (uwsgi_response_add_header(request,
                                       const_cast<char*>(key.constData()),
@@ -136,8 +134,6 @@ bool uwsgiConnection::writeHeaders(quint16 status, const Headers &headers)
                                       value.size())) {
             return false;
         }
-
-        ++it;
     }
 
     return true;
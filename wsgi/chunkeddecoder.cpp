@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2018 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "chunkeddecoder.h"
+
+#include <Cutelyst/Response>
+
+#include <cstring>
+
+using namespace CWSGI;
+
+ChunkedDecoder::ChunkedDecoder(qint64 _chunkLimit, qint64 _maxSize)
+    : chunkLimit(_chunkLimit)
+    , maxSize(_maxSize)
+{
+}
+
+qint64 ChunkedDecoder::decode(const char *data, qint64 len, quint16 *error, const Sink &sink)
+{
+    const char *ptr = data;
+    const char *end = data + len;
+    while (ptr < end) {
+        switch (state) {
+        case Size:
+        {
+            const char c = *ptr;
+            int digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else if (sizeDigits && (c == ';' || c == ' ' || c == '\t')) {
+                state = Extension;
+                break;
+            } else if (sizeDigits && c == '\r') {
+                state = SizeLf;
+                ++ptr;
+                break;
+            } else {
+                *error = Cutelyst::Response::BadRequest;
+                return -1;
+            }
+
+            if (remaining > chunkLimit / 16 || remaining * 16 > chunkLimit - digit) {
+                *error = Cutelyst::Response::RequestEntityTooLarge;
+                return -1;
+            }
+            remaining = remaining * 16 + digit;
+            sizeDigits = 1;
+            ++ptr;
+            break;
+        }
+        case Extension:
+        case Trailer:
+        {
+            auto cr = static_cast<const char *>(memchr(ptr, '\r', size_t(end - ptr)));
+            if (cr) {
+                state = state == Extension ? SizeLf : TrailerLf;
+                ptr = cr + 1;
+            } else {
+                ptr = end;
+            }
+            break;
+        }
+        case SizeLf:
+            if (*ptr++ != '\n') {
+                *error = Cutelyst::Response::BadRequest;
+                return -1;
+            }
+
+            if (remaining) {
+                size += remaining;
+                if (maxSize && size > maxSize) {
+                    *error = Cutelyst::Response::RequestEntityTooLarge;
+                    return -1;
+                }
+                state = Data;
+            } else {
+                state = TrailerStart;
+            }
+            break;
+        case Data:
+        {
+            const qint64 dataLen = qMin(remaining, qint64(end - ptr));
+            if (!sink(ptr, dataLen)) {
+                *error = Cutelyst::Response::InternalServerError;
+                return -1;
+            }
+            ptr += dataLen;
+
+            remaining -= dataLen;
+            if (!remaining) {
+                state = DataCr;
+            }
+            break;
+        }
+        case DataCr:
+        case DataLf:
+        case TrailerLf:
+        case LastLf:
+        {
+            const bool cr = state == DataCr;
+            if (*ptr++ != (cr ? '\r' : '\n')) {
+                *error = Cutelyst::Response::BadRequest;
+                return -1;
+            }
+
+            if (cr) {
+                state = DataLf;
+            } else if (state == DataLf) {
+                state = Size;
+                sizeDigits = 0;
+            } else if (state == TrailerLf) {
+                state = TrailerStart;
+            } else {
+                state = Done;
+                return ptr - data;
+            }
+            break;
+        }
+        case TrailerStart:
+            if (*ptr == '\r') {
+                state = LastLf;
+                ++ptr;
+            } else {
+                state = Trailer;
+            }
+            break;
+        case Done:
+            return ptr - data;
+        }
+    }
+
+    return len;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CHUNKEDDECODER_H
+#define CHUNKEDDECODER_H
+
+#include <QtGlobal>
+
+#include <functional>
+
+namespace CWSGI {
+
+/**
+ * Incremental RFC 9112 chunked body decoder, it keeps its state between
+ * calls so the encoded body can be split at any byte
+ */
+class ChunkedDecoder
+{
+public:
+    enum State : quint8 {
+        Size,
+        Extension,
+        SizeLf,
+        Data,
+        DataCr,
+        DataLf,
+        TrailerStart,
+        Trailer,
+        TrailerLf,
+        LastLf,
+        Done
+    };
+
+    // Receives the decoded chunk data, returning false aborts decoding
+    typedef std::function<bool(const char *data, qint64 len)> Sink;
+
+    ChunkedDecoder(qint64 chunkLimit = 1048576, qint64 maxSize = 0);
+
+    inline void reset() {
+        remaining = 0;
+        size = 0;
+        state = Size;
+        sizeDigits = 0;
+    }
+
+    inline bool isDone() const { return state == Done; }
+
+    // Chunk data goes to sink and trailers are skipped, returns the bytes
+    // consumed, which stops short of len only once the last chunk was
+    // parsed, or -1 with error set to the HTTP status to reply with
+    qint64 decode(const char *data, qint64 len, quint16 *error, const Sink &sink);
+
+    // Biggest single chunk, and total body size where 0 means no limit
+    qint64 chunkLimit;
+    qint64 maxSize;
+    // Decoded body size so far
+    qint64 size = 0;
+
+private:
+    qint64 remaining = 0;
+    State state = Size;
+    quint8 sizeDigits = 0;
+};
+
+}
+
+#endif // CHUNKEDDECODER_H
@@ -36,6 +36,11 @@
 #include "unixfork.h"
 #endif
 
+#ifdef Q_OS_LINUX
+#include <signal.h>
+#include <pthread.h>
+#endif
+
 #include <typeinfo>
 #include <iostream>
 
@@ -77,9 +82,23 @@ CWsgiEngine::CWsgiEngine(Application *localApp, int workerCore, const QVariantMa
         }
     }
 
-    if (m_wsgi->socketTimeout()) {
+    // Zero means the phase falls back to socket_timeout
+    const int socketTimeout = m_wsgi->socketTimeout();
+    m_socketTimeouts[TimeoutKeepAlive].timeout = qint64(m_wsgi->keepaliveTimeout() ? m_wsgi->keepaliveTimeout() : socketTimeout) * 1000;
+    m_socketTimeouts[TimeoutHeader].timeout = qint64(m_wsgi->headerTimeout() ? m_wsgi->headerTimeout() : socketTimeout) * 1000;
+    m_socketTimeouts[TimeoutBody].timeout = qint64(m_wsgi->bodyTimeout() ? m_wsgi->bodyTimeout() : socketTimeout) * 1000;
+
+    if (m_socketTimeouts[TimeoutKeepAlive].timeout ||
+            m_socketTimeouts[TimeoutHeader].timeout ||
+            m_socketTimeouts[TimeoutBody].timeout) {
+        m_timeoutClock.start();
+
+        // Reaping only looks at the head of each list, so a
+        // short tick is cheap no matter how many sockets are idle
         m_socketTimeout = new QTimer(this);
-        m_socketTimeout->setInterval(m_wsgi->socketTimeout() * 1000);
+        m_socketTimeout->setInterval(1000);
+        m_socketTimeout->setTimerType(Qt::CoarseTimer);
+        connect(m_socketTimeout, &QTimer::timeout, this, &CWsgiEngine::timeoutSockets);
     }
 }
 
@@ -90,6 +109,93 @@ CWsgiEngine::~CWsgiEngine()
     delete m_protoHttp2;
 }
 
+void CWsgiEngine::touchSocket(Socket *sock)
+{
+    if (!m_socketTimeout) {
+        return;
+    }
+
+    int list = -1;
+    if (!sock->processing) {
+        const ProtocolData *data = sock->protoData;
+        if (data->headerConnection == ProtocolData::HeaderConnectionUpgrade) {
+            list = TimeoutKeepAlive;
+        } else if (data->connState == ProtocolData::ContentBody) {
+            list = TimeoutBody;
+        } else if (data->connState == ProtocolData::HeaderLine ||
+                   (data->connState == ProtocolData::MethodLine && data->buf_size)) {
+            list = TimeoutHeader;
+        } else {
+            list = TimeoutKeepAlive;
+        }
+    } else if (sock->protoData->connState == ProtocolData::ContentBodyUnbuffered && sock->protoData->bodyPending() &&
+               !sock->protoData->bodyPaused) {
+        // Handlers reading the body as it arrives must not be pinned
+        // forever by a client that stopped sending it, while paused
+        // it's the handlers that aren't reading
+        list = TimeoutBody;
+    }
+
+    // The header timeout counts from the first byte of the request,
+    // so slow clients can't keep it alive by sending a byte at a time
+    if (list == TimeoutHeader && sock->timeoutList == TimeoutHeader) {
+        return;
+    }
+
+    removeSocketTimeout(sock);
+    if (list == -1 || !m_socketTimeouts[list].timeout) {
+        return;
+    }
+
+    // Every socket on a list has the same timeout, appending keeps it sorted
+    SocketTimeoutList &timeouts = m_socketTimeouts[list];
+    sock->timeoutList = qint8(list);
+    sock->timeoutDeadline = m_timeoutClock.elapsed() + timeouts.timeout;
+    sock->timeoutPrev = timeouts.last;
+    sock->timeoutNext = nullptr;
+    if (timeouts.last) {
+        timeouts.last->timeoutNext = sock;
+    } else {
+        timeouts.first = sock;
+    }
+    timeouts.last = sock;
+}
+
+void CWsgiEngine::removeSocketTimeout(Socket *sock)
+{
+    if (sock->timeoutList == -1) {
+        return;
+    }
+
+    SocketTimeoutList &timeouts = m_socketTimeouts[sock->timeoutList];
+    if (sock->timeoutPrev) {
+        sock->timeoutPrev->timeoutNext = sock->timeoutNext;
+    } else {
+        timeouts.first = sock->timeoutNext;
+    }
+    if (sock->timeoutNext) {
+        sock->timeoutNext->timeoutPrev = sock->timeoutPrev;
+    } else {
+        timeouts.last = sock->timeoutPrev;
+    }
+
+    sock->timeoutPrev = nullptr;
+    sock->timeoutNext = nullptr;
+    sock->timeoutList = -1;
+}
+
+void CWsgiEngine::timeoutSockets()
+{
+    const qint64 now = m_timeoutClock.elapsed();
+    for (SocketTimeoutList &timeouts : m_socketTimeouts) {
+        while (timeouts.first && timeouts.first->timeoutDeadline <= now) {
+            Socket *sock = timeouts.first;
+            removeSocketTimeout(sock);
+            sock->connectionClose();
+        }
+    }
+}
+
 int CWsgiEngine::workerId() const
 {
     return m_workerId;
@@ -103,9 +209,6 @@ void CWsgiEngine::setServers(const std::vector<QObject *> &servers)
             TcpServer *server = balancer->createServer(this);
             if (server) {
                 ++m_runningServers;
-                if (m_socketTimeout) {
-                    connect(m_socketTimeout, &QTimer::timeout, server, &TcpServer::timeoutConnections);
-                }
 
                 if (server->protocol()->type() == Protocol::Http11) {
                     server->setProtocol(getProtoHttp());
@@ -131,9 +234,6 @@ void CWsgiEngine::setServers(const std::vector<QObject *> &servers)
             LocalServer *server = localServer->createServer(this);
             if (server) {
                 ++m_runningServers;
-                if (m_socketTimeout) {
-                    connect(m_socketTimeout, &QTimer::timeout, server, &LocalServer::timeoutConnections);
-                }
 
                 if (server->protocol()->type() == Protocol::Http11) {
                     server->setProtocol(getProtoHttp());
@@ -155,6 +255,15 @@ void CWsgiEngine::postFork(int workerId)
     UnixFork::setSched(m_wsgi, workerId, workerCore());
 #endif
 
+#ifdef Q_OS_LINUX
+    // sendfile() has no MSG_NOSIGNAL, with SIGPIPE blocked on the worker
+    // threads a client that went away shows up as EPIPE
+    sigset_t pipeSet;
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, nullptr);
+#endif
+
     if (Q_LIKELY(postForkApplication())) {
         Q_EMIT started();
     } else {
@@ -171,6 +280,47 @@ QByteArray CWsgiEngine::dateHeader()
     return ret.toLatin1();
 }
 
+void CWsgiEngine::appendHeaderLine(QByteArray &buf, const QString &key, const QString &value)
+{
+    const int keySize = key.size();
+    const int valueSize = value.size();
+    const int pos = buf.size();
+    buf.resize(pos + keySize + valueSize + 4);
+
+    char *data = buf.data() + pos;
+    *data++ = '\r';
+    *data++ = '\n';
+
+    // Same rules as Engine::camelCaseHeader()
+    const QChar *keyData = key.constData();
+    bool lastWasLetter = false;
+    for (int i = 0; i < keySize; ++i) {
+        ushort c = keyData[i].unicode();
+        if (c == '_') {
+            c = '-';
+            lastWasLetter = false;
+        } else if (c >= 'A' && c <= 'Z') {
+            if (lastWasLetter) {
+                c += 0x20;
+            } else {
+                lastWasLetter = true;
+            }
+        } else if (c >= 'a' && c <= 'z') {
+            lastWasLetter = true;
+        }
+        *data++ = c > 0xff ? '?' : char(c);
+    }
+
+    *data++ = ':';
+    *data++ = ' ';
+
+    const QChar *valueData = value.constData();
+    for (int i = 0; i < valueSize; ++i) {
+        const ushort c = valueData[i].unicode();
+        *data++ = c > 0xff ? '?' : char(c);
+    }
+}
+
 Protocol *CWsgiEngine::getProtoHttp()
 {
     if (!m_protoHttp) {
@@ -29,6 +29,7 @@ class QTcpServer;
 namespace CWSGI {
 
 class TcpServer;
+class Socket;
 class Protocol;
 class ProtocolFastCGI;
 class ProtocolHttp;
@@ -59,6 +60,24 @@ public:
         return m_lastDate;
     }
 
+    /**
+     * Appends "\r\nHeader-Key: value" to \p buf converting the CGI
+     * like \p key to it's camel case form without temporaries.
+     */
+    static void appendHeaderLine(QByteArray &buf, const QString &key, const QString &value);
+
+    /**
+     * Puts \p sock at the end of the keep-alive, header or body idle
+     * list matching it's parser state, sockets being processed are
+     * not tracked. It's O(1) and should be called after each read.
+     */
+    void touchSocket(Socket *sock);
+
+    /**
+     * Removes \p sock from the idle list it's on, if any
+     */
+    void removeSocketTimeout(Socket *sock);
+
 Q_SIGNALS:
     void started();
     void shutdown();
@@ -86,6 +105,21 @@ protected:
     static QByteArray dateHeader();
 
 private:
+    enum SocketTimeoutType {
+        TimeoutKeepAlive = 0,
+        TimeoutHeader,
+        TimeoutBody
+    };
+
+    // Intrusive list of sockets sorted by deadline
+    struct SocketTimeoutList {
+        Socket *first = nullptr;
+        Socket *last = nullptr;
+        qint64 timeout = 0;
+    };
+
+    void timeoutSockets();
+
     friend class ProtocolHttp;
     friend class ProtocolFastCGI;
     friend class LocalServer;
@@ -102,6 +136,8 @@ private:
     QByteArray m_lastDate;
     QElapsedTimer m_lastDateTimer;
     QTimer *m_socketTimeout = nullptr;
+    QElapsedTimer m_timeoutClock;
+    SocketTimeoutList m_socketTimeouts[3];
     WSGI *m_wsgi;
     ProtocolHttp *m_protoHttp = nullptr;
     ProtocolHttp2 *m_protoHttp2 = nullptr;
@@ -22,13 +22,14 @@
 
 #include <vector>
 
+#include <QVarLengthArray>
 #include <QDebug>
 
 #define INT_MASK(bits) (1 << bits) - 1
 
 using namespace CWSGI;
 
-unsigned char* hpackDecodeString(unsigned char *src, unsigned char *src_end, QString &value, int len);
+static unsigned char *hpackDecodeHuffman(unsigned char *src, unsigned char *srcEnd, char *dst, int &dstLen);
 
 // This decodes an UInt
 // it returns nullptr if it tries to read past end
@@ -71,81 +72,170 @@ void encodeUInt16(QByteArray &buf, int I, quint8 mask)
     buf.append(char(I));
 }
 
-static inline void encodeH2caseHeader(QByteArray &buf, const QString &key) {
+// Encodes an integer with \p flags on the bits above the prefix \p mask
+static inline void encodePrefixedInt(QByteArray &buf, quint8 flags, int value, quint8 mask)
+{
+    const int pos = buf.size();
+    encodeUInt16(buf, value, mask);
+    buf[pos] = char(quint8(buf.at(pos)) | flags);
+}
+
+// Encodes a string literal, Huffman coded when that is shorter
+static void encodeString(QByteArray &buf, const QByteArray &str)
+{
+    quint64 bits = 0;
+    for (const char c : str) {
+        bits += HPackPrivate::huff_sym_table[quint8(c)].nbits;
+    }
+
+    const int huffmanSize = int((bits + 7) / 8);
+    if (huffmanSize >= str.size()) {
+        encodeUInt16(buf, str.size(), INT_MASK(7));
+        buf.append(str);
+        return;
+    }
+
+    encodePrefixedInt(buf, 0x80, huffmanSize, INT_MASK(7));
+    const int pos = buf.size();
+    buf.resize(pos + huffmanSize);
+    char *out = buf.data() + pos;
+
+    quint64 acc = 0;
+    int accBits = 0;
+    for (const char c : str) {
+        const HPackPrivate::HuffSym &sym = HPackPrivate::huff_sym_table[quint8(c)];
+        acc = (acc << sym.nbits) | sym.code;
+        accBits += int(sym.nbits);
+        while (accBits >= 8) {
+            accBits -= 8;
+            *out++ = char(acc >> accBits);
+        }
+        acc &= (quint64(1) << accBits) - 1;
+    }
+
+    if (accBits) {
+        // Padded with the most significant bits of EOS
+        *out = char((acc << (8 - accBits)) | (0xff >> accBits));
+    }
+}
+
+// Returns the static table index of the CGI like \p key name or 0
+static int staticNameIndex(const QString &key)
+{
+    const int len = key.size();
+    if (len == 0) {
+        return 0;
+    }
 
-    encodeUInt16(buf, key.length(), INT_MASK(7));
-    for (auto keyIt : key) {
-        if (keyIt.isLetter()) {
-            buf.append(keyIt.toLower().toLatin1());
-        } else if (keyIt == QLatin1Char('_')) {
-            buf.append('-');
+    const QChar *data = key.constData();
+    const uint hash = (51 * uint(len) + 20 * data[0].unicode() + 16 * data[len - 1].unicode() + 62 * data[len / 2].unicode()) % 128;
+    const int index = HPackPrivate::hpackStaticNameHash[hash];
+    if (index == 0) {
+        return 0;
+    }
+
+    const QString &name = HPackPrivate::hpackStaticHeaders[index].key;
+    if (name.size() != len) {
+        return 0;
+    }
+
+    const QChar *nameData = name.constData();
+    for (int i = 0; i < len; ++i) {
+        ushort c = data[i].unicode();
+        if (c >= 'A' && c <= 'Z') {
+            c |= 0x20;
+        } else if (c == '_') {
+            c = '-';
+        }
+        if (c != nameData[i].unicode()) {
+            return 0;
+        }
+    }
+    return index;
+}
+
+// Converts the CGI like CONTENT_TYPE key to it's content-type h2 name
+static inline QByteArray h2Name(const QString &key)
+{
+    const int len = key.size();
+    QByteArray name(len, Qt::Uninitialized);
+    const QChar *data = key.constData();
+    char *out = name.data();
+    for (int i = 0; i < len; ++i) {
+        const ushort c = data[i].unicode();
+        if (c >= 'A' && c <= 'Z') {
+            out[i] = char(c | 0x20);
+        } else if (c == '_') {
+            out[i] = '-';
         } else {
-            buf.append(keyIt.toLatin1());
+            out[i] = char(c);
         }
     }
+    return name;
 }
 
-unsigned char *parse_string(QString &dst, unsigned char *buf, quint8 *itEnd)
+// Decodes the string literal at \p buf into \p dst as Latin-1 bytes,
+// returns nullptr on a decoding error or when reading past \p itEnd
+static unsigned char *parse_bytes(QVarLengthArray<char, 1024> &dst, unsigned char *buf, quint8 *itEnd)
 {
     quint16 str_len = 0;
 
     bool huffmanDecode = *buf & 0x80;
 
     buf = decodeUInt16(buf, itEnd, str_len, INT_MASK(7));
-    if (!buf) {
-        return nullptr;
+    if (!buf || buf + str_len > itEnd) {
+        return nullptr; // Reading past end
     }
 
     if (huffmanDecode) {
-        buf = hpackDecodeString(buf, buf + str_len, dst, str_len);
+        // Each byte decodes to at most two symbols
+        dst.resize(str_len * 2);
+        int len;
+        buf = hpackDecodeHuffman(buf, buf + str_len, dst.data(), len);
         if (!buf) {
             return nullptr;
         }
+        dst.resize(len);
     } else {
-        if (buf + str_len <= itEnd) {
-            dst = QString::fromLatin1(reinterpret_cast<const char *>(buf), str_len);
-            buf += str_len;
-        } else {
-            return nullptr; // Reading past end
-        }
+        dst.resize(str_len);
+        memcpy(dst.data(), buf, str_len);
+        buf += str_len;
     }
     return buf;
 }
 
-unsigned char *parse_string_key(QString &dst, quint8 *buf, quint8 *itEnd)
+unsigned char *parse_string(QString &dst, unsigned char *buf, quint8 *itEnd)
 {
-    quint16 str_len = 0;
-    bool huffmanDecode = *buf & 0x80;
+    QVarLengthArray<char, 1024> bytes;
+    buf = parse_bytes(bytes, buf, itEnd);
+    if (buf) {
+        dst = QString::fromLatin1(bytes.constData(), bytes.size());
+    }
+    return buf;
+}
 
-    buf = decodeUInt16(buf, itEnd, str_len, INT_MASK(7));
+unsigned char *parse_string_key(QString &dst, quint8 *buf, quint8 *itEnd)
+{
+    QVarLengthArray<char, 1024> bytes;
+    buf = parse_bytes(bytes, buf, itEnd);
     if (!buf) {
         return nullptr;
     }
 
-    if (huffmanDecode) {
-        buf = hpackDecodeString(buf, buf + str_len, dst, str_len);
-        if (!buf) {
+    // Header names must be lower case
+    for (const char c : bytes) {
+        if (c >= 'A' && c <= 'Z') {
             return nullptr;
         }
-    } else {
-        if (buf + str_len <= itEnd) {
-            itEnd = buf + str_len;
-
-            while (buf < itEnd) {
-                QChar c = QLatin1Char(char(*(buf++)));
-                if (c.isUpper()) {
-                    return nullptr;
-                }
-                dst += c;
-            }
-        } else {
-            return nullptr; // Reading past end
-        }
     }
+
+    dst = QString::fromLatin1(bytes.constData(), bytes.size());
     return buf;
 }
 
 HPack::HPack(int maxTableSize) : m_currentMaxDynamicTableSize(maxTableSize), m_maxTableSize(maxTableSize)
+  , m_encoderMaxTableSize(qMin(maxTableSize, 4096))
+  , m_encoderSizeUpdate(m_encoderMaxTableSize != 4096)
 {
 
 }
@@ -155,8 +245,10 @@ HPack::~HPack()
 
 }
 
-void HPack::encodeHeaders(int status, const QHash<QString, QString> &headers, QByteArray &buf, CWsgiEngine *engine)
+void HPack::encodeHeaders(int status, const Cutelyst::Headers &headers, QByteArray &buf, CWsgiEngine *engine)
 {
+    encodeTableSizeUpdate(buf);
+
     if (status == 200) {
         buf.append(char(0x88));
     } else if (status == 204) {
@@ -179,46 +271,174 @@ void HPack::encodeHeaders(int status, const QHash<QString, QString> &headers, QB
         buf.append(statusStr);
     }
 
+    if (!encodeHeaderEntries(buf, headers)) {
+        const QByteArray date = engine->lastDate().mid(8);
+        if (date.length() != 29) {
+            // This should never happen but...
+            return;
+        }
+
+        // Changes every second, not worth a table entry
+        encodeField(buf, 33, QByteArray(), date, IndexingNone);
+    }
+}
+
+void HPack::encodePushHeaders(const QString &scheme, const QString &authority, const QString &path, const Cutelyst::Headers &headers, QByteArray &buf)
+{
+    encodeTableSizeUpdate(buf);
+
+    // :method GET and :scheme http/https are fully indexed
+    buf.append(char(0x82));
+    buf.append(char(scheme == QLatin1String("https") ? 0x87 : 0x86));
+
+    encodeField(buf, 1, QByteArrayLiteral(":authority"), authority.toLatin1(), IndexingIncremental);
+    encodeField(buf, 4, QByteArray(), path.toLatin1(), IndexingNone);
+
+    encodeHeaderEntries(buf, headers);
+}
+
+void HPack::setEncoderMaxTableSize(quint32 size)
+{
+    const int maxSize = int(qMin(size, quint32(qMin(m_maxTableSize, 4096))));
+    if (maxSize == m_encoderMaxTableSize) {
+        return;
+    }
+
+    m_encoderMaxTableSize = maxSize;
+    m_encoderSizeUpdate = true;
+    while (m_encoderTableSize > m_encoderMaxTableSize) {
+        encoderEvict();
+    }
+}
+
+// Returns true if a Date header was among the encoded headers
+bool HPack::encodeHeaderEntries(QByteArray &buf, const Cutelyst::Headers &headers)
+{
     bool hasDate = false;
-    auto it = headers.constBegin();
-    while (it != headers.constEnd()) {
-        const QString &key = it.key();
-        const QString &value = it.value();
-        if (!hasDate && key == QLatin1String("DATE")) {
+    const auto &entries = headers.entries();
+    for (const auto &entry : entries) {
+        const QString &key = entry.key;
+        const int nameIndex = staticNameIndex(key);
+
+        Indexing indexing = IndexingIncremental;
+        switch (nameIndex) {
+        case 23: // authorization
+        case 32: // cookie
+        case 49: // proxy-authorization
+        case 55: // set-cookie
+            indexing = IndexingNever;
+            break;
+        case 33: // date
             hasDate = true;
+            indexing = IndexingNone;
+            break;
+        case 21: // age
+        case 28: // content-length
+        case 30: // content-range
+        case 34: // etag
+        case 36: // expires
+        case 44: // last-modified
+        case 46: // location
+            // Values that change per response would only churn the table
+            indexing = IndexingNone;
+            break;
         }
 
-        auto staticIt = HPackPrivate::hpackStaticHeadersCode.constFind(key);
-        if (staticIt != HPackPrivate::hpackStaticHeadersCode.constEnd()) {
-            buf.append(staticIt.value(), 2);
-
-            encodeUInt16(buf, value.length(), INT_MASK(7));
-            buf.append(value.toLatin1());
+        if (nameIndex && indexing != IndexingIncremental) {
+            encodeField(buf, nameIndex, QByteArray(), entry.value.toLatin1(), indexing);
         } else {
-            buf.append('\x00');
-            encodeH2caseHeader(buf, key);
+            encodeField(buf, nameIndex, h2Name(key), entry.value.toLatin1(), indexing);
+        }
+    }
+    return hasDate;
+}
 
-            encodeUInt16(buf, value.length(), INT_MASK(7));
-            buf.append(value.toLatin1());
+void HPack::encodeField(QByteArray &buf, int nameIndex, const QByteArray &name, const QByteArray &value, Indexing indexing)
+{
+    QByteArray field;
+    if (indexing == IndexingIncremental) {
+        field.reserve(name.size() + 1 + value.size());
+        field.append(name);
+        field.append('\0');
+        field.append(value);
+
+        auto fieldIt = m_encoderFields.constFind(field);
+        if (fieldIt != m_encoderFields.constEnd()) {
+            encodePrefixedInt(buf, 0x80, encoderIndex(fieldIt.value()), INT_MASK(7));
+            return;
         }
 
-        ++it;
+        // Large values would evict most of the table for a single entry
+        if (field.size() - 1 + 32 > m_encoderMaxTableSize / 4) {
+            indexing = IndexingNone;
+        }
     }
 
-    if (!hasDate) {
-        const QByteArray date = engine->lastDate().mid(8);
-        if (date.length() != 29) {
-            // This should never happen but...
-            return;
+    if (nameIndex == 0 && !name.isEmpty()) {
+        auto nameIt = m_encoderNames.constFind(name);
+        if (nameIt != m_encoderNames.constEnd()) {
+            nameIndex = encoderIndex(nameIt.value());
         }
+    }
+
+    if (indexing == IndexingIncremental) {
+        encodePrefixedInt(buf, 0x40, nameIndex, INT_MASK(6));
+    } else if (indexing == IndexingNever) {
+        encodePrefixedInt(buf, 0x10, nameIndex, INT_MASK(4));
+    } else {
+        encodePrefixedInt(buf, 0x00, nameIndex, INT_MASK(4));
+    }
 
-        // 0f12 Date header not indexed
-        // 1d = date length: 29
-        buf.append("\x0f\x12\x1d", 3);
-        buf.append(date);
+    if (nameIndex == 0) {
+        encodeString(buf, name);
+    }
+    encodeString(buf, value);
+
+    if (indexing == IndexingIncremental) {
+        encoderInsert(field, name.size());
+    }
+}
+
+void HPack::encodeTableSizeUpdate(QByteArray &buf)
+{
+    if (m_encoderSizeUpdate) {
+        encodePrefixedInt(buf, 0x20, m_encoderMaxTableSize, INT_MASK(5));
+        m_encoderSizeUpdate = false;
     }
 }
 
+void HPack::encoderInsert(const QByteArray &field, int nameSize)
+{
+    const int size = field.size() - 1 + 32;
+    while (m_encoderTableSize + size > m_encoderMaxTableSize && !m_encoderTable.empty()) {
+        encoderEvict();
+    }
+
+    const quint64 id = m_encoderInserted++;
+    m_encoderTable.push_front({ field, nameSize, id });
+    m_encoderFields.insert(field, id);
+    m_encoderNames.insert(field.left(nameSize), id);
+    m_encoderTableSize += size;
+}
+
+void HPack::encoderEvict()
+{
+    const EncoderEntry &entry = m_encoderTable.back();
+
+    auto fieldIt = m_encoderFields.find(entry.field);
+    if (fieldIt != m_encoderFields.end() && fieldIt.value() == entry.id) {
+        m_encoderFields.erase(fieldIt);
+    }
+
+    auto nameIt = m_encoderNames.find(entry.field.left(entry.nameSize));
+    if (nameIt != m_encoderNames.end() && nameIt.value() == entry.id) {
+        m_encoderNames.erase(nameIt);
+    }
+
+    m_encoderTableSize -= entry.field.size() - 1 + 32;
+    m_encoderTable.pop_back();
+}
+
 enum ErrorCodes {
     ErrorNoError = 0x0,
     ErrorProtocolError = 0x1,
@@ -281,6 +501,27 @@ inline void consumeHeader(const QString &k, const QString &v, H2Stream *stream)
     }
 }
 
+inline void pushStreamHeader(Cutelyst::Headers &headers, const QString &k, const QString &v)
+{
+    // Keys were validated to be lower case Latin-1, so well known
+    // ones can be stored in their slot without normalizing the key
+    const int size = k.size();
+    if (size <= 32) {
+        char latin1[32];
+        const QChar *data = k.constData();
+        for (int i = 0; i < size; ++i) {
+            latin1[i] = char(data[i].unicode());
+        }
+
+        const int known = Cutelyst::Headers::knownHeader(latin1, size);
+        if (known != -1) {
+            headers.pushRawHeader(Cutelyst::Headers::KnownHeader(known), v);
+            return;
+        }
+    }
+    headers.pushHeader(k, v);
+}
+
 int HPack::decode(unsigned char *it, unsigned char *itEnd, H2Stream *stream)
 {
     bool pseudoHeadersAllowed = true;
@@ -323,7 +564,7 @@ int HPack::decode(unsigned char *it, unsigned char *itEnd, H2Stream *stream)
                 }
                 pseudoHeadersAllowed = false;
                 consumeHeader(key, value, stream);
-                stream->headers.pushHeader(key, value);
+                pushStreamHeader(stream->headers, key, value);
             }
         } else {
             bool addToDynamicTable = false;
@@ -389,7 +630,7 @@ int HPack::decode(unsigned char *it, unsigned char *itEnd, H2Stream *stream)
                 }
                 pseudoHeadersAllowed = false;
                 consumeHeader(key, value, stream);
-                stream->headers.pushHeader(key, value);
+                pushStreamHeader(stream->headers, key, value);
             }
 
             if (addToDynamicTable) {
@@ -418,47 +659,38 @@ int HPack::decode(unsigned char *it, unsigned char *itEnd, H2Stream *stream)
     return 0;
 }
 
-unsigned char* hpackDecodeString(unsigned char *src, unsigned char *src_end, QString &value, int len)
+// Consumes a whole byte per step, writing the decoded Latin-1 symbols
+// to \p dst which must have room for two symbols per input byte
+static unsigned char *hpackDecodeHuffman(unsigned char *src, unsigned char *srcEnd, char *dst, int &dstLen)
 {
-      quint8 state = 0;
-      const HPackPrivate::HuffDecode *entry = nullptr;
-      value.reserve(len * 2); // max compression ratio is >= 0.5
-
-      do {
-          if (entry) {
-              state = entry->state;
-          }
-          entry = HPackPrivate::huff_decode_table[state] + (*src >> 4);
-
-          if (entry->flags & HPackPrivate::HUFF_FAIL) {
-              // A decoder decoded an invalid Huffman sequence
-              return nullptr;
-          }
-
-          if (entry->flags & HPackPrivate::HUFF_SYM) {
-              value.append(QLatin1Char(char(entry->sym)));
-          }
-
-          entry = HPackPrivate::huff_decode_table[entry->state] + (*src & 0x0f);
-
-          if (entry->flags & HPackPrivate::HUFF_FAIL) {
-              // A decoder decoded an invalid Huffman sequence
-              return nullptr;
-          }
-
-          if ((entry->flags & HPackPrivate::HUFF_SYM) != 0) {
-              value.append(QLatin1Char(char(entry->sym)));
-          }
+    const HPackPrivate::HuffDecodeByte *table = HPackPrivate::huffDecodeByteTable();
+    char *out = dst;
+    quint8 state = 0;
+    bool accepted = true;
+
+    for (; src < srcEnd; ++src) {
+        const HPackPrivate::HuffDecodeByte &entry = table[state << 8 | *src];
+        if (entry.flags & HPackPrivate::HUFF_FAIL) {
+            // A decoder decoded an invalid Huffman sequence
+            return nullptr;
+        }
 
-      } while (++src < src_end);
+        if (entry.symCount) {
+            *out++ = char(entry.sym[0]);
+            if (entry.symCount > 1) {
+                *out++ = char(entry.sym[1]);
+            }
+        }
 
-//      qDebug() << "maybe_eos = " << ((entry->flags & HPackPrivate::HUFF_ACCEPTED) != 0) << "entry->state =" << entry->state;
+        state = entry.state;
+        accepted = entry.flags & HPackPrivate::HUFF_ACCEPTED;
+    }
 
-      if ((entry->flags & HPackPrivate::HUFF_ACCEPTED) == 0) {
-          // entry->state == 28 // A invalid header name or value character was coded
-          // entry->state != 28 // A decoder decoded an invalid Huffman sequence
-          return nullptr;
-      }
+    if (!accepted) {
+        // Invalid padding or EOS, or a partial symbol at the end
+        return nullptr;
+    }
 
-      return src_end;
+    dstLen = int(out - dst);
+    return srcEnd;
 }
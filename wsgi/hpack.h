@@ -22,6 +22,8 @@
 #include <QVector>
 #include <QHash>
 
+#include <deque>
+
 namespace Cutelyst {
 class Headers;
 }
@@ -42,11 +44,52 @@ public:
     HPack(int maxTableSize);
     ~HPack();
 
-    void encodeHeaders(int status, const QHash<QString, QString> &headers, QByteArray &buf, CWSGI::CWsgiEngine *engine);
+    void encodeHeaders(int status, const Cutelyst::Headers &headers, QByteArray &buf, CWSGI::CWsgiEngine *engine);
+
+    void encodePushHeaders(const QString &scheme, const QString &authority, const QString &path, const Cutelyst::Headers &headers, QByteArray &buf);
+
+    /**
+     * Sets the maximum size of the table used to encode headers, as
+     * limited by the peer's SETTINGS_HEADER_TABLE_SIZE
+     */
+    void setEncoderMaxTableSize(quint32 size);
 
     int decode(unsigned char *it, unsigned char *itEnd, H2Stream *stream);
 
 private:
+    enum Indexing {
+        IndexingIncremental,
+        IndexingNone,
+        IndexingNever
+    };
+
+    struct EncoderEntry {
+        // lower case name, '\0' and value
+        QByteArray field;
+        int nameSize;
+        quint64 id;
+    };
+
+    bool encodeHeaderEntries(QByteArray &buf, const Cutelyst::Headers &headers);
+    void encodeField(QByteArray &buf, int nameIndex, const QByteArray &name, const QByteArray &value, Indexing indexing);
+    void encodeTableSizeUpdate(QByteArray &buf);
+    void encoderInsert(const QByteArray &field, int nameSize);
+    void encoderEvict();
+
+    inline int encoderIndex(quint64 id) const {
+        return int(62 + (m_encoderInserted - 1 - id));
+    }
+
+    // Encoder side dynamic table, newest entry first, the hashes
+    // map to the id of the newest entry with that field or name
+    std::deque<EncoderEntry> m_encoderTable;
+    QHash<QByteArray, quint64> m_encoderFields;
+    QHash<QByteArray, quint64> m_encoderNames;
+    quint64 m_encoderInserted = 0;
+    int m_encoderTableSize = 0;
+    int m_encoderMaxTableSize;
+    bool m_encoderSizeUpdate;
+
     QVector<DynamicTableEntry> m_dynamicTable;
     int m_dynamicTableSize = 0;
     int m_currentMaxDynamicTableSize = 0;
@@ -27,54 +27,7 @@
 
 #include "hpack_p.h"
 
-const QHash<QString, const char *> HPackPrivate::hpackStaticHeadersCode = {
-    {QStringLiteral("ACCEPT_CHARSET"), "\x0f\x00"},
-    {QStringLiteral("ACCEPT_LANGUAGE"), "\x0f\x02"},
-    {QStringLiteral("ACCEPT_RANGES"), "\x0f\x03"},
-    {QStringLiteral("ACCEPT"), "\x0f\x04"},
-    {QStringLiteral("ACCESS_CONTROL_ALLOW_ORIGIN"), "\x0f\x05"},
-    {QStringLiteral("AGE"), "\x0f\x06"},
-    {QStringLiteral("ALLOW"), "\x0f\x07"},
-    {QStringLiteral("AUTHORIZATION"), "\x0f\x08"},
-    {QStringLiteral("CACHE_CONTROL"), "\x0f\x09"},
-    {QStringLiteral("CONTENT_DISPOSITION"), "\x0f\x0a"},
-    {QStringLiteral("CONTENT_ENCODING"), "\x0f\x0b"},
-    {QStringLiteral("CONTENT_LANGUAGE"), "\x0f\x0c"},
-    {QStringLiteral("CONTENT_LENGTH"), "\x0f\x0d"},
-    {QStringLiteral("CONTENT_LOCATION"), "\x0f\x0e"},
-    {QStringLiteral("CONTENT_RANGE"), "\x0f\x0f"},
-    {QStringLiteral("CONTENT_TYPE"), "\x0f\x10"},
-    {QStringLiteral("COOKIE"), "\x0f\x11"},
-    {QStringLiteral("DATE"), "\x0f\x12"},
-    {QStringLiteral("ETAG"), "\x0f\x13"},
-    {QStringLiteral("EXPECT"), "\x0f\x14"},
-    {QStringLiteral("EXPIRES"), "\x0f\x15"},
-    {QStringLiteral("FROM"), "\x0f\x16"},
-    {QStringLiteral("HOST"), "\x0f\x17"},
-    {QStringLiteral("IF_MATCH"), "\x0f\x18"},
-    {QStringLiteral("IF_MODIFIED_SINCE"), "\x0f\x19"},
-    {QStringLiteral("IF_NONE_MATCH"), "\x0f\x1a"},
-    {QStringLiteral("IF_RANGE"), "\x0f\x1b"},
-    {QStringLiteral("IF_UNMODIFIED_SINCE"), "\x0f\x1c"},
-    {QStringLiteral("LAST_MODIFIED"), "\x0f\x1d"},
-    {QStringLiteral("LINK"), "\x0f\x1e"},
-    {QStringLiteral("LOCATION"), "\x0f\x1f"},
-    {QStringLiteral("MAX_FORWARDS"), "\x0f\x20"},
-    {QStringLiteral("PROXY_AUTHENTICATE"), "\x0f\x21"},
-    {QStringLiteral("PROXY_AUTHORIZATION"), "\x0f\x22"},
-    {QStringLiteral("RANGE"), "\x0f\x23"},
-    {QStringLiteral("REFERER"), "\x0f\x24"},
-    {QStringLiteral("REFRESH"), "\x0f\x25"},
-    {QStringLiteral("RETRY_AFTER"), "\x0f\x26"},
-    {QStringLiteral("SERVER"), "\x0f\x27"},
-    {QStringLiteral("SET_COOKIE"), "\x0f\x28"},
-    {QStringLiteral("STRICT_TRANSPORT_SECURITY"), "\x0f\x29"},
-    {QStringLiteral("TRANSFER_ENCODING"), "\x0f\x2a"},
-    {QStringLiteral("USER_AGENT"), "\x0f\x2b"},
-    {QStringLiteral("VARY"), "\x0f\x2c"},
-    {QStringLiteral("VIA"), "\x0f\x2d"},
-    {QStringLiteral("WWW_AUTHENTICATE"), "\x0f\x2e"}
-};
+#include <vector>
 
 const HPackPrivate::hpackStaticPair HPackPrivate::hpackStaticHeaders[] = {
     {QString(), QString()},
@@ -141,6 +94,17 @@ const HPackPrivate::hpackStaticPair HPackPrivate::hpackStaticHeaders[] = {
     {QStringLiteral("www-authenticate"), QString()}
 };
 
+const quint8 HPackPrivate::hpackStaticNameHash[128] = {
+     0, 41, 61,  0,  0,  0,  0,  0, 28,  0, 39,  0, 35,  0,  0, 60,
+     0,  0, 26, 25,  0, 40, 48,  0,  0,  0,  0, 50,  0,  0,  0,  0,
+    58,  0, 54, 51, 27,  0,  0, 36,  0, 52,  0,  0,  0,  0,  0, 21,
+     0,  0,  0,  0, 29,  0, 37, 16,  0, 23,  0, 53, 19, 20,  0,  0,
+    46, 43,  0,  0, 33,  0, 38,  0, 31, 17,  0,  0,  0, 24,  0,  0,
+    45,  0,  0,  0,  0,  0,  0,  0, 15, 49, 42,  0,  0, 18, 34,  0,
+     0,  0,  0,  0,  0, 57,  0, 56, 32, 44,  0, 22, 55,  0,  0,  0,
+    59,  0,  0,  0, 47,  0,  0,  0,  0,  0,  0, 30,  0,  0,  0,  0
+};
+
 const HPackPrivate::HuffSym HPackPrivate::huff_sym_table[] = {
   { 13, 0x1ff8u },
   { 23, 0x7fffd8u },
@@ -5267,3 +5231,37 @@ const HPackPrivate::HuffDecode HPackPrivate::huff_decode_table[][16] = {
     {0, 0x04, 0},
   },
 };
+
+const HPackPrivate::HuffDecodeByte *HPackPrivate::huffDecodeByteTable()
+{
+    static const std::vector<HuffDecodeByte> table = [] {
+        std::vector<HuffDecodeByte> ret(256 * 256);
+        for (int state = 0; state < 256; ++state) {
+            for (int byte = 0; byte < 256; ++byte) {
+                HuffDecodeByte &entry = ret[size_t(state << 8 | byte)];
+                entry = { 0, HUFF_FAIL, 0, { 0, 0 } };
+
+                const HuffDecode &high = huff_decode_table[state][byte >> 4];
+                if (high.flags & HUFF_FAIL) {
+                    continue;
+                }
+                const HuffDecode &low = huff_decode_table[high.state][byte & 0x0f];
+                if (low.flags & HUFF_FAIL) {
+                    continue;
+                }
+
+                entry.state = low.state;
+                entry.flags = low.flags & HUFF_ACCEPTED;
+                if (high.flags & HUFF_SYM) {
+                    entry.sym[entry.symCount++] = high.sym;
+                }
+                if (low.flags & HUFF_SYM) {
+                    entry.sym[entry.symCount++] = low.sym;
+                }
+            }
+        }
+        return ret;
+    }();
+
+    return table.data();
+}
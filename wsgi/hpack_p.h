@@ -51,11 +51,34 @@ public:
         QString value;
     } hpackStaticPair;
 
-    static const QHash<QString, const char *> hpackStaticHeadersCode;
     static const hpackStaticPair hpackStaticHeaders[];
 
+    /**
+     * Perfect hash of the normalized (CONTENT_TYPE) names of the static table,
+     * (51 * len + 20 * key[0] + 16 * key[len - 1] + 62 * key[len / 2]) % 128
+     * gives the static table index for that name or 0
+     */
+    static const quint8 hpackStaticNameHash[128];
+
+    /**
+     * Transition of the huffman decoding FSA when consuming a whole byte,
+     * it emits up to two symbols as the shortest code has 5 bits
+     */
+    struct HuffDecodeByte {
+        quint8 state,
+               flags, // HUFF_ACCEPTED or HUFF_FAIL
+               symCount,
+               sym[2];
+    };
+
     static const HuffSym huff_sym_table[];
     static const HuffDecode huff_decode_table[][16];
+
+    /**
+     * Returns the 256 x 256 table indexed by (state << 8 | byte), built
+     * on first use by chaining two steps of huff_decode_table
+     */
+    static const HuffDecodeByte *huffDecodeByteTable();
 };
 
 #endif // HPACK_P_H
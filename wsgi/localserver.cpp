@@ -103,9 +103,11 @@ void LocalServer::incomingConnection(quintptr handle)
         sock = new LocalSocket(m_engine, this);
         sock->protoData = m_protocol->createData(sock);
 
-        connect(sock, &QIODevice::readyRead, [sock] () {
-            sock->timeout = false;
+        connect(sock, &QIODevice::readyRead, [this, sock] () {
             sock->proto->parse(sock, sock);
+            if (sock->state() == QLocalSocket::ConnectedState) {
+                m_engine->touchSocket(sock);
+            }
         });
         connect(sock, &LocalSocket::finished, this, [this, sock] () {
             sock->resetSocket();
@@ -123,6 +125,7 @@ void LocalServer::incomingConnection(quintptr handle)
         if (++m_processing) {
             m_engine->startSocketTimeout();
         }
+        m_engine->touchSocket(sock);
     } else {
         m_socks.push_back(sock);
     }
@@ -160,23 +163,6 @@ void LocalServer::shutdown()
     }
 }
 
-void LocalServer::timeoutConnections()
-{
-    if (m_processing) {
-        const auto childrenL = children();
-        for (auto child : childrenL) {
-            auto socket = qobject_cast<LocalSocket*>(child);
-            if (socket && !socket->processing && socket->state() == QLocalSocket::ConnectedState) {
-                if (socket->timeout) {
-                    socket->connectionClose();
-                } else {
-                    socket->timeout = true;
-                }
-            }
-        }
-    }
-}
-
 Protocol *LocalServer::protocol() const
 {
     return m_protocol;
@@ -17,9 +17,83 @@
  */
 #include "postunbuffered.h"
 
+#include <QPointer>
+
+#include <cstring>
+
 PostUnbuffered::PostUnbuffered(QObject *parent) : QIODevice(parent)
 {
+    // Unbuffered so that consumed() reports what the application actually read
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+void PostUnbuffered::append(const char *data, qint64 len, bool last)
+{
+    if (m_offset == m_buffer.size()) {
+        m_buffer.resize(0);
+        m_offset = 0;
+    } else if (m_offset > m_buffer.size() / 2) {
+        m_buffer.remove(0, m_offset);
+        m_offset = 0;
+    }
+    m_buffer.append(data, int(len));
+    m_finished = last;
+
+    QPointer<PostUnbuffered> guard(this);
+    Q_EMIT readyRead();
+    if (last && guard) {
+        Q_EMIT readChannelFinished();
+    }
+}
 
+void PostUnbuffered::setFinished()
+{
+    m_finished = true;
+    Q_EMIT readChannelFinished();
+}
+
+bool PostUnbuffered::isSequential() const
+{
+    return true;
+}
+
+qint64 PostUnbuffered::bytesAvailable() const
+{
+    return m_buffer.size() - m_offset + QIODevice::bytesAvailable();
+}
+
+bool PostUnbuffered::atEnd() const
+{
+    return m_finished && m_offset == m_buffer.size();
+}
+
+qint64 PostUnbuffered::size() const
+{
+    return m_contentLength == -1 ? bytesAvailable() : m_contentLength;
+}
+
+qint64 PostUnbuffered::readData(char *data, qint64 maxlen)
+{
+    const qint64 len = qMin(maxlen, qint64(m_buffer.size() - m_offset));
+    if (len == 0) {
+        return m_finished ? -1 : 0;
+    }
+
+    memcpy(data, m_buffer.constData() + m_offset, size_t(len));
+    m_offset += int(len);
+
+    if (consumed) {
+        consumed(len);
+    }
+
+    return len;
+}
+
+qint64 PostUnbuffered::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return -1;
 }
 
 #include "moc_postunbuffered.cpp"
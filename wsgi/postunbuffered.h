@@ -20,13 +20,48 @@
 
 #include <QIODevice>
 
+#include <functional>
+
+/**
+ * Sequential read only request body that is filled by the protocol
+ * while the application is already processing the request, it can't
+ * be waited on, handlers call Context::detachAsync() and read it as
+ * readyRead() is emitted
+ */
 class PostUnbuffered : public QIODevice
 {
     Q_OBJECT
 public:
     explicit PostUnbuffered(QObject *parent = 0);
 
-    qint64 m_contentLength = 0;
+    // Appends data received from the client and emits readyRead(), the
+    // handlers might finish the request and delete this device
+    void append(const char *data, qint64 len, bool last = false);
+
+    // No more data will be appended, emits readChannelFinished()
+    void setFinished();
+
+    inline bool isFinished() const { return m_finished; }
+
+    virtual bool isSequential() const override;
+    virtual qint64 bytesAvailable() const override;
+    virtual bool atEnd() const override;
+    virtual qint64 size() const override;
+
+    // Called with the number of bytes the application read,
+    // allowing the protocol to ask the client for more
+    std::function<void(qint64)> consumed;
+
+    qint64 m_contentLength = -1;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) override;
+    virtual qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QByteArray m_buffer;
+    int m_offset = 0;
+    bool m_finished = false;
 };
 
 #endif // POSTUNBUFFERED_H
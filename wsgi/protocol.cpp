@@ -45,6 +45,7 @@ Protocol::Protocol(WSGI *wsgi)
 {
     m_bufferSize = wsgi->bufferSize();
     m_postBuffering = wsgi->postBuffering();
+    m_postUnbuffered = wsgi->postUnbuffered();
     m_postBufferSize = qMax(static_cast<qint64>(32), wsgi->postBufferingBufsize());
     m_postBuffer = new char[wsgi->postBufferingBufsize()];
 }
@@ -85,4 +86,20 @@ QIODevice *Protocol::createBody(qint64 contentLength) const
     return body;
 }
 
+bool Protocol::writeBody(QIODevice *&body, const char *data, qint64 len) const
+{
+    auto buffer = qobject_cast<QBuffer *>(body);
+    if (buffer && m_postBuffering && buffer->size() + len > m_postBuffering) {
+        auto temp = new QTemporaryFile;
+        if (!temp->open() || temp->write(buffer->data()) != buffer->size()) {
+            qCWarning(CWSGI_PROTO) << "Failed to open temporary file to store post" << temp->errorString();
+            delete temp;
+            return false;
+        }
+        delete buffer;
+        body = temp;
+    }
+    return body->write(data, len) == len;
+}
+
 #include "moc_protocol.cpp"
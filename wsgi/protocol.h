@@ -47,6 +47,7 @@ public:
         MethodLine = 0,
         HeaderLine,
         ContentBody,
+        ContentBodyUnbuffered,
         H2Frames
     };
     Q_ENUM(ParserState)
@@ -56,9 +57,13 @@ public:
         buf_size = 0;
         headerConnection = HeaderConnectionNotSet;
         headerHost = false;
+        bodyPaused = false;
     }
 
     virtual void socketDisconnected() {}
+
+    // True while the request body is still being received
+    inline virtual bool bodyPending() const { return false; }
     virtual void setupNewConnection(Socket *sock) = 0;
 
     qint64 contentLength;
@@ -70,6 +75,8 @@ public:
     HeaderConnection headerConnection = HeaderConnectionNotSet;
     char *buffer;
     bool headerHost = false;
+    // Reading the body waits for the handlers to consume what they have
+    bool bodyPaused = false;
 };
 
 class Protocol
@@ -93,8 +100,13 @@ public:
 
     QIODevice *createBody(qint64 contentLength) const;
 
+    // Appends to a body created without knowing its size, moving it
+    // to a temporary file once it grows past post buffering
+    bool writeBody(QIODevice *&body, const char *data, qint64 len) const;
+
     qint64 m_postBufferSize;
     qint64 m_postBuffering;
+    bool m_postUnbuffered;
     int m_bufferSize;
     char *m_postBuffer;
 };
@@ -159,10 +159,15 @@ quint16 ProtocolFastCGI::addHeader(ProtoRequestFastCGI *request, const char *key
         if (!request->headerHost && memcmp(key + 5, "HOST", 4) == 0) {
             request->serverAddress = value;
             request->headerHost = true;
-            request->headers.pushRawHeader(QStringLiteral("HOST"), value);
+            request->headers.pushRawHeader(Cutelyst::Headers::Host, value);
         } else {
-            const QString keyStr = QString::fromLatin1(key + 5, keylen - 5);
-            request->headers.pushRawHeader(keyStr, value);
+            const int known = Cutelyst::Headers::knownHeader(key + 5, keylen - 5);
+            if (known != -1) {
+                request->headers.pushRawHeader(Cutelyst::Headers::KnownHeader(known), value);
+            } else {
+                const QString keyStr = QString::fromLatin1(key + 5, keylen - 5);
+                request->headers.pushRawHeader(keyStr, value);
+            }
         }
     } else if (memcmp(key, "REQUEST_METHOD", 14) == 0) {
         request->method = QString::fromLatin1(val, vallen);
@@ -356,6 +361,11 @@ qint64 ProtocolFastCGI::readBody(Socket *sock, QIODevice *io, qint64 bytesAvaila
 
 void ProtocolFastCGI::parse(Socket *sock, QIODevice *io) const
 {
+    if (sock->processing) {
+        // A detached request is still being answered
+        return;
+    }
+
     // Post buffering
     qint64 bytesAvailable = io->bytesAvailable();
     auto request = static_cast<ProtoRequestFastCGI *>(sock->protoData);
@@ -388,17 +398,16 @@ void ProtocolFastCGI::parse(Socket *sock, QIODevice *io) const
             } else if (ret == WSGI_OK) {
                 sock->processing++;
                 sock->engine->processRequest(request);
-                sock->requestFinished();
 
-                if (request->headerConnection == ProtoRequestFastCGI::HeaderConnectionClose) {
-                    // Web server did not set FCGI_KEEP_CONN
-                    sock->connectionClose();
+                if (request->status & Cutelyst::EngineRequest::Async) {
+                    // ProtoRequestFastCGI::processingFinished() goes on once it's answered
+                    request->processingAsync = true;
                     return;
                 }
 
-                auto size = request->buf_size;
-                request->resetData();
-                request->buf_size = size;
+                if (!finishRequest(sock, request)) {
+                    return;
+                }
             } else if (ret == WSGI_BODY) {
                 bytesAvailable = readBody(sock, io, bytesAvailable);
                 if (bytesAvailable == -1) {
@@ -416,6 +425,22 @@ void ProtocolFastCGI::parse(Socket *sock, QIODevice *io) const
     } while (bytesAvailable);
 }
 
+bool ProtocolFastCGI::finishRequest(Socket *sock, ProtoRequestFastCGI *request) const
+{
+    sock->requestFinished();
+
+    if (request->headerConnection == ProtoRequestFastCGI::HeaderConnectionClose) {
+        // Web server did not set FCGI_KEEP_CONN
+        sock->connectionClose();
+        return false;
+    }
+
+    auto size = request->buf_size;
+    request->resetData();
+    request->buf_size = size;
+    return true;
+}
+
 ProtocolData *ProtocolFastCGI::createData(Socket *sock) const
 {
     return new ProtoRequestFastCGI(sock, m_bufferSize);
@@ -449,22 +474,17 @@ bool ProtoRequestFastCGI::writeHeaders(quint16 status, const Cutelyst::Headers &
     headerBuffer.resize(0);
     headerBuffer.append(QByteArrayLiteral("Status: ") + QByteArray::number(status));
 
-    const auto headersData = headers.data();
+    const auto &headersData = headers.entries();
 
     bool hasDate = false;
-    auto it = headersData.constBegin();
-    while (it != headersData.constEnd()) {
-        const QString &key = it.key();
-        const QString &value = it.value();
+    for (const auto &entry : headersData) {
+        const QString &key = entry.key;
+        const QString &value = entry.value;
         if (!hasDate && key == QLatin1String("DATE")) {
             hasDate = true;
         }
 
-        QString line(QLatin1String("\r\n") + CWsgiEngine::camelCaseHeader(key) + QLatin1String(": ") + value);
-        const QByteArray data = line.toLatin1();
-        headerBuffer.append(data);
-
-        ++it;
+        CWsgiEngine::appendHeaderLine(headerBuffer, key, value);
     }
 
     if (!hasDate) {
@@ -477,61 +497,54 @@ bool ProtoRequestFastCGI::writeHeaders(quint16 status, const Cutelyst::Headers &
 
 qint64 ProtoRequestFastCGI::doWrite(const char *data, qint64 len)
 {
-    // reset for next write
     qint64 write_pos = 0;
-    quint32 proto_parser_status = 0;
 
     Q_FOREVER {
         // fastcgi packets are limited to 64k
+        quint16 fcgi_len;
+        if (len - write_pos < 0xffff) {
+            fcgi_len = quint16(len - write_pos);
+        } else {
+            fcgi_len = 0xffff;
+        }
+
         quint8 padding = 0;
+        quint16 padded_len = FCGI_ALIGN(fcgi_len);
+        if (padded_len > fcgi_len) {
+            padding = quint8(padded_len - fcgi_len);
+        }
 
-        if (proto_parser_status == 0) {
-            quint16 fcgi_len;
-            if (len - write_pos < 0xffff) {
-                fcgi_len = quint16(len - write_pos);
-            } else {
-                fcgi_len = 0xffff;
-            }
-            proto_parser_status = fcgi_len;
+        struct fcgi_record fr;
+        fr.version = FCGI_VERSION_1;
+        fr.type = FCGI_STDOUT;
 
-            struct fcgi_record fr;
-            fr.version = FCGI_VERSION_1;
-            fr.type = FCGI_STDOUT;
+        fr.req1 = quint8(stream_id >> 8);
+        fr.req0 = quint8(stream_id);
 
-            fr.req1 = quint8(stream_id >> 8);
-            fr.req0 = quint8(stream_id);
+        fr.pad = padding;
 
-            quint16 padded_len = FCGI_ALIGN(fcgi_len);
-            if (padded_len > fcgi_len) {
-                padding = quint8(padded_len - fcgi_len);
-            }
-            fr.pad = padding;
+        fr.reserved = 0;
+        fr.cl1 = quint8(fcgi_len >> 8);
+        fr.cl0 = quint8(fcgi_len);
 
-            fr.reserved = 0;
-            fr.cl1 = quint8(fcgi_len >> 8);
-            fr.cl0 = quint8(fcgi_len);
-            if (io->write(reinterpret_cast<const char *>(&fr), sizeof(struct fcgi_record)) != sizeof(struct fcgi_record)) {
-                return -1;
-            }
-        }
+        // Record header, payload and padding in one go
+        struct iovec iov[3];
+        iov[0].iov_base = &fr;
+        iov[0].iov_len = sizeof(struct fcgi_record);
+        iov[1].iov_base = const_cast<char *>(data + write_pos);
+        iov[1].iov_len = fcgi_len;
+        iov[2].iov_base = const_cast<char *>("\0\0\0\0\0\0\0\0\0");
+        iov[2].iov_len = padding;
 
-        qint64 wlen = io->write(data + write_pos, proto_parser_status);
-        if (padding) {
-            io->write("\0\0\0\0\0\0\0\0\0", padding);
+        if (sock->writev(iov, padding ? 3 : 2) < 0) {
+            qCWarning(CWSGI_FCGI) << "Writing socket error" << io->errorString();
+            return -1;
         }
 
-        if (wlen > 0) {
-            write_pos += wlen;
-            proto_parser_status -= wlen;
-            if (write_pos == len) {
-                return WSGI_OK;
-            }
-            continue;
-        }
-        if (wlen < 0) {
-            qCWarning(CWSGI_FCGI) << "Writing socket error" << io->errorString();
+        write_pos += fcgi_len;
+        if (write_pos == len) {
+            return WSGI_OK;
         }
-        return -1;
     }
 }
 
@@ -547,6 +560,14 @@ void ProtoRequestFastCGI::processingFinished()
     end_request[10] = sid[1];
     end_request[11] = sid[0];
     io->write(end_request, 24);
+
+    if (processingAsync) {
+        processingAsync = false;
+        auto fcgiProto = static_cast<ProtocolFastCGI *>(sock->proto);
+        if (fcgiProto->finishRequest(sock, this) && io->bytesAvailable()) {
+            fcgiProto->parse(sock, io);
+        }
+    }
 }
 
 #include "moc_protocolfastcgi.cpp"
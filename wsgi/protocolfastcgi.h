@@ -50,21 +50,25 @@ public:
         ProtocolData::resetData();
 
         // EngineRequest
-        delete context;
-        context = nullptr;
+        releaseContext();
         delete body;
         body = nullptr;
 
         startOfRequest = 0;
         status = InitialState;
+        bodyOffset = 0;
+        bodyLength = -1;
 
         stream_id = 0;
         pktsize = 0;
+        processingAsync = false;
     }
 
 public:
     quint16 stream_id = 0;
     quint16 pktsize = 0;
+    // Detached with Context::detachAsync(), finished from processingFinished()
+    bool processingAsync = false;
 };
 
 class ProtocolFastCGI : public Protocol
@@ -80,6 +84,8 @@ public:
 
     virtual ProtocolData *createData(Socket *sock) const override final;
 
+    bool finishRequest(Socket *sock, ProtoRequestFastCGI *request) const;
+
 private:
     inline quint16 addHeader(ProtoRequestFastCGI *request, const char *key, quint16 keylen, const char *val, quint16 vallen) const;
     inline int parseHeaders(ProtoRequestFastCGI *request, const char *buf, quint16 len) const;
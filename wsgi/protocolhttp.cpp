@@ -20,6 +20,7 @@
 #include "protocolwebsocket.h"
 #include "wsgi.h"
 #include "protocolhttp2.h"
+#include "postunbuffered.h"
 
 #include <Cutelyst/Headers>
 #include <Cutelyst/Context>
@@ -31,11 +32,21 @@
 #include <QCoreApplication>
 #include <QBuffer>
 #include <QTimer>
+#include <QSocketNotifier>
 #include <QCryptographicHash>
 #include <QLoggingCategory>
 
 #include <typeinfo>
 
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <errno.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace CWSGI;
 
 Q_LOGGING_CATEGORY(CWSGI_HTTP, "cwsgi.http", QtWarningMsg)
@@ -45,7 +56,8 @@ ProtocolHttp::ProtocolHttp(WSGI *wsgi, ProtocolHttp2 *upgradeH2c) : Protocol(wsg
   , m_websocketProto(new ProtocolWebSocket(wsgi))
   , m_upgradeH2c(upgradeH2c)
 {
-
+    m_chunkedInputLimit = wsgi->chunkedInputLimit();
+    m_chunkedInputMaxSize = wsgi->chunkedInputMaxSize();
 }
 
 ProtocolHttp::~ProtocolHttp()
@@ -60,6 +72,28 @@ Protocol::Type ProtocolHttp::type() const
 
 inline int CrLfIndexIn(const char *str, int len, int from)
 {
+#ifdef __SSE2__
+    // Compare 16 bytes at once against '\r', the LF check is then only done
+    // for the few candidates found, this avoids a memchr call per CR on
+    // header blocks that have many short lines
+    const __m128i cr = _mm_set1_epi8('\r');
+    while (from + 16 <= len) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + from));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, cr));
+        while (mask) {
+            const int pos = from + __builtin_ctz(uint(mask));
+            if (pos + 1 >= len) {
+                return -1;
+            }
+            if (str[pos + 1] == '\n') {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+        from += 16;
+    }
+#endif
+
     do {
         const char *pch = static_cast<const char *>(memchr(str + from, '\r', size_t(len - from)));
         if (pch != nullptr) {
@@ -83,7 +117,20 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
 {
     // Post buffering
     auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
-    if (protoRequest->connState == ProtoRequestHttp::ContentBody) {
+    if (protoRequest->connState == ProtoRequestHttp::ContentBodyUnbuffered) {
+        parseBodyUnbuffered(sock, io);
+        return;
+    } else if (sock->processing) {
+        // A detached request is still being answered
+        return;
+    } else if (protoRequest->connState == ProtoRequestHttp::ContentBody && protoRequest->chunked) {
+        if (readChunked(sock, io) && protoRequest->chunkedDecoder.isDone() &&
+                processRequest(sock, io) && (protoRequest->buf_size || io->bytesAvailable())) {
+            // Pipelined requests
+            parse(sock, io);
+        }
+        return;
+    } else if (protoRequest->connState == ProtoRequestHttp::ContentBody) {
         qint64 bytesAvailable = io->bytesAvailable();
         qint64 len;
         qint64 remaining;
@@ -115,6 +162,7 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
     }
     protoRequest->buf_size += len;
 
+    bool dispatchedUnbuffered = false;
     while (protoRequest->last < protoRequest->buf_size) {
 //        qCDebug(CWSGI_HTTP) << Q_FUNC_INFO << QByteArray(protoRequest->buffer, protoRequest->buf_size);
         int ix = CrLfIndexIn(protoRequest->buffer, protoRequest->buf_size, protoRequest->last);
@@ -138,7 +186,70 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
                 if (len) {
                     parseHeader(ptr, ptr + len, sock);
                 } else {
-                    if (protoRequest->contentLength > 0) {
+                    if (protoRequest->chunked && protoRequest->contentLength != -1) {
+                        // Transfer-Encoding wins, but the connection can't be trusted
+                        protoRequest->contentLength = -1;
+                        protoRequest->headerConnection = ProtoRequestHttp::HeaderConnectionClose;
+                    }
+
+                    if ((protoRequest->contentLength > 0 || protoRequest->chunked) && protoRequest->expectContinue &&
+                            protoRequest->protocol == QLatin1String("HTTP/1.1")) {
+                        io->write("HTTP/1.1 100 Continue\r\n\r\n", 25);
+                    }
+
+                    if (protoRequest->chunked) {
+                        if (m_postUnbuffered) {
+                            setupBodyUnbuffered(protoRequest, new PostUnbuffered);
+                        } else {
+                            protoRequest->body = createBody(-1);
+                            if (!protoRequest->body) {
+                                sock->connectionClose();
+                                return;
+                            }
+                        }
+                        protoRequest->connState = ProtoRequestHttp::ContentBody;
+
+                        // Decodes what is already buffered, stopping at the end of the body,
+                        // errors are still answered since nothing was dispatched
+                        if (!parseChunked(sock, protoRequest)) {
+                            return;
+                        }
+
+                        if (protoRequest->bodyUnbuffered) {
+                            // The handlers read the rest of the body as it arrives
+                            protoRequest->connState = ProtoRequestHttp::ContentBodyUnbuffered;
+                            if (!processRequest(sock, io)) {
+                                return;
+                            }
+                            dispatchedUnbuffered = true;
+                            continue;
+                        } else if (!protoRequest->chunkedDecoder.isDone()) {
+                            if (io->bytesAvailable()) {
+                                parse(sock, io);
+                            }
+                            return;
+                        }
+                    } else if (protoRequest->contentLength > 0 && m_postUnbuffered) {
+                        auto body = new PostUnbuffered;
+                        body->m_contentLength = protoRequest->contentLength;
+                        setupBodyUnbuffered(protoRequest, body);
+                        protoRequest->connState = ProtoRequestHttp::ContentBodyUnbuffered;
+
+                        ptr += 2;
+                        len = qMin(protoRequest->contentLength, static_cast<qint64>(protoRequest->buf_size - protoRequest->last));
+                        protoRequest->bodyRemaining = protoRequest->contentLength - len;
+                        if (len) {
+                            body->append(ptr, len, protoRequest->bodyRemaining == 0);
+                        }
+                        protoRequest->last += len;
+
+                        // The handlers read the rest of the body as it arrives
+                        if (!processRequest(sock, io)) {
+                            return;
+                        }
+                        dispatchedUnbuffered = true;
+                        continue;
+                    } else if (protoRequest->contentLength > 0) {
                         protoRequest->connState = ProtoRequestHttp::ContentBody;
                         protoRequest->body = createBody(protoRequest->contentLength);
                         if (!protoRequest->body) {
@@ -182,11 +293,175 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
     if (protoRequest->buf_size == m_bufferSize) {
         // 414 Request-URI Too Long
     }
+
+    // Pipelined data that arrived while the handlers waited
+    // for the body is left on the socket
+    if (dispatchedUnbuffered && io->bytesAvailable()) {
+        parse(sock, io);
+    }
+}
+
+void ProtocolHttp::setupBodyUnbuffered(ProtoRequestHttp *request, PostUnbuffered *body) const
+{
+    request->body = body;
+    request->bodyUnbuffered = body;
+
+    // Qt sockets would otherwise keep moving the kernel buffer into theirs
+    auto socket = qobject_cast<QAbstractSocket *>(request->io);
+    if (socket) {
+        socket->setReadBufferSize(m_postBufferSize);
+    }
+
+    body->consumed = [this, request, body] (qint64 len) {
+        Q_UNUSED(len)
+        if (request->bodyPaused && body->bytesAvailable() <= m_postBufferSize / 2) {
+            request->bodyPaused = false;
+            resumeBodyUnbuffered(request);
+        }
+    };
+}
+
+bool ProtocolHttp::pauseBodyUnbuffered(ProtoRequestHttp *request) const
+{
+    // Leaving the rest on the socket lets the TCP window push back on the
+    // client, until PostUnbuffered::consumed reports the handlers caught up
+    if (request->bodyUnbuffered && request->bodyUnbuffered->bytesAvailable() >= m_postBufferSize) {
+        request->bodyPaused = true;
+        static_cast<CWsgiEngine *>(request->sock->engine)->removeSocketTimeout(request->sock);
+        return true;
+    }
+    return false;
+}
+
+void ProtocolHttp::resumeBodyUnbuffered(ProtoRequestHttp *request) const
+{
+    // Queued so the handlers don't get readyRead() from within their read()
+    QTimer::singleShot(0, request->io, [this, request] {
+        if (request->connState != ProtoRequestHttp::ContentBodyUnbuffered || request->bodyPaused) {
+            return;
+        }
+
+        parseBodyUnbuffered(request->sock, request->io);
+        if (request->io->isOpen()) {
+            static_cast<CWsgiEngine *>(request->sock->engine)->touchSocket(request->sock);
+        }
+    });
+}
+
+void ProtocolHttp::parseBodyUnbuffered(Socket *sock, QIODevice *io) const
+{
+    auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
+    if (protoRequest->bodyPaused) {
+        return;
+    }
+
+    if (protoRequest->chunked && !readChunked(sock, io)) {
+        return;
+    }
+
+    while (protoRequest->bodyRemaining && io->bytesAvailable()) {
+        if (pauseBodyUnbuffered(protoRequest)) {
+            return;
+        }
+
+        const qint64 len = io->read(m_postBuffer, qMin(m_postBufferSize, protoRequest->bodyRemaining));
+        if (len == -1) {
+            sock->connectionClose();
+            return;
+        }
+        protoRequest->bodyRemaining -= len;
+
+        if (protoRequest->bodyUnbuffered) {
+            protoRequest->bodyUnbuffered->append(m_postBuffer, len, protoRequest->bodyRemaining == 0);
+        }
+    }
+
+    // Once answered the rest of the body is discarded to keep the connection alive
+    if (!protoRequest->bodyPending() && !protoRequest->bodyUnbuffered && !sock->processing) {
+        if (prepareNextRequest(sock, protoRequest) && (protoRequest->buf_size || io->bytesAvailable())) {
+            parse(sock, io);
+        }
+    }
+}
+
+bool ProtocolHttp::readChunked(Socket *sock, QIODevice *io) const
+{
+    auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
+    while (!protoRequest->chunkedDecoder.isDone()) {
+        if (pauseBodyUnbuffered(protoRequest)) {
+            break;
+        }
+
+        // Everything before the end of the body was decoded, the
+        // buffer is reused so that pipelined data stays in it
+        if (protoRequest->last == protoRequest->buf_size) {
+            protoRequest->buf_size = 0;
+            protoRequest->last = 0;
+            protoRequest->beginLine = 0;
+        }
+
+        const qint64 len = io->read(protoRequest->buffer + protoRequest->buf_size, m_bufferSize - protoRequest->buf_size);
+        if (len == -1) {
+            sock->connectionClose();
+            return false;
+        } else if (len == 0) {
+            break;
+        }
+        protoRequest->buf_size += len;
+
+        if (!parseChunked(sock, protoRequest)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProtocolHttp::parseChunked(Socket *sock, ProtoRequestHttp *request) const
+{
+    quint16 error = 0;
+    const qint64 len = request->chunkedDecoder.decode(request->buffer + request->last, request->buf_size - request->last, &error,
+                                                      [this, request] (const char *data, qint64 dataLen) {
+        if (request->bodyUnbuffered) {
+            request->bodyUnbuffered->append(data, dataLen);
+        } else if (request->connState == ProtoRequestHttp::ContentBody) {
+            return writeBody(request->body, data, dataLen);
+        }
+        // Already answered, the rest of the body is discarded
+        return true;
+    });
+    if (len == -1) {
+        qCDebug(CWSGI_HTTP) << "Invalid chunked body" << error;
+        if (request->connState == ProtoRequestHttp::ContentBodyUnbuffered) {
+            // Already dispatched, the handlers see the body ending early
+            if (request->bodyUnbuffered) {
+                request->bodyUnbuffered->setFinished();
+            }
+        } else {
+            // Not answered yet
+            int msgLen;
+            const char *msg = CWsgiEngine::httpStatusMessage(error, &msgLen);
+            request->io->write(msg, msgLen);
+            request->io->write("\r\nConnection: close\r\nContent-Length: 0\r\n\r\n", 42);
+        }
+        sock->connectionClose();
+        return false;
+    }
+
+    request->last += int(len);
+    request->beginLine = request->last;
+
+    if (request->chunkedDecoder.isDone() && request->bodyUnbuffered) {
+        request->bodyUnbuffered->setFinished();
+    }
+    return true;
 }
 
 ProtocolData *ProtocolHttp::createData(Socket *sock) const
 {
-    return new ProtoRequestHttp(sock, m_bufferSize);
+    auto data = new ProtoRequestHttp(sock, m_bufferSize);
+    data->chunkedDecoder.chunkLimit = m_chunkedInputLimit;
+    data->chunkedDecoder.maxSize = m_chunkedInputMaxSize;
+    return data;
 }
 
 bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
@@ -194,26 +469,61 @@ bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
     auto request = static_cast<ProtoRequestHttp *>(sock->protoData);
 //    qCDebug(CWSGI_HTTP) << "processRequest" << sock->protoData->contentLength;
     sock->processing = 1;
-    if (request->body) {
+    if (request->body && !request->bodyUnbuffered) {
         request->body->seek(0);
     }
 
-    // When enabled try to upgrade to H2C
-    if (m_upgradeH2c && m_upgradeH2c->upgradeH2C(sock, io, *request)) {
+    // When enabled try to upgrade to H2C, the body must be complete
+    if (m_upgradeH2c && !request->bodyUnbuffered && m_upgradeH2c->upgradeH2C(sock, io, *request)) {
         return false;
     }
 
     sock->engine->processRequest(request);
 
+    if (request->status & Cutelyst::EngineRequest::Async || request->sendFileDevice) {
+        // ProtoRequestHttp::processingFinished() goes on once it's answered
+        // and its file body was sent, pipelined requests wait on the
+        // socket to keep their order
+        request->processingAsync = true;
+        return false;
+    }
+
+    return finishRequest(sock, request);
+}
+
+bool ProtocolHttp::finishRequest(Socket *sock, ProtoRequestHttp *request) const
+{
     if (request->websocketUpgraded) {
         return false; // Must read remaining data
     }
     sock->requestFinished();
 
+    if (request->bodyUnbuffered) {
+        request->bodyUnbuffered = nullptr;
+
+        auto socket = qobject_cast<QAbstractSocket *>(request->io);
+        if (socket) {
+            socket->setReadBufferSize(0);
+        }
+
+        if (request->bodyPending() && request->headerConnection != ProtoRequestHttp::HeaderConnectionClose) {
+            // parseBodyUnbuffered() discards what the handlers didn't read,
+            // part of it might be waiting in the socket buffer already
+            request->bodyPaused = false;
+            resumeBodyUnbuffered(request);
+            return false;
+        }
+    }
+
+    return prepareNextRequest(sock, request);
+}
+
+bool ProtocolHttp::prepareNextRequest(Socket *sock, ProtoRequestHttp *request) const
+{
     if (request->headerConnection == ProtoRequestHttp::HeaderConnectionClose) {
         sock->connectionClose();
         return false;
-    } 
+    }
 
     if (request->last < request->buf_size) {
         // move pipelined request to 0
@@ -228,37 +538,87 @@ bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
     return true;
 }
 
+// Well known methods and protocols are returned as static data
+// so that no allocation is needed for the common case
+inline QString methodString(const char *ptr, int len)
+{
+    switch (len) {
+    case 3:
+        if (memcmp(ptr, "GET", 3) == 0) {
+            return QStringLiteral("GET");
+        } else if (memcmp(ptr, "PUT", 3) == 0) {
+            return QStringLiteral("PUT");
+        }
+        break;
+    case 4:
+        if (memcmp(ptr, "POST", 4) == 0) {
+            return QStringLiteral("POST");
+        } else if (memcmp(ptr, "HEAD", 4) == 0) {
+            return QStringLiteral("HEAD");
+        }
+        break;
+    case 5:
+        if (memcmp(ptr, "PATCH", 5) == 0) {
+            return QStringLiteral("PATCH");
+        }
+        break;
+    case 6:
+        if (memcmp(ptr, "DELETE", 6) == 0) {
+            return QStringLiteral("DELETE");
+        }
+        break;
+    case 7:
+        if (memcmp(ptr, "OPTIONS", 7) == 0) {
+            return QStringLiteral("OPTIONS");
+        }
+        break;
+    }
+    return QString::fromLatin1(ptr, len);
+}
+
+inline QString protocolString(const char *ptr, int len)
+{
+    if (len == 8 && memcmp(ptr, "HTTP/1.", 7) == 0) {
+        if (ptr[7] == '1') {
+            return QStringLiteral("HTTP/1.1");
+        } else if (ptr[7] == '0') {
+            return QStringLiteral("HTTP/1.0");
+        }
+    }
+    return QString::fromLatin1(ptr, len);
+}
+
 void ProtocolHttp::parseMethod(const char *ptr, const char *end, Socket *sock) const
 {
     auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
     const char *word_boundary = ptr;
-    while (*word_boundary != ' ' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary != ' ') {
         ++word_boundary;
     }
-    protoRequest->method = QString::fromLatin1(ptr, int(word_boundary - ptr));
+    protoRequest->method = methodString(ptr, int(word_boundary - ptr));
 
     // skip spaces
-    while (*word_boundary == ' ' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary == ' ') {
         ++word_boundary;
     }
     ptr = word_boundary;
 
     // skip leading slashes
-    while (*ptr == '/' && ptr <= end) {
+    while (ptr < end && *ptr == '/') {
         ++ptr;
     }
 
     // find path end
-    while (*word_boundary != ' ' && *word_boundary != '?' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary != ' ' && *word_boundary != '?') {
         ++word_boundary;
     }
 
     // This will change the ptr but will only change less than size
     protoRequest->setPath(const_cast<char *>(ptr), int(word_boundary - ptr));
 
-    if (*word_boundary == '?') {
+    if (word_boundary < end && *word_boundary == '?') {
         ptr = word_boundary + 1;
-        while (*word_boundary != ' ' && word_boundary < end) {
+        while (word_boundary < end && *word_boundary != ' ') {
             ++word_boundary;
         }
         protoRequest->query = QByteArray(ptr, int(word_boundary - ptr));
@@ -267,32 +627,32 @@ void ProtocolHttp::parseMethod(const char *ptr, const char *end, Socket *sock) c
     }
 
     // skip spaces
-    while (*word_boundary == ' ' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary == ' ') {
         ++word_boundary;
     }
     ptr = word_boundary;
 
-    while (*word_boundary != ' ' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary != ' ') {
         ++word_boundary;
     }
-    protoRequest->protocol = QString::fromLatin1(ptr, int(word_boundary - ptr));
+    protoRequest->protocol = protocolString(ptr, int(word_boundary - ptr));
 }
 
-
+// Builds the CGI like key straight from the raw Latin-1 bytes,
+// writing into an uninitialized QString to avoid a second pass
 inline QString normalizeHeaderKey(const char *str, int size)
 {
-    int i = 0;
-    QString key = QString::fromLatin1(str, size);
-    while (i < key.size()) {
-        QCharRef c = key[i];
-        if (c.isLetter()) {
-            if (c.isLower()) {
-                c = c.toUpper();
-            }
-        } else if (c == QLatin1Char('-')) {
-            c = QLatin1Char('_');
+    QString key(size, Qt::Uninitialized);
+    ushort *data = reinterpret_cast<ushort *>(key.data());
+    for (int i = 0; i < size; ++i) {
+        const uchar c = uchar(str[i]);
+        if (c >= 'a' && c <= 'z') {
+            data[i] = ushort(c - 0x20);
+        } else if (c == '-') {
+            data[i] = '_';
+        } else {
+            data[i] = c;
         }
-        ++i;
     }
     return key;
 }
@@ -301,33 +661,64 @@ void ProtocolHttp::parseHeader(const char *ptr, const char *end, Socket *sock) c
 {
     auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
     const char *word_boundary = ptr;
-    while (*word_boundary != ':' && word_boundary < end) {
+    while (word_boundary < end && *word_boundary != ':') {
         ++word_boundary;
     }
-    const QString key = normalizeHeaderKey(ptr, int(word_boundary - ptr));
+    const int keySize = int(word_boundary - ptr);
+    const int known = Cutelyst::Headers::knownHeader(ptr, keySize);
 
-    while ((*word_boundary == ':' || *word_boundary == ' ') && word_boundary < end) {
+    while (word_boundary < end && (*word_boundary == ':' || *word_boundary == ' ')) {
         ++word_boundary;
     }
-    const QString value = QString::fromLatin1(word_boundary, int(end - word_boundary));
+    const char *valuePtr = word_boundary;
+    const int valueSize = int(end - valuePtr);
+
+    if (known == -1) {
+        protoRequest->headers.pushRawHeader(normalizeHeaderKey(ptr, keySize), QString::fromLatin1(valuePtr, valueSize));
+        return;
+    }
 
-    if (protoRequest->headerConnection == ProtoRequestHttp::HeaderConnectionNotSet && key == QLatin1String("CONNECTION")) {
-        if (value.compare(QLatin1String("close"), Qt::CaseInsensitive) == 0) {
+    if (protoRequest->headerConnection == ProtoRequestHttp::HeaderConnectionNotSet && known == Cutelyst::Headers::Connection) {
+        if (valueSize == 5 && qstrnicmp(valuePtr, "close", 5) == 0) {
             protoRequest->headerConnection = ProtoRequestHttp::HeaderConnectionClose;
         } else {
             protoRequest->headerConnection = ProtoRequestHttp::HeaderConnectionKeep;
         }
-    } else if (protoRequest->contentLength < 0 && key == QLatin1String("CONTENT_LENGTH")) {
-        bool ok;
-        qint64 cl = value.toLongLong(&ok);
-        if (ok && cl >= 0) {
+    } else if (protoRequest->contentLength < 0 && known == Cutelyst::Headers::ContentLength) {
+        int digits = valueSize;
+        while (digits > 0 && (valuePtr[digits - 1] == ' ' || valuePtr[digits - 1] == '\t')) {
+            --digits;
+        }
+
+        qint64 cl = 0;
+        bool ok = digits > 0 && digits < 19;
+        for (int i = 0; ok && i < digits; ++i) {
+            const char c = valuePtr[i];
+            if (c >= '0' && c <= '9') {
+                cl = cl * 10 + (c - '0');
+            } else {
+                ok = false;
+            }
+        }
+        if (ok) {
             protoRequest->contentLength = cl;
         }
-    } else if (!protoRequest->headerHost && key == QLatin1String("HOST")) {
-        protoRequest->serverAddress = value;
+    } else if (known == Cutelyst::Headers::TransferEncoding) {
+        // Only a final chunked coding delimits the body
+        int size = valueSize;
+        while (size > 0 && (valuePtr[size - 1] == ' ' || valuePtr[size - 1] == '\t')) {
+            --size;
+        }
+        protoRequest->chunked = size >= 7 && qstrnicmp(valuePtr + size - 7, "chunked", 7) == 0;
+    } else if (known == Cutelyst::Headers::Expect) {
+        protoRequest->expectContinue = valueSize == 12 && qstrnicmp(valuePtr, "100-continue", 12) == 0;
+    } else if (!protoRequest->headerHost && known == Cutelyst::Headers::Host) {
+        protoRequest->serverAddress = QString::fromLatin1(valuePtr, valueSize);
         protoRequest->headerHost = true;
+        protoRequest->headers.pushRawHeader(Cutelyst::Headers::Host, protoRequest->serverAddress);
+        return;
     }
-    protoRequest->headers.pushRawHeader(key, value);
+    protoRequest->headers.pushRawHeader(Cutelyst::Headers::KnownHeader(known), QString::fromLatin1(valuePtr, valueSize));
 }
 
 ProtoRequestHttp::ProtoRequestHttp(Socket *sock, int bufferSize) : ProtocolData(sock, bufferSize)
@@ -337,7 +728,7 @@ ProtoRequestHttp::ProtoRequestHttp(Socket *sock, int bufferSize) : ProtocolData(
 
 ProtoRequestHttp::~ProtoRequestHttp()
 {
-
+    QObject::disconnect(sendFileConnection);
 }
 
 void ProtoRequestHttp::setupNewConnection(Socket *sock)
@@ -354,19 +745,25 @@ bool ProtoRequestHttp::writeHeaders(quint16 status, const Cutelyst::Headers &hea
         return false;
     }
 
+    static thread_local QByteArray headerBuffer = ([]() -> QByteArray {
+                                                       QByteArray ret;
+                                                       ret.reserve(1024);
+                                                       return ret;
+                                                   }());
+
     int msgLen;
     const char *msg = CWsgiEngine::httpStatusMessage(status, &msgLen);
-    io->write(msg, msgLen);
+    headerBuffer.resize(0);
+    headerBuffer.append(msg, msgLen);
 
-    const auto headersData = headers.data();
+    const auto &headersData = headers.entries();
     ProtoRequestHttp::HeaderConnection fallbackConnection = headerConnection;
     headerConnection = ProtoRequestHttp::HeaderConnectionNotSet;
 
     bool hasDate = false;
-    auto it = headersData.constBegin();
-    while (it != headersData.constEnd()) {
-        const QString &key = it.key();
-        const QString &value = it.value();
+    for (const auto &entry : headersData) {
+        const QString &key = entry.key;
+        const QString &value = entry.value;
         if (headerConnection == ProtoRequestHttp::HeaderConnectionNotSet && key == QLatin1String("CONNECTION")) {
             if (value.compare(QLatin1String("close"), Qt::CaseInsensitive) == 0) {
                 headerConnection = ProtoRequestHttp::HeaderConnectionClose;
@@ -379,27 +776,26 @@ bool ProtoRequestHttp::writeHeaders(quint16 status, const Cutelyst::Headers &hea
             hasDate = true;
         }
 
-        QString ret(QLatin1String("\r\n") + CWsgiEngine::camelCaseHeader(key) + QLatin1String(": ") + value);
-        io->write(ret.toLatin1());
-
-        ++it;
+        CWsgiEngine::appendHeaderLine(headerBuffer, key, value);
     }
 
     if (headerConnection == ProtoRequestHttp::HeaderConnectionNotSet) {
         if (fallbackConnection == ProtoRequestHttp::HeaderConnectionKeep) {
             headerConnection = ProtoRequestHttp::HeaderConnectionKeep;
-            io->write("\r\nConnection: keep-alive", 24);
+            headerBuffer.append("\r\nConnection: keep-alive", 24);
         } else {
             headerConnection = ProtoRequestHttp::HeaderConnectionClose;
-            io->write("\r\nConnection: close", 19);
+            headerBuffer.append("\r\nConnection: close", 19);
         }
     }
 
     if (!hasDate) {
-        io->write(static_cast<CWsgiEngine *>(sock->engine)->lastDate());
+        headerBuffer.append(static_cast<CWsgiEngine *>(sock->engine)->lastDate());
     }
+    headerBuffer.append("\r\n\r\n", 4);
 
-    return io->write("\r\n\r\n", 4) == 4;
+    // Status, headers, connection and date all go in a single write
+    return io->write(headerBuffer.constData(), headerBuffer.size()) == headerBuffer.size();
 }
 
 qint64 ProtoRequestHttp::doWrite(const char *data, qint64 len)
@@ -407,6 +803,158 @@ qint64 ProtoRequestHttp::doWrite(const char *data, qint64 len)
     return io->write(data, len);
 }
 
+qint64 ProtoRequestHttp::doWriteFramed(const char *header, qint64 headerLen, const char *data, qint64 len, const char *footer, qint64 footerLen)
+{
+    struct iovec iov[3];
+    iov[0].iov_base = const_cast<char *>(header);
+    iov[0].iov_len = size_t(headerLen);
+    iov[1].iov_base = const_cast<char *>(data);
+    iov[1].iov_len = size_t(len);
+    iov[2].iov_base = const_cast<char *>(footer);
+    iov[2].iov_len = size_t(footerLen);
+    return sock->writev(iov, 3);
+}
+
+void ProtoRequestHttp::finalizeBody()
+{
+    // Files go straight from the page cache to a plain socket,
+    // TLS and chunked responses need the bytes in user space
+    if (!(status & EngineRequest::Chunked) && !sock->isSecure) {
+        auto file = qobject_cast<QFile *>(context->response()->bodyDevice());
+        if (file && file->handle() != -1 && sendFile(file)) {
+            return;
+        }
+    }
+
+    // Sockets without a descriptor get the file copied
+    EngineRequest::finalizeBody();
+}
+
+bool ProtoRequestHttp::sendFile(QFile *file)
+{
+#ifdef Q_OS_LINUX
+    int socketFd = -1;
+    if (auto tcp = qobject_cast<QAbstractSocket *>(io)) {
+        tcp->flush();
+        socketFd = int(tcp->socketDescriptor());
+    } else if (auto local = qobject_cast<QLocalSocket *>(io)) {
+        local->flush();
+        socketFd = int(local->socketDescriptor());
+    } else if (auto native = qobject_cast<NativeSocket *>(io)) {
+        socketFd = int(native->socketDescriptor());
+    }
+
+    if (socketFd == -1) {
+        return false;
+    }
+
+    // Data the application wrote to the file might still be buffered
+    file->flush();
+
+    if (bodyLength < 0) {
+        bodyLength = file->size() - bodyOffset;
+    }
+    sendFileDevice = file;
+    sendFileSocket = socketFd;
+
+    // The headers must be on the wire before the body
+    if (io->bytesToWrite() || !sendFileChunks()) {
+        // The file and offset are kept, the request finishes once it's sent
+        sendFileWait();
+    }
+    return true;
+#else
+    Q_UNUSED(file)
+    return false;
+#endif
+}
+
+bool ProtoRequestHttp::sendFileChunks()
+{
+#ifdef Q_OS_LINUX
+    // SIGPIPE is blocked on the worker threads, see CWsgiEngine::postFork()
+    off_t offset = off_t(bodyOffset);
+    while (bodyLength > 0) {
+        const ssize_t ret = ::sendfile(sendFileSocket, sendFileDevice->handle(), &offset, size_t(qMin<qint64>(bodyLength, 0x7ffff000)));
+        if (ret > 0) {
+            bodyLength -= ret;
+        } else if (ret == -1 && errno == EINTR) {
+            continue;
+        } else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            bodyOffset = offset;
+            return false;
+        } else {
+            // The client went away or the file shrunk, either way the
+            // Content-Length can't be honoured anymore
+            qCDebug(CWSGI_HTTP) << "Failed to sendfile" << errno;
+            headerConnection = ProtoRequestHttp::HeaderConnectionClose;
+            break;
+        }
+    }
+    bodyOffset = offset;
+#endif
+    sendFileDevice = nullptr;
+    return true;
+}
+
+void ProtoRequestHttp::sendFileWait()
+{
+    if (io->bytesToWrite()) {
+        // Whatever is queued on the device goes first
+        if (!sendFileConnection) {
+            sendFileConnection = QObject::connect(io, &QIODevice::bytesWritten, [this] () {
+                sendFileResume();
+            });
+        }
+        return;
+    }
+
+    QObject::disconnect(sendFileConnection);
+#ifdef Q_OS_LINUX
+    if (auto native = qobject_cast<NativeSocket *>(io)) {
+        sendFileConnection = QObject::connect(native, &NativeSocket::writable, [this] () {
+            sendFileResume();
+        });
+        return;
+    }
+#endif
+
+    // Qt only watches its sockets for writing while it has data queued
+    if (!sendFileNotifier) {
+        sendFileNotifier = new QSocketNotifier(sendFileSocket, QSocketNotifier::Write, io);
+        QObject::connect(sendFileNotifier, &QSocketNotifier::activated, [this] () {
+            sendFileResume();
+        });
+    }
+}
+
+void ProtoRequestHttp::sendFileResume()
+{
+    if (io->bytesToWrite()) {
+        return;
+    }
+
+    if (!sendFileChunks()) {
+        sendFileWait();
+        return;
+    }
+
+    sendFileStop();
+    processingFinished();
+}
+
+void ProtoRequestHttp::sendFileStop()
+{
+    sendFileDevice = nullptr;
+    QObject::disconnect(sendFileConnection);
+    if (sendFileNotifier) {
+        // Might be the one emitting
+        sendFileNotifier->setEnabled(false);
+        sendFileNotifier->deleteLater();
+        sendFileNotifier = nullptr;
+    }
+}
+
 void ProtoRequestHttp::processingFinished()
 {
     if (websocketUpgraded) {
@@ -415,6 +963,24 @@ void ProtoRequestHttp::processingFinished()
         websocket_phase = ProtoRequestHttp::WebSocketPhaseHeaders;
         buf_size = 0;
     }
+
+    if (processingAsync) {
+        if (sendFileDevice) {
+            // sendFileResume() comes back once the body is out
+            return;
+        }
+
+        processingAsync = false;
+        if (websocketUpgraded) {
+            return;
+        }
+
+        auto httpProto = static_cast<ProtocolHttp *>(sock->proto);
+        if (httpProto->finishRequest(sock, this) && (buf_size || io->bytesAvailable())) {
+            // Pipelined requests
+            httpProto->parse(sock, io);
+        }
+    }
 }
 
 bool ProtoRequestHttp::webSocketSendTextMessage(const QString &message)
@@ -425,8 +991,7 @@ bool ProtoRequestHttp::webSocketSendTextMessage(const QString &message)
 
     const QByteArray rawMessage = message.toUtf8();
     const QByteArray headers = ProtocolWebSocket::createWebsocketHeader(ProtoRequestHttp::OpCodeText, quint64(rawMessage.size()));
-    doWrite(headers);
-    return doWrite(rawMessage) == rawMessage.size();
+    return doWriteFramed(headers.constData(), headers.size(), rawMessage.constData(), rawMessage.size(), nullptr, 0) == headers.size() + rawMessage.size();
 }
 
 bool ProtoRequestHttp::webSocketSendBinaryMessage(const QByteArray &message)
@@ -436,8 +1001,7 @@ bool ProtoRequestHttp::webSocketSendBinaryMessage(const QByteArray &message)
     }
 
     const QByteArray headers = ProtocolWebSocket::createWebsocketHeader(ProtoRequestHttp::OpCodeBinary, quint64(message.size()));
-    doWrite(headers);
-    return doWrite(message) == message.size();
+    return doWriteFramed(headers.constData(), headers.size(), message.constData(), message.size(), nullptr, 0) == headers.size() + message.size();
 }
 
 bool ProtoRequestHttp::webSocketSendPing(const QByteArray &payload)
@@ -448,8 +1012,7 @@ bool ProtoRequestHttp::webSocketSendPing(const QByteArray &payload)
 
     const QByteArray rawMessage = payload.left(125);
     const QByteArray headers = ProtocolWebSocket::createWebsocketHeader(ProtoRequestHttp::OpCodePing, quint64(rawMessage.size()));
-    doWrite(headers);
-    return doWrite(rawMessage) == rawMessage.size();
+    return doWriteFramed(headers.constData(), headers.size(), rawMessage.constData(), rawMessage.size(), nullptr, 0) == headers.size() + rawMessage.size();
 }
 
 bool ProtoRequestHttp::webSocketClose(quint16 code, const QString &reason)
@@ -467,6 +1030,21 @@ bool ProtoRequestHttp::webSocketClose(quint16 code, const QString &reason)
 
 void ProtoRequestHttp::socketDisconnected()
 {
+    if (sendFileDevice) {
+        sendFileStop();
+        headerConnection = ProtoRequestHttp::HeaderConnectionClose;
+        // Queued as the socket only finishes after this returns
+        QTimer::singleShot(0, io, [this] () {
+            processingFinished();
+        });
+    }
+
+    if (bodyUnbuffered && !bodyUnbuffered->isFinished()) {
+        // Wakes up handlers waiting for the rest of the body
+        bodyUnbuffered->setFinished();
+    }
+
+
     if (websocketUpgraded) {
         if (websocket_finn_opcode != 0x88) {
             Q_EMIT context->request()->webSocketClosed(1005, QString());
@@ -19,12 +19,17 @@
 #define PROTOCOLHTTP_H
 
 #include <QObject>
+#include <QFile>
 
 #include "protocol.h"
 #include "socket.h"
+#include "chunkeddecoder.h"
 
 #include <Cutelyst/Context>
 
+class PostUnbuffered;
+class QSocketNotifier;
+
 namespace CWSGI {
 
 class WSGI;
@@ -71,11 +76,15 @@ public:
 
     virtual bool writeHeaders(quint16 status, const Cutelyst::Headers &headers) override final;
 
+    virtual void finalizeBody() override final;
+
     virtual qint64 doWrite(const char *data, qint64 len) override final;
     inline qint64 doWrite(const QByteArray &data) {
         return doWrite(data.constData(), data.size());
     }
 
+    virtual qint64 doWriteFramed(const char *header, qint64 headerLen, const char *data, qint64 len, const char *footer, qint64 footerLen) override final;
+
     virtual void processingFinished() override final;
 
     virtual bool webSocketSendTextMessage(const QString &message) override final;
@@ -90,15 +99,22 @@ public:
         ProtocolData::resetData();
 
         // EngineRequest
-        delete context;
-        context = nullptr;
+        releaseContext();
         delete body;
         body = nullptr;
 
         startOfRequest = 0;
         status = InitialState;
+        bodyOffset = 0;
+        bodyLength = -1;
 
         websocketUpgraded = false;
+        expectContinue = false;
+        processingAsync = false;
+        bodyUnbuffered = nullptr;
+        bodyRemaining = 0;
+        chunkedDecoder.reset();
+        chunked = false;
         last = 0;
         beginLine = 0;
 
@@ -109,6 +125,15 @@ public:
 
     virtual void socketDisconnected() override final;
 
+    inline virtual bool bodyPending() const override final {
+        return chunked ? !chunkedDecoder.isDone() : bodyRemaining != 0;
+    }
+
+    // Body being filled while the handlers run, null once they finished
+    PostUnbuffered *bodyUnbuffered = nullptr;
+    // Body bytes still to be read from the socket
+    qint64 bodyRemaining = 0;
+    ChunkedDecoder chunkedDecoder;
     QByteArray websocket_message;
     QByteArray websocket_payload;
     quint64 websocket_payload_size;
@@ -121,8 +146,25 @@ public:
     quint8 websocket_continue_opcode = 0;
     quint8 websocket_finn_opcode;
     bool websocketUpgraded = false;
+    bool expectContinue = false;
+    // Response body file sendfile() still has to send once the socket is
+    // writable, the request only finishes after it
+    QFile *sendFileDevice = nullptr;
+    // Detached with Context::detachAsync(), finished from processingFinished()
+    bool processingAsync = false;
+    bool chunked = false;
 
 protected:
+    inline bool sendFile(QFile *file);
+    bool sendFileChunks();
+    void sendFileWait();
+    void sendFileResume();
+    void sendFileStop();
+
+    QSocketNotifier *sendFileNotifier = nullptr;
+    QMetaObject::Connection sendFileConnection;
+    int sendFileSocket = -1;
+
     virtual bool webSocketHandshakeDo(const QString &key, const QString &origin, const QString &protocol) override final;
 };
 
@@ -142,6 +184,14 @@ public:
 
 private:
     inline bool processRequest(Socket *sock, QIODevice *io) const;
+    bool finishRequest(Socket *sock, ProtoRequestHttp *request) const;
+    inline bool prepareNextRequest(Socket *sock, ProtoRequestHttp *request) const;
+    inline void setupBodyUnbuffered(ProtoRequestHttp *request, PostUnbuffered *body) const;
+    inline bool pauseBodyUnbuffered(ProtoRequestHttp *request) const;
+    void resumeBodyUnbuffered(ProtoRequestHttp *request) const;
+    void parseBodyUnbuffered(Socket *sock, QIODevice *io) const;
+    inline bool readChunked(Socket *sock, QIODevice *io) const;
+    bool parseChunked(Socket *sock, ProtoRequestHttp *request) const;
     inline void parseMethod(const char *ptr, const char *end, Socket *sock) const;
     inline void parseHeader(const char *ptr, const char *end, Socket *sock) const;
 
@@ -150,6 +200,8 @@ protected:
 
     ProtocolWebSocket *m_websocketProto;
     ProtocolHttp2 *m_upgradeH2c;
+    qint64 m_chunkedInputLimit;
+    qint64 m_chunkedInputMaxSize;
 };
 
 }
@@ -20,8 +20,9 @@
 #include "socket.h"
 #include "hpack.h"
 #include "wsgi.h"
+#include "postunbuffered.h"
 
-#include <QEventLoop>
+#include <algorithm>
 
 #include <QLoggingCategory>
 
@@ -76,7 +77,8 @@ enum FrameType {
     FramePing = 0x6,
     FrameGoaway = 0x7,
     FrameWindowUpdate = 0x8,
-    FrameContinuation = 0x9
+    FrameContinuation = 0x9,
+    FramePriorityUpdate = 0x10
 };
 
 enum ErrorCodes {
@@ -107,8 +109,18 @@ enum Settings {
 
 #define PREFACE_SIZE 24
 
+// Bytes the socket may buffer before DATA waits on the stream queues,
+// this keeps what goes on the wire next up to the scheduler
+static const qint64 h2SendHighWatermark = 65536;
+
+static void applyPriorityField(H2Stream *stream, const QString &value);
+
 ProtocolHttp2::ProtocolHttp2(WSGI *wsgi) : Protocol(wsgi)
   , m_headerTableSize(wsgi->http2HeaderTableSize())
+  , m_maxConcurrentStreams(wsgi->http2MaxConcurrentStreams())
+  , m_initialWindowSize(wsgi->http2InitialWindowSize())
+  , m_connectionWindowSize(wsgi->http2ConnectionWindowSize())
+  , m_maxHeaderListSize(wsgi->http2MaxHeaderListSize())
 {
     m_bufferSize = qMin(m_bufferSize, 2147483647);
 
@@ -155,10 +167,7 @@ void ProtocolHttp2::parse(Socket *sock, QIODevice *io) const
                             memmove(request->buffer, request->buffer + PREFACE_SIZE, size_t(request->buf_size));
                             request->connState = ProtoRequestHttp2::H2Frames;
 
-                            sendSettings(io, {
-                                             { SETTINGS_MAX_FRAME_SIZE, m_maxFrameSize },
-                                             { SETTINGS_HEADER_TABLE_SIZE, m_headerTableSize },
-                                         });
+                            sendInitialSettings(request, io);
                         } else {
                             qCDebug(CWSGI_H2) << "Protocol Error: Invalid connection preface" << sock->remoteAddress.toString();
                             // RFC 7540 says this MAY be omitted, so let's reduce further processing
@@ -236,6 +245,8 @@ void ProtocolHttp2::parse(Socket *sock, QIODevice *io) const
                             ret = parseRstStream(request, io, frame);
                         } else if (fr->type == FrameWindowUpdate) {
                             ret = parseWindowUpdate(request, io, frame);
+                        } else if (fr->type == FramePriorityUpdate) {
+                            ret = parsePriorityUpdate(request, io, frame);
                         } else if (fr->type == FrameGoaway) {
                             sock->connectionClose();
                             return;
@@ -306,10 +317,17 @@ int ProtocolHttp2::parseSettings(ProtoRequestHttp2 *request, QIODevice *io, cons
                 auto it = request->streams.begin();
                 while (it != request->streams.end()) {
                     (*it)->windowSize += difference;
-                    (*it)->windowUpdated();
 //                    qCDebug(CWSGI_H2) << "updating stream" << it.key() << "to window" << (*it)->windowSize;
                     ++it;
                 }
+                sendPendingData(request);
+            } else if (identifier == SETTINGS_HEADER_TABLE_SIZE) {
+                request->settingsHeaderTableSize = value;
+                if (request->hpack) {
+                    request->hpack->setEncoderMaxTableSize(value);
+                }
+            } else if (identifier == SETTINGS_MAX_CONCURRENT_STREAMS) {
+                request->settingsMaxConcurrentStreams = value;
             } else if (identifier == SETTINGS_MAX_FRAME_SIZE) {
                 if (value < 16384 || value > 16777215) {
                     return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
@@ -330,12 +348,27 @@ int ProtocolHttp2::parseData(ProtoRequestHttp2 *request, QIODevice *io, const H2
         return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
     }
 
-    quint8 padLength = 0;
+    const char *data = request->buffer + 9;
+    quint32 dataLen = fr.len;
     if (fr.flags & FlagDataPadded) {
-        padLength = quint8(*(request->buffer + 9));
+        const quint8 padLength = quint8(*data);
         if (padLength >= fr.len) {
             return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
         }
+        ++data;
+        dataLen -= padLength + 1;
+    }
+
+    // Flow control counts the whole payload, padding included
+    if (fr.len > quint32(request->recvWindow)) {
+        return sendGoAway(io, request->maxStreamId, ErrorFlowControlError);
+    }
+    request->recvWindow -= qint32(fr.len);
+
+    // Windows are given back in batches once half of them was used
+    if (request->recvWindow <= qint32(m_connectionWindowSize / 2)) {
+        sendWindowUpdate(io, 0, m_connectionWindowSize - quint32(request->recvWindow));
+        request->recvWindow = qint32(m_connectionWindowSize);
     }
 
     H2Stream *stream;
@@ -349,25 +382,53 @@ int ProtocolHttp2::parseData(ProtoRequestHttp2 *request, QIODevice *io, const H2
                    stream->state == H2Stream::Closed) {
             return sendGoAway(io, request->maxStreamId, ErrorStreamClosed);
         }
+    } else if (fr.streamId <= request->maxStreamId) {
+        // Refused or already answered, the data is discarded
+        return ErrorNoError;
     } else {
        return sendGoAway(io, request->maxStreamId, ErrorStreamClosed);
     }
 
-//    qCDebug(CWSGI_H2) << "Frame data" << padLength << "state" << stream->state << "content-length" << stream->contentLength;
+    if (fr.len > quint32(stream->recvWindow)) {
+        return sendGoAway(io, request->maxStreamId, ErrorFlowControlError);
+    }
+    stream->recvWindow -= qint32(fr.len);
+
+    // Unbuffered bodies give the window back as the application reads them
+    if (!stream->streamBody && !(fr.flags & FlagDataEndStream) && stream->recvWindow <= qint32(m_initialWindowSize / 2)) {
+        sendWindowUpdate(io, fr.streamId, m_initialWindowSize - quint32(stream->recvWindow));
+        stream->recvWindow = qint32(m_initialWindowSize);
+    }
+
+//    qCDebug(CWSGI_H2) << "Frame data" << dataLen << "state" << stream->state << "content-length" << stream->contentLength;
+
+    if (stream->streamBody) {
+        if (fr.flags & FlagDataEndStream) {
+            stream->state = H2Stream::HalfClosed;
+        }
+        // Padding is never read by the application
+        stream->recvConsumed += qint32(fr.len - dataLen);
+
+        // The stream is already being processed and might be
+        // finished and deleted by the body readyRead() handlers
+        stream->streamBody->append(data, dataLen, fr.flags & FlagDataEndStream);
+        return ErrorNoError;
+    }
 
     if (!stream->body) {
-        stream->body = createBody(request->contentLength);
+        stream->body = createBody(stream->contentLength);
         if (!stream->body) {
             // Failed to create body to store data
             return sendGoAway(io, request->maxStreamId, ErrorInternalError);
         }
     }
-    stream->body->write(request->buffer + 9, fr.len - padLength);
+    stream->body->write(data, dataLen);
 
-    stream->consumedData += fr.len - padLength;
+    stream->consumedData += dataLen;
+    // RFC 7540 8.1.2.6 the DATA frames must add up to content-length
     if (stream->contentLength != -1 &&
             ((fr.flags & FlagDataEndStream && stream->contentLength != stream->consumedData) ||
-             (stream->contentLength > stream->consumedData))) {
+             stream->consumedData > stream->contentLength)) {
         return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
     }
 
@@ -399,17 +460,17 @@ int ProtocolHttp2::parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const
     }
 
     quint32 streamDependency = 0;
-//    quint8 weight = 0;
+    quint16 weight = 0;
     if (fr.flags & FlagHeadersPriority) {
-        // TODO disable exclusive bit
-        streamDependency = net_be32(ptr + pos);
+        // Dependencies are deprecated by RFC 9113, only the weight is used
+        streamDependency = net_be32(ptr + pos) & 0x7FFFFFFF;
         if (fr.streamId == streamDependency) {
 //            qCDebug(CWSGI_H2) << "header stream dep";
             return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
         }
 
         pos += 4;
-//        weight = quint8(*(ptr + pos)) + 1;
+        weight = quint16(quint8(*(ptr + pos))) + 1;
         pos += 1;
     }
     ptr += pos;
@@ -433,7 +494,19 @@ int ProtocolHttp2::parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const
         request->maxStreamId = fr.streamId;
 
         stream = new H2Stream(fr.streamId, request->settingsInitialWindowSize, request);
+        stream->recvWindow = qint32(m_initialWindowSize);
         stream->startOfRequest = request->sock->engine->time();
+
+        if (m_maxConcurrentStreams) {
+            quint32 active = 0;
+            for (const H2Stream *other : request->streams) {
+                if ((other->streamId & 1) && !other->processingDone) {
+                    ++active;
+                }
+            }
+            // Its header block still has to be decoded to keep HPACK in sync
+            stream->refused = active >= m_maxConcurrentStreams;
+        }
         request->streams.insert(fr.streamId, stream);
     }
 
@@ -445,8 +518,13 @@ int ProtocolHttp2::parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const
         stream->state = H2Stream::HalfClosed;
     }
 
+    if (weight) {
+        stream->weight = weight;
+    }
+
     if (!request->hpack) {
         request->hpack = new HPack(m_headerTableSize);
+        request->hpack->setEncoderMaxTableSize(request->settingsHeaderTableSize);
     }
 
     if (fr.flags & FlagHeadersEndHeaders) {
@@ -479,41 +557,99 @@ int ProtocolHttp2::parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const
 
 //    qDebug() << "Headers" << padLength << streamDependency << weight << "stream headers size" << stream->headers /*<< QByteArray(ptr + pos, fr.len - pos - padLength).toHex()*/ << ret;
 
-    if ((stream->state == H2Stream::HalfClosed || fr.flags & FlagHeadersEndStream)
-            && request->streamForContinuation == 0) {
+    if (stream->refused) {
+        sendRstStream(io, fr.streamId, ErrorRefusedStream);
+        request->streams.remove(fr.streamId);
+        delete stream;
+        return 0;
+    }
+
+    if (m_maxHeaderListSize) {
+        // As defined by SETTINGS_MAX_HEADER_LIST_SIZE, 32 octets of overhead per field
+        quint64 headerListSize = 0;
+        const auto &entries = stream->headers.entries();
+        for (const auto &entry : entries) {
+            headerListSize += quint64(entry.key.size() + entry.value.size() + 32);
+        }
 
-        // Process request
-        queueStream(request->sock, stream);
+        if (headerListSize > m_maxHeaderListSize) {
+            QByteArray buf;
+            request->hpack->encodeHeaders(431, Cutelyst::Headers(), buf, static_cast<CWsgiEngine *>(request->sock->engine));
+            sendFrame(io, FrameHeaders, FlagHeadersEndStream | FlagHeadersEndHeaders, fr.streamId, buf.constData(), buf.size());
+            if (stream->state == H2Stream::Open) {
+                // Answered before the client finished sending the body
+                sendRstStream(io, fr.streamId, ErrorNoError);
+            }
+            request->streams.remove(fr.streamId);
+            delete stream;
+            return 0;
+        }
+    }
+
+    const QString priority = stream->headers.header(QStringLiteral("PRIORITY"));
+    if (!priority.isEmpty()) {
+        applyPriorityField(stream, priority);
+    }
+
+    if (request->streamForContinuation == 0) {
+        if (stream->streamBody) {
+            // Trailers ending an unbuffered body
+            if (stream->state == H2Stream::HalfClosed) {
+                stream->streamBody->setFinished();
+            }
+        } else if (stream->state == H2Stream::HalfClosed) {
+            // Process request
+            queueStream(request->sock, stream);
+        } else if (m_postUnbuffered) {
+            queueStreamUnbuffered(request, stream);
+        }
     }
 
     return 0;
 }
 
-int ProtocolHttp2::parsePriority(ProtoRequestHttp2 *sock, QIODevice *io, const H2Frame &fr) const
+int ProtocolHttp2::parsePriority(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const
 {
 //    qDebug() << "Consumming PRIORITY";
     if (fr.len != 5) {
-        return sendGoAway(io, sock->maxStreamId, ErrorFrameSizeError);
+        return sendGoAway(io, request->maxStreamId, ErrorFrameSizeError);
     } else if (fr.streamId == 0) {
-        return sendGoAway(io, sock->maxStreamId, ErrorProtocolError);
+        return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
     }
 
-    uint pos = 0;
-    while (fr.len > pos) {
-        // TODO store/disable EXCLUSIVE bit
-        quint32 exclusiveAndStreamDep = net_be32(sock->buffer + 9 + pos);
-//        quint8 weigth = *reinterpret_cast<quint8 *>(sock->buffer + 9 + 4 + pos) + 1;
-//                            settings.push_back({ identifier, value });
-//                            sock->pktsize -= 6;
+    // The exclusive bit and the dependency tree are deprecated by RFC 9113,
+    // the weight still orders incremental streams
+    const quint32 streamDependency = net_be32(request->buffer + 9) & 0x7FFFFFFF;
+    if (fr.streamId == streamDependency) {
+        return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
+    }
 
-        if (fr.streamId == exclusiveAndStreamDep) {
-//            qDebug() << "PRIO error2" << exclusiveAndStreamDep << fr.streamId;
+    auto streamIt = request->streams.constFind(fr.streamId);
+    if (streamIt != request->streams.constEnd()) {
+        streamIt.value()->weight = quint16(quint8(request->buffer[9 + 4])) + 1;
+    }
 
-            return sendGoAway(io, sock->maxStreamId, ErrorProtocolError);
-        }
+    return 0;
+}
+
+int ProtocolHttp2::parsePriorityUpdate(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const
+{
+    if (fr.streamId) {
+        return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
+    } else if (fr.len < 4) {
+        return sendGoAway(io, request->maxStreamId, ErrorFrameSizeError);
+    }
+
+    const quint32 prioritizedStreamId = net_be32(request->buffer + 9) & 0x7FFFFFFF;
+    if (prioritizedStreamId == 0) {
+        return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
+    }
 
-        pos += 6;
-//        qDebug() << "PRIO" << exclusiveAndStreamDep << weigth;
+    // Updates for streams not open yet are dropped, the request
+    // header carries the same information
+    auto streamIt = request->streams.constFind(prioritizedStreamId);
+    if (streamIt != request->streams.constEnd()) {
+        applyPriorityField(streamIt.value(), QString::fromLatin1(request->buffer + 9 + 4, int(fr.len - 4)));
     }
 
     return 0;
@@ -558,6 +694,17 @@ int ProtocolHttp2::parseRstStream(ProtoRequestHttp2 *request, QIODevice *io, con
     }
 
     stream->state = H2Stream::Closed;
+    if (stream->processingDone) {
+        // Only queued data was keeping it alive
+        auto pendingIt = std::find(request->pendingStreams.begin(), request->pendingStreams.end(), stream);
+        if (pendingIt != request->pendingStreams.end()) {
+            request->pendingStreams.erase(pendingIt);
+        }
+        stream->endStream();
+    } else if (stream->streamBody && !stream->streamBody->isFinished()) {
+        // No more body will come, the handlers might finish the request
+        stream->streamBody->setFinished();
+    }
 
 //    quint32 errorCode = h2_be32(request->buffer + 9);
 //    qCDebug(CWSGI_H2) << "RST frame" << errorCode;
@@ -597,7 +744,7 @@ int ProtocolHttp2::parseWindowUpdate(ProtoRequestHttp2 *request, QIODevice *io,
             sendRstStream(io, fr.streamId, ErrorFlowControlError);
         }
         stream->windowSize = result;
-        stream->windowUpdated();
+        sendPendingData(request);
 
     } else {
         quint64 result = request->windowSize + windowSizeIncrement;
@@ -605,14 +752,7 @@ int ProtocolHttp2::parseWindowUpdate(ProtoRequestHttp2 *request, QIODevice *io,
             return sendGoAway(io, request->maxStreamId, ErrorFlowControlError);
         }
         request->windowSize = result;
-
-        if (result > 0) {
-            auto streamIt = request->streams.constBegin();
-            if (streamIt != request->streams.constEnd()) {
-                (*streamIt)->windowUpdated();
-                ++streamIt;
-            }
-        }
+        sendPendingData(request);
     }
 
     return 0;
@@ -672,6 +812,41 @@ int ProtocolHttp2::sendSettingsAck(QIODevice *io) const
     return sendFrame(io, FrameSettings, FlagSettingsAck);
 }
 
+void ProtocolHttp2::sendInitialSettings(ProtoRequestHttp2 *request, QIODevice *io) const
+{
+    std::vector<std::pair<quint16, quint32>> settings = {
+        { SETTINGS_MAX_FRAME_SIZE, m_maxFrameSize },
+        { SETTINGS_HEADER_TABLE_SIZE, m_headerTableSize },
+    };
+    if (m_maxConcurrentStreams) {
+        settings.push_back({ SETTINGS_MAX_CONCURRENT_STREAMS, m_maxConcurrentStreams });
+    }
+    if (m_initialWindowSize != 65535) {
+        settings.push_back({ SETTINGS_INITIAL_WINDOW_SIZE, m_initialWindowSize });
+    }
+    if (m_maxHeaderListSize) {
+        settings.push_back({ SETTINGS_MAX_HEADER_LIST_SIZE, m_maxHeaderListSize });
+    }
+    sendSettings(io, settings);
+
+    // The connection window can only grow with WINDOW_UPDATE
+    if (m_connectionWindowSize > 65535) {
+        sendWindowUpdate(io, 0, m_connectionWindowSize - 65535);
+    }
+    request->recvWindow = qint32(m_connectionWindowSize);
+}
+
+int ProtocolHttp2::sendWindowUpdate(QIODevice *io, quint32 streamId, quint32 increment) const
+{
+    const char data[4] = {
+        char(increment >> 24),
+        char(increment >> 16),
+        char(increment >> 8),
+        char(increment)
+    };
+    return sendFrame(io, FrameWindowUpdate, 0, streamId, data, 4);
+}
+
 int ProtocolHttp2::sendPing(QIODevice *io, quint8 flags, const char *data, qint32 dataLen) const
 {
     return sendFrame(io, FramePing, flags, 0, data, dataLen);
@@ -733,12 +908,86 @@ int ProtocolHttp2::sendFrame(QIODevice *io, quint8 type, quint8 flags, quint32 s
     return 0;
 }
 
+static inline bool h2SendsBefore(const H2Stream *a, const H2Stream *b)
+{
+    if (a->urgency != b->urgency) {
+        return a->urgency < b->urgency;
+    }
+    if (a->incremental != b->incremental) {
+        return !a->incremental;
+    }
+    if (!a->incremental || a->pass == b->pass) {
+        return a->streamId < b->streamId;
+    }
+    return a->pass < b->pass;
+}
+
+void ProtocolHttp2::sendPendingData(ProtoRequestHttp2 *request) const
+{
+    std::vector<H2Stream *> &pending = request->pendingStreams;
+    while (!pending.empty() && request->io->bytesToWrite() < h2SendHighWatermark) {
+        // Most urgent first, non incremental streams one at a time in stream
+        // order, incremental ones interleaved frame by frame by weight
+        auto best = pending.end();
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            const H2Stream *stream = *it;
+            if (stream->state != H2Stream::Closed && (stream->windowSize <= 0 || request->windowSize <= 0)) {
+                continue;
+            }
+
+            if (best == pending.end() || h2SendsBefore(stream, *best)) {
+                best = it;
+            }
+        }
+
+        if (best == pending.end()) {
+            break;
+        }
+
+        H2Stream *stream = *best;
+        const qint64 sent = stream->sendPending(request->settingsMaxFrameSize);
+        if (sent > 0) {
+            request->schedulerPass = stream->pass;
+            stream->pass += quint64(sent) * 256 / stream->weight;
+        }
+
+        if (!stream->hasPendingData()) {
+            pending.erase(best);
+            if (stream->processingDone) {
+                stream->endStream();
+            }
+        }
+    }
+}
+
 void ProtocolHttp2::queueStream(Socket *socket, H2Stream *stream) const
 {
     ++socket->processing;
     Q_EMIT socket->engine->processRequestAsync(stream);
 }
 
+void ProtocolHttp2::queueStreamUnbuffered(ProtoRequestHttp2 *request, H2Stream *stream) const
+{
+    auto body = new PostUnbuffered;
+    body->m_contentLength = stream->headers.contentLength();
+    body->consumed = [this, request, stream] (qint64 len) {
+        stream->recvConsumed += qint32(len);
+        if (stream->recvConsumed >= qint32(m_initialWindowSize / 2)) {
+            // Once the client ended the stream there is nothing left to ask for
+            if (stream->state == H2Stream::Open) {
+                sendWindowUpdate(request->io, stream->streamId, quint32(stream->recvConsumed));
+                stream->recvWindow += stream->recvConsumed;
+            }
+            stream->recvConsumed = 0;
+        }
+    };
+    stream->body = body;
+    stream->streamBody = body;
+
+    // Process request
+    queueStream(request->sock, stream);
+}
+
 bool ProtocolHttp2::upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::EngineRequest &request)
 {
     const Cutelyst::Headers &headers = request.headers;
@@ -771,10 +1020,7 @@ bool ProtocolHttp2::upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::En
             protoRequest->streams.insert(1, stream);
             protoRequest->maxStreamId = 1;
 
-            sendSettings(io, {
-                             { SETTINGS_MAX_FRAME_SIZE, m_maxFrameSize },
-                             { SETTINGS_HEADER_TABLE_SIZE, m_headerTableSize },
-                         });
+            sendInitialSettings(protoRequest, io);
 
             // Process request
             queueStream(socket, stream);
@@ -787,12 +1033,19 @@ bool ProtocolHttp2::upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::En
 
 ProtoRequestHttp2::ProtoRequestHttp2(Socket *sock, int bufferSize) : ProtocolData(sock, bufferSize)
 {
-
+    bytesWrittenConnection = QObject::connect(io, &QIODevice::bytesWritten, [this] () {
+        if (!pendingStreams.empty()) {
+            auto parser = dynamic_cast<ProtocolHttp2 *>(this->sock->proto);
+            if (parser) {
+                parser->sendPendingData(this);
+            }
+        }
+    });
 }
 
 ProtoRequestHttp2::~ProtoRequestHttp2()
 {
-
+    QObject::disconnect(bytesWrittenConnection);
 }
 
 void ProtoRequestHttp2::setupNewConnection(Socket *sock)
@@ -800,6 +1053,28 @@ void ProtoRequestHttp2::setupNewConnection(Socket *sock)
     Q_UNUSED(sock)
 }
 
+void ProtoRequestHttp2::socketDisconnected()
+{
+    // Queued data can't be sent anymore, streams done processing were
+    // only waiting for it and are still counted by the socket, the
+    // others end as soon as their handlers finish
+    auto it = streams.begin();
+    while (it != streams.end()) {
+        H2Stream *stream = *it;
+        if (stream->processingDone) {
+            it = streams.erase(it);
+            --sock->processing;
+            delete stream;
+        } else {
+            stream->state = H2Stream::Closed;
+            stream->sendBuffer.clear();
+            stream->sendOffset = 0;
+            ++it;
+        }
+    }
+    pendingStreams.clear();
+}
+
 H2Stream::H2Stream(quint32 _streamId, qint32 _initialWindowSize, ProtoRequestHttp2 *protoRequestH2)
     : protoRequest(protoRequestH2)
     , streamId(_streamId)
@@ -814,59 +1089,52 @@ H2Stream::H2Stream(quint32 _streamId, qint32 _initialWindowSize, ProtoRequestHtt
 
 H2Stream::~H2Stream()
 {
-    if (loop) {
-        loop->exit(-1);
-        loop->deleteLater();
+    if (!(streamId & 1)) {
+        --protoRequest->pushedStreams;
     }
 }
 
 qint64 H2Stream::doWrite(const char *data, qint64 len)
 {
-    int ret = -1;
-    auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
-
-    qint64 remainingData = len;
-    while (remainingData > 0 && state != H2Stream::Closed) {
-        qint64 availableWindowSize = qMin(windowSize, protoRequest->windowSize);
-//        qCDebug(CWSGI_H2) << "H2Stream::doWrite" << len << streamId << "availableWindowSize" << availableWindowSize
-//                          << "remaining data" << remainingData
-//                          << "stream" << this << protoRequest;
+    if (state == H2Stream::Closed) {
+        return -1;
+    }
 
-        if (availableWindowSize == 0) {
-            if (!loop) {
-                loop = new QEventLoop;
+    qint64 sent = 0;
+    if (!hasPendingData() && protoRequest->pendingStreams.empty()) {
+        const qint64 room = h2SendHighWatermark - protoRequest->io->bytesToWrite();
+        if (room > 0) {
+            sent = sendData(data, len, room);
+            if (sent < 0) {
+                return -1;
             }
-            if (loop->exec() == 0) {
-                continue;
-            }
-            return -1;
         }
+    }
 
-//        qCDebug(CWSGI_H2) << "H2Stream::doWrite" << len << streamId << "availableWindowSize" << availableWindowSize
-//                          << "remaining data" << remainingData;
-
-        if (availableWindowSize > remainingData) {
-            ret = parser->sendFrame(protoRequest->io, FrameData, FlagDataEndStream, streamId, data, len);
-            remainingData = 0;
-            protoRequest->windowSize -= len;
-            windowSize -= len;
+    if (sent < len) {
+        // Out of window or the socket is busy, the connection schedules it
+        // as WINDOW_UPDATEs arrive and the socket drains
+        if (hasPendingData()) {
+            sendBuffer.remove(0, sendOffset);
         } else {
-            ret = parser->sendFrame(protoRequest->io, FrameData, 0x0, streamId, data, availableWindowSize);
-            remainingData -= availableWindowSize;
-            protoRequest->windowSize -= availableWindowSize;
-            windowSize -= availableWindowSize;
+            sendBuffer.clear();
+            pass = protoRequest->schedulerPass;
+            protoRequest->pendingStreams.push_back(this);
         }
+        sendOffset = 0;
+        sendBuffer.append(data + sent, int(len - sent));
 
-//        qCDebug(CWSGI_H2) << "H2Stream::doWrite ret" << ret << (ret == 0 ? len : -1);
+        auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+        parser->sendPendingData(protoRequest);
     }
 
-    return ret == 0 ? len : -1;
+    return len;
 }
 
 bool H2Stream::writeHeaders(quint16 status, const Cutelyst::Headers &headers)
 {
     QByteArray buf;
-    protoRequest->hpack->encodeHeaders(status, headers.data(), buf, static_cast<CWsgiEngine *>(protoRequest->sock->engine));
+    protoRequest->hpack->encodeHeaders(status, headers, buf, static_cast<CWsgiEngine *>(protoRequest->sock->engine));
 
     auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
 
@@ -877,19 +1145,176 @@ bool H2Stream::writeHeaders(quint16 status, const Cutelyst::Headers &headers)
 
 void H2Stream::processingFinished()
 {
-    state = Closed;
+    processingDone = true;
+    releaseContext();
+
+    // Otherwise the connection ends it once the queued data is sent,
+    // the socket only sees the request finished from endStream() so
+    // it isn't put on the keep-alive timeout while data is queued
+    if (!hasPendingData()) {
+        endStream();
+    }
+}
+
+bool H2Stream::pushDo(const QString &pushPath, const Cutelyst::Headers &pushHeaders)
+{
+    // Promises are only associated with client initiated streams
+    if (!protoRequest->canPush || state == H2Stream::Closed || !(streamId & 1)) {
+        return false;
+    }
+
+    // Past the peer's SETTINGS_MAX_CONCURRENT_STREAMS the promise would
+    // be refused, Response::push() sends a preload Link instead
+    if (protoRequest->pushedStreams >= protoRequest->settingsMaxConcurrentStreams) {
+        return false;
+    }
+
+    auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+    const quint32 promisedStreamId = protoRequest->lastPushStreamId + 2;
+    const QString pushScheme = isSecure ? QStringLiteral("https") : QStringLiteral("http");
+
+    QByteArray buf;
+    buf.append(char(promisedStreamId >> 24));
+    buf.append(char(promisedStreamId >> 16));
+    buf.append(char(promisedStreamId >> 8));
+    buf.append(char(promisedStreamId));
+    protoRequest->hpack->encodePushHeaders(pushScheme, serverAddress, pushPath, pushHeaders, buf);
+
+    const int maxFrameSize = int(protoRequest->settingsMaxFrameSize);
+    int pos = qMin(buf.size(), maxFrameSize);
+    if (parser->sendFrame(protoRequest->io, FramePushPromise, pos == buf.size() ? FlagPushPromiseEndHeaders : 0,
+                          streamId, buf.constData(), pos)) {
+        return false;
+    }
+    while (pos < buf.size()) {
+        const int len = qMin(buf.size() - pos, maxFrameSize);
+        parser->sendFrame(protoRequest->io, FrameContinuation, pos + len == buf.size() ? FlagHeadersEndHeaders : 0,
+                          streamId, buf.constData() + pos, len);
+        pos += len;
+    }
+    protoRequest->lastPushStreamId = promisedStreamId;
+
+    auto stream = new H2Stream(promisedStreamId, protoRequest->settingsInitialWindowSize, protoRequest);
+    stream->method = QStringLiteral("GET");
+    stream->scheme = pushScheme;
+    stream->serverAddress = serverAddress;
+    const int queryPos = pushPath.indexOf(QLatin1Char('?'));
+    if (queryPos == -1) {
+        stream->setPath(pushPath);
+    } else {
+        stream->setPath(pushPath.left(queryPos));
+        stream->query = pushPath.mid(queryPos + 1).toLatin1();
+    }
+    stream->headers = pushHeaders;
+    stream->startOfRequest = protoRequest->sock->engine->time();
+
+    // Needed to render this response, so it shares its priority
+    stream->weight = weight;
+    stream->urgency = urgency;
+    stream->incremental = incremental;
+
+    // Reserved (local), sending the response moves it to half closed (remote)
+    stream->state = H2Stream::HalfClosed;
+    protoRequest->streams.insert(promisedStreamId, stream);
+    ++protoRequest->pushedStreams;
+
+    parser->queueStream(protoRequest->sock, stream);
+
+    return true;
+}
+
+qint64 H2Stream::sendData(const char *data, qint64 len, qint64 maxLen)
+{
+    auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+
+    const qint64 toSend = qMin(len, maxLen);
+    qint64 sent = 0;
+    while (sent < toSend) {
+        const qint64 availableWindowSize = qMin(windowSize, protoRequest->windowSize);
+        if (availableWindowSize <= 0) {
+            break;
+        }
+
+        const qint32 frameLen = qint32(qMin(qMin(toSend - sent, availableWindowSize), qint64(protoRequest->settingsMaxFrameSize)));
+        if (parser->sendFrame(protoRequest->io, FrameData, 0x0, streamId, data + sent, frameLen)) {
+            return -1;
+        }
+        sent += frameLen;
+        protoRequest->windowSize -= frameLen;
+        windowSize -= frameLen;
+    }
+
+    return sent;
+}
+
+qint64 H2Stream::sendPending(qint64 maxLen)
+{
+    qint64 sent = 0;
+    if (state != H2Stream::Closed) {
+        sent = sendData(sendBuffer.constData() + sendOffset, sendBuffer.size() - sendOffset, maxLen);
+    }
+
+    if (sent < 0 || state == H2Stream::Closed) {
+        sendBuffer.clear();
+        sendOffset = 0;
+        return sent;
+    }
+
+    sendOffset += int(sent);
+    if (sendOffset == sendBuffer.size()) {
+        sendBuffer.clear();
+        sendOffset = 0;
+    }
+    return sent;
+}
+
+void H2Stream::endStream()
+{
+    if (state != H2Stream::Closed) {
+        auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+        parser->sendFrame(protoRequest->io, FrameData, FlagDataEndStream, streamId);
+        if (state == H2Stream::Open) {
+            // Answered before the client finished sending the body
+            parser->sendRstStream(protoRequest->io, streamId, ErrorNoError);
+        }
+        state = H2Stream::Closed;
+    }
     protoRequest->streams.remove(streamId);
-    protoRequest->sock->requestFinished();
+
+    Socket *sock = protoRequest->sock;
+    const bool finished = processingDone;
     delete this;
+
+    // Might reset the connection data so it must come last
+    if (finished) {
+        sock->requestFinished();
+    }
 }
 
-void H2Stream::windowUpdated()
+// RFC 9218 Priority field, "u=N" urgency and "i" incremental
+static void applyPriorityField(H2Stream *stream, const QString &value)
 {
-//    qDebug() << "WINDOW_UPDATED" << protoRequest->windowSize << windowSize << loop << (loop && loop->isRunning()) << this << protoRequest;
-
-    if (protoRequest->windowSize > 0 && windowSize > 0 && loop && loop->isRunning()) {
-        loop->quit();
+    quint8 urgency = 3;
+    bool incremental = false;
+
+    const QVector<QStringRef> params = value.splitRef(QLatin1Char(','));
+    for (const QStringRef &param : params) {
+        const QStringRef item = param.trimmed();
+        if (item.startsWith(QLatin1String("u="))) {
+            bool ok;
+            const uint u = item.mid(2).toUInt(&ok);
+            if (ok && u <= 7) {
+                urgency = quint8(u);
+            }
+        } else if (item == QLatin1String("i") || item == QLatin1String("i=?1")) {
+            incremental = true;
+        } else if (item == QLatin1String("i=?0")) {
+            incremental = false;
+        }
     }
+
+    stream->urgency = urgency;
+    stream->incremental = incremental;
 }
 
 #include "moc_protocolhttp2.cpp"
@@ -24,11 +24,14 @@
 #include "socket.h"
 #include "hpack.h"
 
+#include <vector>
+
 //namespace Cutelyst {
 //class Headers;
 //}
 
-class QEventLoop;
+class PostUnbuffered;
+
 namespace CWSGI {
 
 class H2Frame
@@ -59,17 +62,37 @@ public:
 
     virtual void processingFinished() override final;
 
-    void windowUpdated();
+    virtual bool pushDo(const QString &path, const Cutelyst::Headers &headers) override final;
+
+    qint64 sendData(const char *data, qint64 len, qint64 maxLen);
+    qint64 sendPending(qint64 maxLen);
+    void endStream();
+
+    inline bool hasPendingData() const { return sendOffset < sendBuffer.size(); }
 
-    QEventLoop *loop = nullptr;
+    QByteArray sendBuffer;
     QString scheme;
+    // Set when dispatched before the body was received
+    PostUnbuffered *streamBody = nullptr;
     ProtoRequestHttp2 *protoRequest;
     quint32 streamId;
     qint32 windowSize = 65535;
+    // Request body bytes the client may still send
+    qint32 recvWindow = 65535;
+    // Body read by the application but not yet given back to the client
+    qint32 recvConsumed = 0;
     qint64 contentLength = -1;
     qint32 dataSent = 0;
     qint64 consumedData = 0;
+    // Stride scheduling position, advanced by bytes sent over weight
+    quint64 pass = 0;
+    int sendOffset = 0;
+    quint16 weight = 16;
+    quint8 urgency = 3;
     quint8 state = Idle;
+    bool incremental = true;
+    bool processingDone = false;
+    bool refused = false;
 };
 
 class ProtoRequestHttp2 : public ProtocolData
@@ -80,6 +103,7 @@ public:
     ~ProtoRequestHttp2() override;
 
     virtual void setupNewConnection(Socket *sock) override final;
+    virtual void socketDisconnected() override final;
 
     inline virtual void resetData() override final {
         ProtocolData::resetData();
@@ -88,15 +112,22 @@ public:
         pktsize = 0;
         delete hpack;
         hpack = nullptr;
+        pendingStreams.clear();
+        schedulerPass = 0;
         qDeleteAll(streams);
         streams.clear();
+        pushedStreams = 0;
         headersBuffer.clear();
         maxStreamId = 0;
         streamForContinuation = 0;
+        lastPushStreamId = 0;
         dataSent = 0;
         windowSize = 65535;
+        recvWindow = 65535;
         settingsInitialWindowSize = 65535;
-        canPush = false;
+        settingsHeaderTableSize = 4096;
+        settingsMaxConcurrentStreams = 0xFFFFFFFF;
+        canPush = true;
     }
 
     quint32 stream_id = 0;
@@ -106,14 +137,26 @@ public:
     HPack *hpack = nullptr;
     quint64 streamForContinuation = 0;
     quint32 maxStreamId = 0;
+    quint32 lastPushStreamId = 0;
     qint32 dataSent = 0;
     qint32 windowSize = 65535;
+    qint32 recvWindow = 65535;
     qint32 settingsInitialWindowSize = 65535;
     quint32 settingsMaxFrameSize = 16384;
+    quint32 settingsHeaderTableSize = 4096;
+    // Limits the streams we push, unlimited until the peer sets it
+    quint32 settingsMaxConcurrentStreams = 0xFFFFFFFF;
+    // Promised streams that didn't end yet
+    quint32 pushedStreams = 0;
     quint8 processing = 0;
     bool canPush = true;
 
     QHash<quint32, H2Stream *> streams;
+    // Streams with DATA waiting for flow control window or for the
+    // socket to drain, in the order ProtocolHttp2::sendPendingData picks
+    std::vector<H2Stream *> pendingStreams;
+    quint64 schedulerPass = 0;
+    QMetaObject::Connection bytesWrittenConnection;
 };
 
 class ProtocolHttp2 : public Protocol
@@ -132,6 +175,7 @@ public:
     int parseData(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
     int parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
     int parsePriority(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
+    int parsePriorityUpdate(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
     int parsePing(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
     int parseRstStream(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
     int parseWindowUpdate(ProtoRequestHttp2 *request, QIODevice *io, const H2Frame &fr) const;
@@ -140,17 +184,25 @@ public:
     int sendRstStream(QIODevice *io, quint32 streamId, quint32 error) const;
     int sendSettings(QIODevice *io, const std::vector<std::pair<quint16, quint32> > &settings) const;
     int sendSettingsAck(QIODevice *io) const;
+    void sendInitialSettings(ProtoRequestHttp2 *request, QIODevice *io) const;
+    int sendWindowUpdate(QIODevice *io, quint32 streamId, quint32 increment) const;
     int sendPing(QIODevice *io, quint8 flags, const char *data = nullptr, qint32 dataLen = 0) const;
     int sendData(QIODevice *io, quint32 streamId, qint32 flags, const char *data, qint32 dataLen) const;
     int sendFrame(QIODevice *io, quint8 type, quint8 flags = 0, quint32 streamId = 0, const char *data = nullptr, qint32 dataLen = 0) const;
+    void sendPendingData(ProtoRequestHttp2 *request) const;
 
     void queueStream(Socket *socket, H2Stream *stream) const;
+    void queueStreamUnbuffered(ProtoRequestHttp2 *request, H2Stream *stream) const;
 
     bool upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::EngineRequest &request);
 
 public:
     quint32 m_maxFrameSize;
     quint32 m_headerTableSize;
+    quint32 m_maxConcurrentStreams;
+    quint32 m_initialWindowSize;
+    quint32 m_connectionWindowSize;
+    quint32 m_maxHeaderListSize;
 };
 
 }
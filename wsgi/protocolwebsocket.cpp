@@ -217,10 +217,15 @@ void ProtocolWebSocket::send_binary(Cutelyst::Context *c, Socket *sock, bool sin
     }
 }
 
-void ProtocolWebSocket::send_pong(QIODevice *io, const QByteArray data) const
+void ProtocolWebSocket::send_pong(Socket *sock, const QByteArray data) const
 {
-    io->write(ProtocolWebSocket::createWebsocketHeader(ProtoRequestHttp::OpCodePong, quint64(data.size())));
-    io->write(data);
+    const QByteArray header = ProtocolWebSocket::createWebsocketHeader(ProtoRequestHttp::OpCodePong, quint64(data.size()));
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char *>(header.constData());
+    iov[0].iov_len = size_t(header.size());
+    iov[1].iov_base = const_cast<char *>(data.constData());
+    iov[1].iov_len = size_t(data.size());
+    sock->writev(iov, 2);
 }
 
 void ProtocolWebSocket::send_closed(Cutelyst::Context *c, Socket *sock, QIODevice *io) const
@@ -423,7 +428,7 @@ bool ProtocolWebSocket::websocket_parse_payload(Socket *sock, char *buf, int len
         send_closed(protoRequest->context, sock, io);
         return false;
     case ProtoRequestHttp::OpCodePing:
-        send_pong(io, protoRequest->websocket_payload.left(125));
+        send_pong(sock, protoRequest->websocket_payload.left(125));
         break;
     case ProtoRequestHttp::OpCodePong:
         Q_EMIT request->webSocketPong(protoRequest->websocket_payload,
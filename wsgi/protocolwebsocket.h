@@ -45,7 +45,7 @@ public:
 private:
     bool send_text(Cutelyst::Context *c, Socket *sock, bool singleFrame) const;
     void send_binary(Cutelyst::Context *c, Socket *sock, bool singleFrame) const;
-    void send_pong(QIODevice *io, const QByteArray data) const;
+    void send_pong(Socket *sock, const QByteArray data) const;
     void send_closed(Cutelyst::Context *c, Socket *sock, QIODevice *io) const;
     bool websocket_parse_header(Socket *sock, const char *buf, QIODevice *io) const;
     bool websocket_parse_size(Socket *sock, const char *buf, int websockets_max_message_size) const;
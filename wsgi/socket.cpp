@@ -21,10 +21,48 @@
 
 #include <QLoggingCategory>
 
+#ifdef Q_OS_UNIX
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 Q_LOGGING_CATEGORY(CWSGI_SOCK, "cwsgi.socket", QtWarningMsg)
 
 using namespace CWSGI;
 
+#ifdef Q_OS_UNIX
+#ifndef MSG_NOSIGNAL
+// Qt sets SO_NOSIGPIPE on the sockets where this is missing
+#  define MSG_NOSIGNAL 0
+#endif
+
+// writev() that reports a client that went away as EPIPE instead of raising SIGPIPE
+static ssize_t sendv(int fd, const struct iovec *iov, int count)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = size_t(qMin(count, IOV_MAX));
+
+    ssize_t ret;
+    do {
+        ret = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (ret == -1 && errno == EINTR);
+    return ret;
+}
+#endif
+
 Socket::Socket(bool secure, Cutelyst::Engine *_engine) : engine(_engine), isSecure(secure)
 {
 
@@ -35,6 +73,52 @@ Socket::~Socket()
     delete protoData;
 }
 
+qint64 Socket::writevDevice(QIODevice *io, qintptr fd, const struct iovec *iov, int count)
+{
+    qint64 total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += qint64(iov[i].iov_len);
+    }
+
+    int i = 0;
+    size_t offset = 0;
+#ifdef Q_OS_UNIX
+    // Data already queued by Qt must reach the peer first
+    if (fd != -1 && !io->bytesToWrite()) {
+        ssize_t ret = sendv(int(fd), iov, count);
+
+        if (ret == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qCDebug(CWSGI_SOCK) << "Failed to sendmsg" << errno;
+                return -1;
+            }
+            ret = 0;
+        }
+
+        // Skip what the kernel already took
+        size_t written = size_t(ret);
+        while (i < count && written >= iov[i].iov_len) {
+            written -= iov[i].iov_len;
+            ++i;
+        }
+        offset = written;
+    }
+#else
+    Q_UNUSED(fd)
+#endif
+
+    // The rest is queued on the QIODevice buffer
+    for (; i < count; ++i) {
+        const qint64 len = qint64(iov[i].iov_len - offset);
+        if (len && io->write(static_cast<const char *>(iov[i].iov_base) + offset, len) != len) {
+            return -1;
+        }
+        offset = 0;
+    }
+
+    return total;
+}
+
 TcpSocket::TcpSocket(Cutelyst::Engine *engine, QObject *parent) : QTcpSocket(parent), Socket(false, engine)
 {
     connect(this, &QTcpSocket::disconnected, this, &TcpSocket::socketDisconnected, Qt::DirectConnection);
@@ -48,13 +132,23 @@ void TcpSocket::connectionClose()
 
 void TcpSocket::requestFinished()
 {
-    if (!--processing && state() != ConnectedState) {
-        Q_EMIT finished();
+    if (!--processing) {
+        if (state() != ConnectedState) {
+            Q_EMIT finished();
+        } else {
+            static_cast<CWsgiEngine *>(engine)->touchSocket(this);
+        }
     }
 }
 
+qint64 TcpSocket::writev(const struct iovec *iov, int count)
+{
+    return writevDevice(this, socketDescriptor(), iov, count);
+}
+
 void TcpSocket::socketDisconnected()
 {
+    static_cast<CWsgiEngine *>(engine)->removeSocketTimeout(this);
     protoData->socketDisconnected();
 
     if (!processing) {
@@ -62,6 +156,336 @@ void TcpSocket::socketDisconnected()
     }
 }
 
+#ifdef Q_OS_LINUX
+
+NativeSocket::NativeSocket(EventDispatcherEPoll *dispatcher, Cutelyst::Engine *engine, QObject *parent) : QIODevice(parent), Socket(false, engine)
+  , m_dispatcher(dispatcher)
+{
+}
+
+NativeSocket::~NativeSocket()
+{
+    if (m_fd != -1) {
+        m_dispatcher->unregisterNativeSocket(m_fd);
+        ::close(m_fd);
+    }
+}
+
+bool NativeSocket::setSocketDescriptor(qintptr socketDescriptor)
+{
+    const int fd = int(socketDescriptor);
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags == -1 || (!(flags & O_NONBLOCK) && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+        return false;
+    }
+
+    if (!m_dispatcher->registerNativeSocket(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, this)) {
+        return false;
+    }
+
+    m_fd = fd;
+    m_readable = true;
+    m_closing = false;
+    m_peerClosed = false;
+    m_writeBuffer.clear();
+    m_writeOffset = 0;
+    setErrorString(QString());
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    return true;
+}
+
+QHostAddress NativeSocket::peerAddress() const
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (::getpeername(m_fd, reinterpret_cast<struct sockaddr *>(&addr), &len) == -1) {
+        return QHostAddress();
+    }
+    return QHostAddress(reinterpret_cast<struct sockaddr *>(&addr));
+}
+
+quint16 NativeSocket::peerPort() const
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (::getpeername(m_fd, reinterpret_cast<struct sockaddr *>(&addr), &len) == -1) {
+        return 0;
+    }
+
+    if (addr.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port);
+    }
+    return ntohs(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port);
+}
+
+void NativeSocket::setSocketOption(QAbstractSocket::SocketOption option, const QVariant &value)
+{
+    int level = SOL_SOCKET;
+    int name;
+    switch (option) {
+    case QAbstractSocket::LowDelayOption:
+        level = IPPROTO_TCP;
+        name = TCP_NODELAY;
+        break;
+    case QAbstractSocket::KeepAliveOption:
+        name = SO_KEEPALIVE;
+        break;
+    case QAbstractSocket::SendBufferSizeSocketOption:
+        name = SO_SNDBUF;
+        break;
+    case QAbstractSocket::ReceiveBufferSizeSocketOption:
+        name = SO_RCVBUF;
+        break;
+    default:
+        qCWarning(CWSGI_SOCK) << "Unsupported native socket option" << option;
+        return;
+    }
+
+    const int v = value.toInt();
+    if (::setsockopt(m_fd, level, name, &v, sizeof(v)) == -1) {
+        qCDebug(CWSGI_SOCK) << "Failed to set socket option" << option << errno;
+    }
+}
+
+void NativeSocket::connectionClose()
+{
+    if (m_fd == -1) {
+        return;
+    }
+
+    if (m_writeBuffer.size() == m_writeOffset) {
+        disconnectSocket();
+    } else {
+        // Closed once EPOLLOUT drains the write buffer
+        m_closing = true;
+    }
+}
+
+void NativeSocket::requestFinished()
+{
+    if (!--processing) {
+        if (m_fd == -1) {
+            Q_EMIT finished();
+        } else {
+            static_cast<CWsgiEngine *>(engine)->touchSocket(this);
+        }
+    }
+}
+
+qint64 NativeSocket::writev(const struct iovec *iov, int count)
+{
+    if (m_fd == -1) {
+        return -1;
+    }
+
+    qint64 total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += qint64(iov[i].iov_len);
+    }
+
+    int i = 0;
+    size_t offset = 0;
+    // Data already queued must reach the peer first
+    if (m_writeBuffer.size() == m_writeOffset) {
+        ssize_t ret = sendv(m_fd, iov, count);
+
+        if (ret == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qCDebug(CWSGI_SOCK) << "Failed to sendmsg" << errno;
+                setErrorString(QString::fromLatin1(strerror(errno)));
+                return -1;
+            }
+            ret = 0;
+        }
+
+        size_t written = size_t(ret);
+        while (i < count && written >= iov[i].iov_len) {
+            written -= iov[i].iov_len;
+            ++i;
+        }
+        offset = written;
+    }
+
+    for (; i < count; ++i) {
+        queueWrite(static_cast<const char *>(iov[i].iov_base) + offset, qint64(iov[i].iov_len - offset));
+        offset = 0;
+    }
+
+    return total;
+}
+
+void NativeSocket::socketDisconnected()
+{
+    static_cast<CWsgiEngine *>(engine)->removeSocketTimeout(this);
+    protoData->socketDisconnected();
+
+    if (!processing) {
+        Q_EMIT finished();
+    }
+}
+
+bool NativeSocket::isSequential() const
+{
+    return true;
+}
+
+qint64 NativeSocket::bytesAvailable() const
+{
+    if (!m_readable || m_fd == -1) {
+        return 0;
+    }
+
+    int available = 0;
+    if (::ioctl(m_fd, FIONREAD, &available) == -1 || available == 0) {
+        m_readable = false;
+        return 0;
+    }
+    return available;
+}
+
+qint64 NativeSocket::bytesToWrite() const
+{
+    return m_writeBuffer.size() - m_writeOffset;
+}
+
+void NativeSocket::close()
+{
+    connectionClose();
+}
+
+qint64 NativeSocket::readData(char *data, qint64 maxlen)
+{
+    if (m_fd == -1) {
+        return -1;
+    }
+
+    ssize_t ret;
+    do {
+        ret = ::recv(m_fd, data, size_t(maxlen), 0);
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret > 0) {
+        if (ret < maxlen) {
+            m_readable = false;
+        }
+        return ret;
+    }
+
+    m_readable = false;
+    if (ret == 0) {
+        // Disconnected after the current event is processed
+        m_peerClosed = true;
+        return 0;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+    }
+
+    setErrorString(QString::fromLatin1(strerror(errno)));
+    m_peerClosed = true;
+    return -1;
+}
+
+qint64 NativeSocket::writeData(const char *data, qint64 len)
+{
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(data);
+    iov.iov_len = size_t(len);
+    return writev(&iov, 1);
+}
+
+void NativeSocket::epollEvent(quint32 events)
+{
+    if (events & EPOLLOUT) {
+        if (m_writeBuffer.size() != m_writeOffset) {
+            flushWrite();
+        } else {
+            Q_EMIT writable();
+        }
+        if (m_fd == -1) {
+            return;
+        }
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP)) {
+        m_readable = true;
+        Q_EMIT readyRead();
+        if (m_fd == -1) {
+            return;
+        }
+    }
+
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        disconnectSocket();
+    } else if (m_peerClosed || events & EPOLLRDHUP) {
+        // Replies already queued still go out
+        connectionClose();
+    }
+}
+
+void NativeSocket::queueWrite(const char *data, qint64 len)
+{
+    if (m_writeOffset == m_writeBuffer.size()) {
+        m_writeBuffer.clear();
+        m_writeOffset = 0;
+    }
+    m_writeBuffer.append(data, int(len));
+}
+
+void NativeSocket::flushWrite()
+{
+    qint64 written = 0;
+    while (m_writeOffset < m_writeBuffer.size()) {
+        const ssize_t ret = ::send(m_fd, m_writeBuffer.constData() + m_writeOffset,
+                                   size_t(m_writeBuffer.size() - m_writeOffset), MSG_NOSIGNAL);
+        if (ret > 0) {
+            m_writeOffset += int(ret);
+            written += ret;
+        } else if (ret == -1 && errno == EINTR) {
+            continue;
+        } else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            setErrorString(QString::fromLatin1(strerror(errno)));
+            m_writeBuffer.clear();
+            m_writeOffset = 0;
+            disconnectSocket();
+            return;
+        }
+    }
+
+    if (m_writeOffset == m_writeBuffer.size()) {
+        m_writeBuffer.clear();
+        m_writeOffset = 0;
+    }
+
+    if (written) {
+        Q_EMIT bytesWritten(written);
+    }
+
+    if (m_closing && m_fd != -1 && m_writeBuffer.isEmpty()) {
+        disconnectSocket();
+    }
+}
+
+void NativeSocket::disconnectSocket()
+{
+    if (m_fd == -1) {
+        return;
+    }
+
+    m_dispatcher->unregisterNativeSocket(m_fd);
+    ::close(m_fd);
+    m_fd = -1;
+    m_readable = false;
+    m_writeBuffer.clear();
+    m_writeOffset = 0;
+    QIODevice::close();
+
+    socketDisconnected();
+}
+
+#endif // Q_OS_LINUX
+
 LocalSocket::LocalSocket(Cutelyst::Engine *engine, QObject *parent) : QLocalSocket(parent), Socket(false, engine)
 {
     connect(this, &QLocalSocket::disconnected, this, &LocalSocket::socketDisconnected, Qt::DirectConnection);
@@ -75,13 +499,23 @@ void LocalSocket::connectionClose()
 
 void LocalSocket::requestFinished()
 {
-    if (!--processing && state() != ConnectedState) {
-        Q_EMIT finished();
+    if (!--processing) {
+        if (state() != ConnectedState) {
+            Q_EMIT finished();
+        } else {
+            static_cast<CWsgiEngine *>(engine)->touchSocket(this);
+        }
     }
 }
 
+qint64 LocalSocket::writev(const struct iovec *iov, int count)
+{
+    return writevDevice(this, socketDescriptor(), iov, count);
+}
+
 void LocalSocket::socketDisconnected()
 {
+    static_cast<CWsgiEngine *>(engine)->removeSocketTimeout(this);
     protoData->socketDisconnected();
 
     if (!processing) {
@@ -104,13 +538,24 @@ void SslSocket::connectionClose()
 
 void SslSocket::requestFinished()
 {
-    if (!--processing && state() != ConnectedState) {
-        Q_EMIT finished();
+    if (!--processing) {
+        if (state() != ConnectedState) {
+            Q_EMIT finished();
+        } else {
+            static_cast<CWsgiEngine *>(engine)->touchSocket(this);
+        }
     }
 }
 
+qint64 SslSocket::writev(const struct iovec *iov, int count)
+{
+    // Everything has to go through the TLS layer
+    return writevDevice(this, -1, iov, count);
+}
+
 void SslSocket::socketDisconnected()
 {
+    static_cast<CWsgiEngine *>(engine)->removeSocketTimeout(this);
     protoData->socketDisconnected();
 
     if (!processing) {
@@ -29,6 +29,14 @@
 
 #include "protocol.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/uio.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include "../EventLoopEPoll/eventdispatcher_epoll.h"
+#endif
+
 class QIODevice;
 
 namespace Cutelyst {
@@ -37,6 +45,13 @@ class Engine;
 
 namespace CWSGI {
 
+#ifndef Q_OS_UNIX
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
 class WSGI;
 class Socket
 {
@@ -48,6 +63,13 @@ public:
     virtual void connectionClose() = 0;
     virtual void requestFinished() = 0;
 
+    /**
+     * Writes the \p count buffers of \p iov in order, with a single
+     * writev() when nothing is pending on the QIODevice buffer,
+     * returns the number of bytes written or -1 on error
+     */
+    virtual qint64 writev(const struct iovec *iov, int count) = 0;
+
     inline void resetSocket() {
         if (protoData->upgradedFrom) {
             ProtocolData *data = protoData->upgradedFrom;
@@ -65,9 +87,16 @@ public:
     Cutelyst::Engine *engine;
     Protocol *proto;
     ProtocolData *protoData = nullptr;
+    // Links of the CWsgiEngine idle timeout list this socket is on
+    Socket *timeoutPrev = nullptr;
+    Socket *timeoutNext = nullptr;
+    qint64 timeoutDeadline = 0;
+    qint8 timeoutList = -1;
     quint8 processing = 0;
     bool isSecure;
-    bool timeout = false;
+
+protected:
+    static qint64 writevDevice(QIODevice *io, qintptr fd, const struct iovec *iov, int count);
 };
 
 class TcpSocket : public QTcpSocket, public Socket
@@ -78,6 +107,7 @@ public:
 
     virtual void connectionClose() override final;
     virtual void requestFinished() override final;
+    virtual qint64 writev(const struct iovec *iov, int count) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -97,6 +127,7 @@ public:
 
     virtual void connectionClose() override final;
     virtual void requestFinished() override final;
+    virtual qint64 writev(const struct iovec *iov, int count) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -106,6 +137,66 @@ Q_SIGNALS:
 
 #endif // QT_NO_SSL
 
+#ifdef Q_OS_LINUX
+
+/**
+ * Plain TCP socket driven directly by EventDispatcherEPoll with
+ * edge-triggered events, reads go from the kernel straight into the
+ * caller's buffer and only what the kernel refuses is kept for writing
+ */
+class NativeSocket : public QIODevice, public Socket, public EventDispatcherEPollWatcher
+{
+    Q_OBJECT
+public:
+    explicit NativeSocket(EventDispatcherEPoll *dispatcher, Cutelyst::Engine *engine, QObject *parent = nullptr);
+    virtual ~NativeSocket() override;
+
+    bool setSocketDescriptor(qintptr socketDescriptor);
+    inline qintptr socketDescriptor() const { return m_fd; }
+    inline bool isConnected() const { return m_fd != -1; }
+
+    QHostAddress peerAddress() const;
+    quint16 peerPort() const;
+    void setSocketOption(QAbstractSocket::SocketOption option, const QVariant &value);
+
+    virtual void connectionClose() override final;
+    virtual void requestFinished() override final;
+    virtual qint64 writev(const struct iovec *iov, int count) override final;
+    void socketDisconnected();
+
+    virtual bool isSequential() const override;
+    virtual qint64 bytesAvailable() const override;
+    virtual qint64 bytesToWrite() const override;
+    virtual void close() override;
+
+Q_SIGNALS:
+    // See TcpSocket note
+    void finished();
+    // EPOLLOUT with nothing queued, for writes that bypass this device
+    void writable();
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) override;
+    virtual qint64 writeData(const char *data, qint64 len) override;
+    virtual void epollEvent(quint32 events) override;
+
+private:
+    void queueWrite(const char *data, qint64 len);
+    void flushWrite();
+    void disconnectSocket();
+
+    EventDispatcherEPoll *m_dispatcher;
+    QByteArray m_writeBuffer;
+    int m_writeOffset = 0;
+    int m_fd = -1;
+    // Cleared once the kernel was drained, a new edge sets it again
+    mutable bool m_readable = false;
+    bool m_closing = false;
+    bool m_peerClosed = false;
+};
+
+#endif // Q_OS_LINUX
+
 class LocalSocket : public QLocalSocket, public Socket
 {
     Q_OBJECT
@@ -114,6 +205,7 @@ public:
 
     virtual void connectionClose() override final;
     virtual void requestFinished() override final;
+    virtual qint64 writev(const struct iovec *iov, int count) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -23,6 +23,10 @@
 #include <Cutelyst/Engine>
 #include <QDateTime>
 
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
 using namespace CWSGI;
 
 TcpServer::TcpServer(const QString &serverAddress, Protocol *protocol, WSGI *wsgi, QObject *parent) : QTcpServer(parent)
@@ -44,10 +48,20 @@ TcpServer::TcpServer(const QString &serverAddress, Protocol *protocol, WSGI *wsg
     if (m_wsgi->socketRcvbuf() != -1) {
         m_socketOptions.push_back({ QAbstractSocket::ReceiveBufferSizeSocketOption, m_wsgi->socketRcvbuf() });
     }
+#ifdef Q_OS_LINUX
+    m_nativeSockets = m_wsgi->nativeSockets();
+#endif
 }
 
 void TcpServer::incomingConnection(qintptr handle)
 {
+#ifdef Q_OS_LINUX
+    if (m_nativeSockets) {
+        incomingNativeConnection(handle);
+        return;
+    }
+#endif
+
     TcpSocket *sock;
     if (!m_socks.empty()) {
         sock = m_socks.back();
@@ -57,9 +71,11 @@ void TcpServer::incomingConnection(qintptr handle)
         sock->serverAddress = m_serverAddress;
         sock->protoData = m_protocol->createData(sock);
 
-        connect(sock, &QIODevice::readyRead, [sock] () {
-            sock->timeout = false;
+        connect(sock, &QIODevice::readyRead, [this, sock] () {
             sock->proto->parse(sock, sock);
+            if (sock->state() == QAbstractSocket::ConnectedState) {
+                m_engine->touchSocket(sock);
+            }
         });
         connect(sock, &TcpSocket::finished, this, [this, sock] () {
             sock->resetSocket();
@@ -82,11 +98,97 @@ void TcpServer::incomingConnection(qintptr handle)
         if (++m_processing) {
             m_engine->startSocketTimeout();
         }
+        m_engine->touchSocket(sock);
     } else {
         m_socks.push_back(sock);
     }
 }
 
+#ifdef Q_OS_LINUX
+void TcpServer::incomingNativeConnection(qintptr handle)
+{
+    if (Q_UNLIKELY(!m_nativeDispatcher)) {
+        // Only known once running on the engine's thread
+        m_nativeDispatcher = qobject_cast<EventDispatcherEPoll *>(QAbstractEventDispatcher::instance());
+        if (!m_nativeDispatcher) {
+            qWarning("Native sockets require the EPoll event loop, using QTcpSocket");
+            m_nativeSockets = false;
+            incomingConnection(handle);
+            return;
+        }
+    }
+
+    NativeSocket *sock;
+    if (!m_nativeSocks.empty()) {
+        sock = m_nativeSocks.back();
+        m_nativeSocks.pop_back();
+    } else {
+        sock = new NativeSocket(m_nativeDispatcher, m_engine, this);
+        sock->serverAddress = m_serverAddress;
+        sock->protoData = m_protocol->createData(sock);
+
+        connect(sock, &QIODevice::readyRead, [this, sock] () {
+            sock->proto->parse(sock, sock);
+            if (sock->isConnected()) {
+                m_engine->touchSocket(sock);
+            }
+        });
+        connect(sock, &NativeSocket::finished, this, [this, sock] () {
+            sock->resetSocket();
+            m_nativeSocks.push_back(sock);
+            --m_processing;
+        }, Qt::QueuedConnection);
+    }
+
+    if (Q_LIKELY(sock->setSocketDescriptor(handle))) {
+        sock->proto = m_protocol;
+
+        sock->remoteAddress = sock->peerAddress();
+        sock->remotePort = sock->peerPort();
+        sock->protoData->setupNewConnection(sock);
+
+        for (const auto &opt : m_socketOptions) {
+            sock->setSocketOption(opt.first, opt.second);
+        }
+
+        if (++m_processing) {
+            m_engine->startSocketTimeout();
+        }
+        m_engine->touchSocket(sock);
+    } else {
+        ::close(int(handle));
+        m_nativeSocks.push_back(sock);
+    }
+}
+#endif // Q_OS_LINUX
+
+void TcpServer::queueConnection(qintptr handle)
+{
+    ++m_queued;
+
+    m_queueMutex.lock();
+    const bool wakeUp = m_queue.empty();
+    m_queue.push_back(handle);
+    m_queueMutex.unlock();
+
+    if (wakeUp) {
+        Q_EMIT connectionsQueued();
+    }
+}
+
+void TcpServer::processQueuedConnections()
+{
+    std::vector<qintptr> queue;
+    m_queueMutex.lock();
+    queue.swap(m_queue);
+    m_queueMutex.unlock();
+
+    m_queued -= int(queue.size());
+    for (qintptr handle : queue) {
+        incomingConnection(handle);
+    }
+}
+
 void TcpServer::shutdown()
 {
     if (isListening()) {
@@ -107,23 +209,17 @@ void TcpServer::shutdown()
                     }
                 });
             }
-        }
-    }
-}
-
-void TcpServer::timeoutConnections()
-{
-    if (m_processing) {
-        const auto childrenL = children();
-        for (auto child : childrenL) {
-            auto socket = qobject_cast<TcpSocket*>(child);
-            if (socket && !socket->processing && socket->state() == QAbstractSocket::ConnectedState) {
-                if (socket->timeout) {
-                    socket->connectionClose();
-                } else {
-                    socket->timeout = true;
-                }
+#ifdef Q_OS_LINUX
+            auto nativeSocket = qobject_cast<NativeSocket*>(child);
+            if (nativeSocket) {
+                nativeSocket->protoData->headerConnection = ProtocolData::HeaderConnectionClose;
+                connect(nativeSocket, &NativeSocket::finished, this, [this] () {
+                    if (!m_processing) {
+                        m_engine->serverShutdown();
+                    }
+                });
             }
+#endif
         }
     }
 }
@@ -19,12 +19,18 @@
 #define TCPSERVER_H
 
 #include <QTcpServer>
+#include <QMutex>
+
+#include <atomic>
+
+class EventDispatcherEPoll;
 
 namespace CWSGI {
 
 class WSGI;
 class Protocol;
 class TcpSocket;
+class NativeSocket;
 class CWsgiEngine;
 class TcpServer : public QTcpServer
 {
@@ -36,17 +42,31 @@ public:
     virtual void incomingConnection(qintptr handle) override;
 
     virtual void shutdown();
-    virtual void timeoutConnections();
+
+    /**
+     * Hands \p handle accepted on another thread to this server, only the first
+     * connection of a batch wakes up the server's thread
+     */
+    void queueConnection(qintptr handle);
+    void processQueuedConnections();
 
     Protocol *protocol() const;
     void setProtocol(Protocol *protocol);
 
 Q_SIGNALS:
-    void createConnection(qintptr handle);
+    void connectionsQueued();
 
 protected:
     friend class TcpServerBalancer;
 
+#ifdef Q_OS_LINUX
+    void incomingNativeConnection(qintptr handle);
+
+    std::vector<NativeSocket *> m_nativeSocks;
+    EventDispatcherEPoll *m_nativeDispatcher = nullptr;
+    bool m_nativeSockets = false;
+#endif
+
     QString m_serverAddress;
     CWsgiEngine *m_engine;
     WSGI *m_wsgi;
@@ -54,7 +74,12 @@ protected:
     std::vector<std::pair<QAbstractSocket::SocketOption, QVariant> > m_socketOptions;
     std::vector<TcpSocket *> m_socks;
     Protocol *m_protocol;
-    int m_processing = 0;
+    // Written by the worker thread, read by the balancer
+    std::atomic<int> m_processing{0};
+    std::atomic<int> m_queued{0};
+    QMutex m_queueMutex;
+    std::vector<qintptr> m_queue;
+    int m_reuseSocket = -1;
 };
 
 }
@@ -28,12 +28,19 @@
 #include <QSslKey>
 
 #include <iostream>
+#include <algorithm>
 
-#ifdef Q_OS_LINUX
-#include <arpa/inet.h>
+#ifdef Q_OS_UNIX
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <arpa/inet.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 #endif
 
 
@@ -42,7 +49,7 @@ Q_LOGGING_CATEGORY(CWSGI_BALANCER, "wsgi.tcp_server_balancer", QtWarningMsg)
 using namespace CWSGI;
 
 #ifdef Q_OS_LINUX
-int listenReuse(const QHostAddress &address, quint16 port, bool startListening);
+int listenReuse(const QHostAddress &address, quint16 port, int backlog, bool startListening);
 #endif
 
 TcpServerBalancer::TcpServerBalancer(WSGI *wsgi) : QTcpServer(wsgi)
@@ -138,7 +145,7 @@ bool TcpServerBalancer::listen(const QString &line, Protocol *protocol, bool sec
 
 #ifdef Q_OS_LINUX
     if (m_wsgi->reusePort()) {
-        int socket = listenReuse(address, port, false);
+        int socket = listenReuse(address, port, m_wsgi->listenBacklog(), false);
         if (socket > 0) {
             setSocketDescriptor(socket);
             pauseAccepting();
@@ -149,8 +156,16 @@ bool TcpServerBalancer::listen(const QString &line, Protocol *protocol, bool sec
         }
     } else {
 #endif
+        setMaxPendingConnections(m_wsgi->listenBacklog());
         bool ret = QTcpServer::listen(address, port);
         if (ret) {
+#ifdef Q_OS_UNIX
+            // Qt 5 always listens with a backlog of 50, listen() again
+            // on the bound socket just updates the queue size
+            if (::listen(int(socketDescriptor()), m_wsgi->listenBacklog()) < 0) {
+                qCWarning(CWSGI_BALANCER) << "Failed to set listen backlog" << strerror(errno);
+            }
+#endif
             pauseAccepting();
         } else {
             std::cerr << "Failed to listen on TCP: " << qPrintable(line)
@@ -354,7 +369,7 @@ bool nativeBind(int socketDescriptor, const QHostAddress &address, quint16 port)
     return true;
 }
 
-int listenReuse(const QHostAddress &address, quint16 port, bool startListening)
+int listenReuse(const QHostAddress &address, quint16 port, int backlog, bool startListening)
 {
     QAbstractSocket::NetworkLayerProtocol proto = address.protocol();
 
@@ -375,13 +390,55 @@ int listenReuse(const QHostAddress &address, quint16 port, bool startListening)
         return -1;
     }
 
-    if (startListening && ::listen(socket, 100) < 0) {
+    if (startListening && ::listen(socket, backlog) < 0) {
         qCCritical(CWSGI_BALANCER) << "Failed to listen to socket" << socket;
         return -1;
     }
 
     return socket;
 }
+
+static bool attachReusePortCbpf(int socket, quint32 groupSize, quint32 cpuAffinity)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    // Returns the index of the group socket whose thread is pinned to the
+    // current CPU, thread N runs on CPUs N * cpu_affinity onwards
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, quint32(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_DIV | BPF_K, 0, 0, cpuAffinity },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, groupSize },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    return ::setsockopt(socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+#else
+    Q_UNUSED(socket)
+    Q_UNUSED(groupSize)
+    Q_UNUSED(cpuAffinity)
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
+void TcpServerBalancer::listenReusePort(bool cbpf)
+{
+    for (TcpServer *server : m_reuseServers) {
+        server->m_reuseSocket = listenReuse(m_address, m_port, m_wsgi->listenBacklog(), true);
+        if (server->m_reuseSocket < 0) {
+            qFatal("Failed to listen on reuse-port socket");
+        }
+    }
+
+    if (cbpf && !m_reuseServers.empty()) {
+        // The program is shared by the whole group
+        if (!attachReusePortCbpf(m_reuseServers.front()->m_reuseSocket, quint32(m_reuseServers.size()), quint32(m_wsgi->cpuAffinity()))) {
+            qCWarning(CWSGI_BALANCER) << "Failed to attach reuse-port CBPF program" << strerror(errno);
+        }
+    }
+}
 #endif // Q_OS_LINUX
 
 void TcpServerBalancer::setBalancer(bool enable)
@@ -389,11 +446,32 @@ void TcpServerBalancer::setBalancer(bool enable)
     m_balancer = enable;
 }
 
+void TcpServerBalancer::setLeastLoaded(bool enable)
+{
+    m_leastLoaded = enable;
+}
+
 void TcpServerBalancer::incomingConnection(qintptr handle)
 {
-    TcpServer *serverIdle = m_servers.at(m_currentServer++ % m_servers.size());
+    const int size = int(m_servers.size());
+    const int start = m_currentServer++ % size;
+    TcpServer *serverIdle = m_servers[start];
+
+    if (m_leastLoaded) {
+        // Connections still queued to a thread count as load, otherwise
+        // a burst would all land on the same idle thread
+        int load = serverIdle->m_processing + serverIdle->m_queued;
+        for (int i = 1; i < size && load; ++i) {
+            TcpServer *server = m_servers[(start + i) % size];
+            const int serverLoad = server->m_processing + server->m_queued;
+            if (serverLoad < load) {
+                serverIdle = server;
+                load = serverLoad;
+            }
+        }
+    }
 
-    Q_EMIT serverIdle->createConnection(handle);
+    serverIdle->queueConnection(handle);
 }
 
 TcpServer *TcpServerBalancer::createServer(CWsgiEngine *engine)
@@ -415,14 +493,19 @@ TcpServer *TcpServerBalancer::createServer(CWsgiEngine *engine)
             m_servers.push_back(server);
             resumeAccepting();
         }, Qt::QueuedConnection);
-        connect(server, &TcpServer::createConnection, server, &TcpServer::incomingConnection, Qt::QueuedConnection);
+        connect(server, &TcpServer::connectionsQueued, server, &TcpServer::processQueuedConnections, Qt::QueuedConnection);
     } else {
 
 #ifdef Q_OS_LINUX
         if (m_wsgi->reusePort()) {
+            // The socket is created by listenReusePort() after fork
+            m_reuseServers.push_back(server);
+            connect(server, &QObject::destroyed, this, [=] () {
+                m_reuseServers.erase(std::remove(m_reuseServers.begin(), m_reuseServers.end(), server),
+                                     m_reuseServers.end());
+            });
             connect(engine, &CWsgiEngine::started, this, [=] () {
-                int socket = listenReuse(m_address, m_port, true);
-                if (!server->setSocketDescriptor(socket)) {
+                if (!server->setSocketDescriptor(server->m_reuseSocket)) {
                     qFatal("Failed to set server socket descriptor, reuse-port");
                 }
             }, Qt::DirectConnection);
@@ -39,22 +39,33 @@ public:
     bool listen(const QString &address, Protocol *protocol, bool secure);
 
     void setBalancer(bool enable);
+    void setLeastLoaded(bool enable);
     QString serverName() const { return m_serverName; }
 
     virtual void incomingConnection(qintptr handle) override;
 
     TcpServer *createServer(CWsgiEngine *engine);
 
+#ifdef Q_OS_LINUX
+    /**
+     * Creates one SO_REUSEPORT listener for each server in creation order,
+     * optionally steering connections to them by CPU with \p cbpf
+     */
+    void listenReusePort(bool cbpf);
+#endif
+
 private:
     QHostAddress m_address;
     quint16 m_port;
     QString m_serverName;
     std::vector<TcpServer *> m_servers;
+    std::vector<TcpServer *> m_reuseServers;
     WSGI *m_wsgi;
     Protocol *m_protocol;
     QSslConfiguration *m_sslConfiguration = nullptr;
     int m_currentServer = 0;
     bool m_balancer = false;
+    bool m_leastLoaded = false;
 };
 
 }
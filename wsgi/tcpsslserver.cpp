@@ -39,9 +39,11 @@ void TcpSslServer::incomingConnection(qintptr handle)
     sock->protoData = m_protocol->createData(sock);
     sock->setSslConfiguration(m_sslConfiguration);
 
-    connect(sock, &QIODevice::readyRead, this, [sock] () {
-        sock->timeout = false;
+    connect(sock, &QIODevice::readyRead, this, [this, sock] () {
         sock->proto->parse(sock, sock);
+        if (sock->state() == QAbstractSocket::ConnectedState) {
+            m_engine->touchSocket(sock);
+        }
     });
     connect(sock, &SslSocket::finished, this, [this, sock] () {
         sock->deleteLater();
@@ -63,6 +65,7 @@ void TcpSslServer::incomingConnection(qintptr handle)
         if (++m_processing) {
             m_engine->startSocketTimeout();
         }
+        m_engine->touchSocket(sock);
 
         sock->startServerEncryption();
         if (m_http2Protocol) {
@@ -100,23 +103,6 @@ void TcpSslServer::shutdown()
     }
 }
 
-void TcpSslServer::timeoutConnections()
-{
-    if (m_processing) {
-        const auto childrenL = children();
-        for (auto child : childrenL) {
-            auto socket = qobject_cast<SslSocket*>(child);
-            if (socket && !socket->processing && socket->state() == QAbstractSocket::ConnectedState) {
-                if (socket->timeout) {
-                    socket->connectionClose();
-                } else {
-                    socket->timeout = true;
-                }
-            }
-        }
-    }
-}
-
 void TcpSslServer::setSslConfiguration(const QSslConfiguration &conf)
 {
     m_sslConfiguration = conf;
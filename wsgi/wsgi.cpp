@@ -152,6 +152,20 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                             QCoreApplication::translate("main", "bytes"));
     parser.addOption(postBufferingBufsize);
 
+    QCommandLineOption postUnbufferedOpt(QStringLiteral("post-unbuffered"),
+                                         QCoreApplication::translate("main", "dispatch requests before their body is received, reading it as it arrives"));
+    parser.addOption(postUnbufferedOpt);
+
+    QCommandLineOption chunkedInputLimitOpt(QStringLiteral("chunked-input-limit"),
+                                            QCoreApplication::translate("main", "set the maximum size of a chunk of a chunked request body"),
+                                            QCoreApplication::translate("main", "bytes"));
+    parser.addOption(chunkedInputLimitOpt);
+
+    QCommandLineOption chunkedInputMaxSizeOpt(QStringLiteral("chunked-input-max-size"),
+                                              QCoreApplication::translate("main", "set the maximum total size of a chunked request body"),
+                                              QCoreApplication::translate("main", "bytes"));
+    parser.addOption(chunkedInputMaxSizeOpt);
+
     QCommandLineOption httpSocketOpt({ QStringLiteral("http-socket"), QStringLiteral("h1") },
                                      QCoreApplication::translate("main", "bind to the specified TCP socket using HTTP protocol"),
                                      QCoreApplication::translate("main", "address"));
@@ -167,6 +181,26 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                                QCoreApplication::translate("main", "size"));
     parser.addOption(http2HeaderTableSizeOpt);
 
+    QCommandLineOption http2MaxConcurrentStreamsOpt(QStringLiteral("http2-max-concurrent-streams"),
+                                                    QCoreApplication::translate("main", "Defines the maximum number of concurrent HTTP/2 streams per connection"),
+                                                    QCoreApplication::translate("main", "streams"));
+    parser.addOption(http2MaxConcurrentStreamsOpt);
+
+    QCommandLineOption http2InitialWindowSizeOpt(QStringLiteral("http2-initial-window-size"),
+                                                 QCoreApplication::translate("main", "Defines the HTTP/2 flow control window of each stream"),
+                                                 QCoreApplication::translate("main", "size"));
+    parser.addOption(http2InitialWindowSizeOpt);
+
+    QCommandLineOption http2ConnectionWindowSizeOpt(QStringLiteral("http2-connection-window-size"),
+                                                    QCoreApplication::translate("main", "Defines the HTTP/2 flow control window of each connection"),
+                                                    QCoreApplication::translate("main", "size"));
+    parser.addOption(http2ConnectionWindowSizeOpt);
+
+    QCommandLineOption http2MaxHeaderListSizeOpt(QStringLiteral("http2-max-header-list-size"),
+                                                 QCoreApplication::translate("main", "Defines the maximum size of HTTP/2 request headers"),
+                                                 QCoreApplication::translate("main", "size"));
+    parser.addOption(http2MaxHeaderListSizeOpt);
+
     QCommandLineOption upgradeH2cOpt(QStringLiteral("upgrade-h2c"),
                                                QCoreApplication::translate("main", "Upgrades HTTP/1 to H2c (HTTP/2 Clear Text)"));
     parser.addOption(upgradeH2cOpt);
@@ -195,6 +229,21 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                      QCoreApplication::translate("main", "seconds"));
     parser.addOption(socketTimeout);
 
+    QCommandLineOption keepaliveTimeout(QStringLiteral("keepalive-timeout"),
+                                        QCoreApplication::translate("main", "set idle timeout between requests, defaults to socket-timeout"),
+                                        QCoreApplication::translate("main", "seconds"));
+    parser.addOption(keepaliveTimeout);
+
+    QCommandLineOption headerTimeout(QStringLiteral("header-timeout"),
+                                     QCoreApplication::translate("main", "set timeout to receive the request headers, defaults to socket-timeout"),
+                                     QCoreApplication::translate("main", "seconds"));
+    parser.addOption(headerTimeout);
+
+    QCommandLineOption bodyTimeout(QStringLiteral("body-timeout"),
+                                   QCoreApplication::translate("main", "set idle timeout while receiving the request body, defaults to socket-timeout"),
+                                   QCoreApplication::translate("main", "seconds"));
+    parser.addOption(bodyTimeout);
+
     QCommandLineOption staticMapOpt(QStringLiteral("static-map"),
                                     QCoreApplication::translate("main", "map mountpoint to static directory (or file)"),
                                     QCoreApplication::translate("main", "mountpoint=path"));
@@ -283,16 +332,34 @@ void WSGI::parseCommandLine(const QStringList &arguments)
     parser.addOption(cpuAffinityOption);
 #endif // Q_OS_UNIX
 
+    QCommandLineOption listenBacklogOption(QStringLiteral("listen-backlog"),
+                                           QCoreApplication::translate("main", "set the TCP socket listen queue size"),
+                                           QCoreApplication::translate("main", "size"));
+    parser.addOption(listenBacklogOption);
+
 #ifdef Q_OS_LINUX
     QCommandLineOption reusePortOption(QStringLiteral("reuse-port"),
                                        QCoreApplication::translate("main", "enable SO_REUSEPORT flag on socket (Linux 3.9+)"));
     parser.addOption(reusePortOption);
+
+    QCommandLineOption reusePortCbpfOption(QStringLiteral("reuse-port-cbpf"),
+                                           QCoreApplication::translate("main", "steer connections to the thread on the receiving CPU (Linux 4.5+)"));
+    parser.addOption(reusePortCbpfOption);
+
+    QCommandLineOption nativeSocketsOption(QStringLiteral("native-sockets"),
+                                           QCoreApplication::translate("main", "use sockets driven directly by the EPoll event loop for plain TCP"));
+    parser.addOption(nativeSocketsOption);
 #endif
 
     QCommandLineOption threadBalancerOpt(QStringLiteral("experimental-thread-balancer"),
                                          QCoreApplication::translate("main", "balances new connections to threads using round-robin"));
     parser.addOption(threadBalancerOpt);
 
+    QCommandLineOption threadBalancerPolicyOpt(QStringLiteral("thread-balancer"),
+                                               QCoreApplication::translate("main", "balances new connections to threads using round-robin or least-loaded policy"),
+                                               QCoreApplication::translate("main", "policy"));
+    parser.addOption(threadBalancerPolicyOpt);
+
     // Process the actual command line arguments given by the user
     parser.process(arguments);
 
@@ -335,6 +402,33 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         }
     }
 
+    if (parser.isSet(keepaliveTimeout)) {
+        bool ok;
+        auto size = parser.value(keepaliveTimeout).toInt(&ok);
+        setKeepaliveTimeout(size);
+        if (!ok || size < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(headerTimeout)) {
+        bool ok;
+        auto size = parser.value(headerTimeout).toInt(&ok);
+        setHeaderTimeout(size);
+        if (!ok || size < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(bodyTimeout)) {
+        bool ok;
+        auto size = parser.value(bodyTimeout).toInt(&ok);
+        setBodyTimeout(size);
+        if (!ok || size < 0) {
+            parser.showHelp(1);
+        }
+    }
+
     if (parser.isSet(pidfileOpt)) {
         setPidfile(parser.value(pidfileOpt));
     }
@@ -382,10 +476,27 @@ void WSGI::parseCommandLine(const QStringList &arguments)
     }
 #endif // Q_OS_UNIX
 
+    if (parser.isSet(listenBacklogOption)) {
+        bool ok;
+        auto value = parser.value(listenBacklogOption).toInt(&ok);
+        setListenBacklog(value);
+        if (!ok || value < 1) {
+            parser.showHelp(1);
+        }
+    }
+
 #ifdef Q_OS_LINUX
     if (parser.isSet(reusePortOption)) {
         setReusePort(true);
     }
+
+    if (parser.isSet(reusePortCbpfOption)) {
+        setReusePortCbpf(true);
+    }
+
+    if (parser.isSet(nativeSocketsOption)) {
+        setNativeSockets(true);
+    }
 #endif
 
     if (parser.isSet(lazyOption)) {
@@ -419,6 +530,28 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         }
     }
 
+    if (parser.isSet(postUnbufferedOpt)) {
+        setPostUnbuffered(true);
+    }
+
+    if (parser.isSet(chunkedInputLimitOpt)) {
+        bool ok;
+        auto size = parser.value(chunkedInputLimitOpt).toLongLong(&ok);
+        setChunkedInputLimit(size);
+        if (!ok || size < 1) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(chunkedInputMaxSizeOpt)) {
+        bool ok;
+        auto size = parser.value(chunkedInputMaxSizeOpt).toLongLong(&ok);
+        setChunkedInputMaxSize(size);
+        if (!ok || size < 0) {
+            parser.showHelp(1);
+        }
+    }
+
     if (parser.isSet(application)) {
         setApplication(parser.value(application));
     }
@@ -483,6 +616,42 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         }
     }
 
+    if (parser.isSet(http2MaxConcurrentStreamsOpt)) {
+        bool ok;
+        auto streams = parser.value(http2MaxConcurrentStreamsOpt).toUInt(&ok);
+        setHttp2MaxConcurrentStreams(streams);
+        if (!ok) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(http2InitialWindowSizeOpt)) {
+        bool ok;
+        auto size = parser.value(http2InitialWindowSizeOpt).toUInt(&ok);
+        setHttp2InitialWindowSize(size);
+        if (!ok || size < 65535 || size > 2147483647) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(http2ConnectionWindowSizeOpt)) {
+        bool ok;
+        auto size = parser.value(http2ConnectionWindowSizeOpt).toUInt(&ok);
+        setHttp2ConnectionWindowSize(size);
+        if (!ok || size < 65535 || size > 2147483647) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(http2MaxHeaderListSizeOpt)) {
+        bool ok;
+        auto size = parser.value(http2MaxHeaderListSizeOpt).toUInt(&ok);
+        setHttp2MaxHeaderListSize(size);
+        if (!ok) {
+            parser.showHelp(1);
+        }
+    }
+
     setHttpSocket(httpSocket() + parser.values(httpSocketOpt));
 
     setHttp2Socket(http2Socket() + parser.values(http2SocketOpt));
@@ -497,7 +666,15 @@ void WSGI::parseCommandLine(const QStringList &arguments)
 
     setTouchReload(touchReload() + parser.values(touchReloadOpt));
 
-    d->threadBalancer = parser.isSet(threadBalancerOpt);
+    if (parser.isSet(threadBalancerPolicyOpt)) {
+        const QString policy = parser.value(threadBalancerPolicyOpt);
+        if (policy != QLatin1String("round-robin") && policy != QLatin1String("least-loaded")) {
+            parser.showHelp(1);
+        }
+        setThreadBalancer(policy);
+    } else if (parser.isSet(threadBalancerOpt)) {
+        setThreadBalancer(QStringLiteral("round-robin"));
+    }
 }
 
 int WSGI::exec(Cutelyst::Application *app)
@@ -667,7 +844,8 @@ bool WSGIPrivate::listenTcp(const QString &line, Protocol *protocol, bool secure
     bool ret = true;
     if (!line.startsWith(QLatin1Char('/'))) {
         auto server = new TcpServerBalancer(q);
-        server->setBalancer(threadBalancer);
+        server->setBalancer(!threadBalancer.isEmpty());
+        server->setLeastLoaded(threadBalancer == QLatin1String("least-loaded"));
         ret = server->listen(line, protocol, secure);
 
         if (ret && server->socketDescriptor()) {
@@ -897,6 +1075,58 @@ quint32 WSGI::http2HeaderTableSize() const
     return d->http2HeaderTableSize;
 }
 
+void WSGI::setHttp2MaxConcurrentStreams(quint32 maxStreams)
+{
+    Q_D(WSGI);
+    d->http2MaxConcurrentStreams = maxStreams;
+    Q_EMIT changed();
+}
+
+quint32 WSGI::http2MaxConcurrentStreams() const
+{
+    Q_D(const WSGI);
+    return d->http2MaxConcurrentStreams;
+}
+
+void WSGI::setHttp2InitialWindowSize(quint32 windowSize)
+{
+    Q_D(WSGI);
+    d->http2InitialWindowSize = qBound(quint32(65535), windowSize, quint32(2147483647));
+    Q_EMIT changed();
+}
+
+quint32 WSGI::http2InitialWindowSize() const
+{
+    Q_D(const WSGI);
+    return d->http2InitialWindowSize;
+}
+
+void WSGI::setHttp2ConnectionWindowSize(quint32 windowSize)
+{
+    Q_D(WSGI);
+    d->http2ConnectionWindowSize = qBound(quint32(65535), windowSize, quint32(2147483647));
+    Q_EMIT changed();
+}
+
+quint32 WSGI::http2ConnectionWindowSize() const
+{
+    Q_D(const WSGI);
+    return d->http2ConnectionWindowSize;
+}
+
+void WSGI::setHttp2MaxHeaderListSize(quint32 size)
+{
+    Q_D(WSGI);
+    d->http2MaxHeaderListSize = size;
+    Q_EMIT changed();
+}
+
+quint32 WSGI::http2MaxHeaderListSize() const
+{
+    Q_D(const WSGI);
+    return d->http2MaxHeaderListSize;
+}
+
 void WSGI::setUpgradeH2c(bool enable)
 {
     Q_D(WSGI);
@@ -975,6 +1205,45 @@ int WSGI::socketTimeout() const
     return d->socketTimeout;
 }
 
+void WSGI::setKeepaliveTimeout(int timeout)
+{
+    Q_D(WSGI);
+    d->keepaliveTimeout = timeout;
+    Q_EMIT changed();
+}
+
+int WSGI::keepaliveTimeout() const
+{
+    Q_D(const WSGI);
+    return d->keepaliveTimeout;
+}
+
+void WSGI::setHeaderTimeout(int timeout)
+{
+    Q_D(WSGI);
+    d->headerTimeout = timeout;
+    Q_EMIT changed();
+}
+
+int WSGI::headerTimeout() const
+{
+    Q_D(const WSGI);
+    return d->headerTimeout;
+}
+
+void WSGI::setBodyTimeout(int timeout)
+{
+    Q_D(WSGI);
+    d->bodyTimeout = timeout;
+    Q_EMIT changed();
+}
+
+int WSGI::bodyTimeout() const
+{
+    Q_D(const WSGI);
+    return d->bodyTimeout;
+}
+
 void WSGI::setChdir2(const QString &chdir2)
 {
     Q_D(WSGI);
@@ -1130,6 +1399,45 @@ qint64 WSGI::postBufferingBufsize() const
     return d->postBufferingBufsize;
 }
 
+void WSGI::setPostUnbuffered(bool enable)
+{
+    Q_D(WSGI);
+    d->postUnbuffered = enable;
+    Q_EMIT changed();
+}
+
+bool WSGI::postUnbuffered() const
+{
+    Q_D(const WSGI);
+    return d->postUnbuffered;
+}
+
+void WSGI::setChunkedInputLimit(qint64 size)
+{
+    Q_D(WSGI);
+    d->chunkedInputLimit = size;
+    Q_EMIT changed();
+}
+
+qint64 WSGI::chunkedInputLimit() const
+{
+    Q_D(const WSGI);
+    return d->chunkedInputLimit;
+}
+
+void WSGI::setChunkedInputMaxSize(qint64 size)
+{
+    Q_D(WSGI);
+    d->chunkedInputMaxSize = size;
+    Q_EMIT changed();
+}
+
+qint64 WSGI::chunkedInputMaxSize() const
+{
+    Q_D(const WSGI);
+    return d->chunkedInputMaxSize;
+}
+
 void WSGI::setTcpNodelay(bool enable)
 {
     Q_D(WSGI);
@@ -1311,6 +1619,19 @@ int WSGI::cpuAffinity() const
     return d->cpuAffinity;
 }
 
+void WSGI::setListenBacklog(int value)
+{
+    Q_D(WSGI);
+    d->listenBacklog = value;
+    Q_EMIT changed();
+}
+
+int WSGI::listenBacklog() const
+{
+    Q_D(const WSGI);
+    return d->listenBacklog;
+}
+
 void WSGI::setReusePort(bool enable)
 {
 #ifdef Q_OS_LINUX
@@ -1326,6 +1647,53 @@ bool WSGI::reusePort() const
     return d->reusePort;
 }
 
+void WSGI::setReusePortCbpf(bool enable)
+{
+#ifdef Q_OS_LINUX
+    Q_D(WSGI);
+    d->reusePortCbpf = enable;
+    Q_EMIT changed();
+#endif
+}
+
+bool WSGI::reusePortCbpf() const
+{
+    Q_D(const WSGI);
+    return d->reusePortCbpf;
+}
+
+void WSGI::setNativeSockets(bool enable)
+{
+#ifdef Q_OS_LINUX
+    Q_D(WSGI);
+    d->nativeSockets = enable;
+    Q_EMIT changed();
+#endif
+}
+
+bool WSGI::nativeSockets() const
+{
+    Q_D(const WSGI);
+    return d->nativeSockets;
+}
+
+void WSGI::setThreadBalancer(const QString &policy)
+{
+    Q_D(WSGI);
+    if (!policy.isEmpty() && policy != QLatin1String("round-robin") && policy != QLatin1String("least-loaded")) {
+        qCWarning(CUTELYST_WSGI) << "Unknown thread balancer policy" << policy << ", ignoring";
+        return;
+    }
+    d->threadBalancer = policy;
+    Q_EMIT changed();
+}
+
+QString WSGI::threadBalancer() const
+{
+    Q_D(const WSGI);
+    return d->threadBalancer;
+}
+
 void WSGI::setLazy(bool enable)
 {
     Q_D(WSGI);
@@ -1431,6 +1799,33 @@ void WSGIPrivate::postFork(int workerId)
         setupApplication();
     }
 
+#ifdef Q_OS_LINUX
+    if (reusePort) {
+        // The SO_REUSEPORT group index follows the listen() order, so create
+        // the listeners here in engine order before the threads start
+        bool cbpf = reusePortCbpf;
+        if (cbpf && processes > 1) {
+            qCWarning(CUTELYST_WSGI) << "Ignoring reuse-port-cbpf as it requires a single process";
+            cbpf = false;
+        } else if (cbpf && cpuAffinity < 1) {
+            qCWarning(CUTELYST_WSGI) << "Ignoring reuse-port-cbpf as it requires cpu-affinity to pin the threads";
+            cbpf = false;
+        } else if (cbpf && int(engines.size()) * cpuAffinity > UnixFork::idealThreadCount()) {
+            // UnixFork::setSched() wraps around the cores, threads would then
+            // share CPUs and the program would leave some without connections
+            qCWarning(CUTELYST_WSGI) << "Ignoring reuse-port-cbpf as threads * cpu-affinity exceeds the CPU count";
+            cbpf = false;
+        }
+
+        for (QObject *server : servers) {
+            auto balancer = qobject_cast<TcpServerBalancer *>(server);
+            if (balancer) {
+                balancer->listenReusePort(cbpf);
+            }
+        }
+    }
+#endif
+
     if (engines.size() > 1) {
         qCDebug(CUTELYST_WSGI) << "Starting threads";
     }
@@ -141,6 +141,42 @@ public:
     void setHttp2HeaderTableSize(quint32 headerTableSize);
     quint32 http2HeaderTableSize() const;
 
+    /**
+     * Defines the maximum number of concurrent streams a client may open on an HTTP/2
+     * connection (SETTINGS_MAX_CONCURRENT_STREAMS), 0 means no limit. Default value: 100
+     * @accessors http2MaxConcurrentStreams(), setHttp2MaxConcurrentStreams()
+     */
+    Q_PROPERTY(quint32 http2_max_concurrent_streams READ http2MaxConcurrentStreams WRITE setHttp2MaxConcurrentStreams NOTIFY changed)
+    void setHttp2MaxConcurrentStreams(quint32 maxStreams);
+    quint32 http2MaxConcurrentStreams() const;
+
+    /**
+     * Defines the HTTP/2 flow control window of each stream for request bodies
+     * (SETTINGS_INITIAL_WINDOW_SIZE), from 65535 to 2147483647. Default value: 65535
+     * @accessors http2InitialWindowSize(), setHttp2InitialWindowSize()
+     */
+    Q_PROPERTY(quint32 http2_initial_window_size READ http2InitialWindowSize WRITE setHttp2InitialWindowSize NOTIFY changed)
+    void setHttp2InitialWindowSize(quint32 windowSize);
+    quint32 http2InitialWindowSize() const;
+
+    /**
+     * Defines the HTTP/2 flow control window of the whole connection for request bodies,
+     * from 65535 to 2147483647. Default value: 65535
+     * @accessors http2ConnectionWindowSize(), setHttp2ConnectionWindowSize()
+     */
+    Q_PROPERTY(quint32 http2_connection_window_size READ http2ConnectionWindowSize WRITE setHttp2ConnectionWindowSize NOTIFY changed)
+    void setHttp2ConnectionWindowSize(quint32 windowSize);
+    quint32 http2ConnectionWindowSize() const;
+
+    /**
+     * Defines the maximum size of the request header list on HTTP/2 (SETTINGS_MAX_HEADER_LIST_SIZE),
+     * larger requests get a 431 reply, 0 means no limit. Default value: 0
+     * @accessors http2MaxHeaderListSize(), setHttp2MaxHeaderListSize()
+     */
+    Q_PROPERTY(quint32 http2_max_header_list_size READ http2MaxHeaderListSize WRITE setHttp2MaxHeaderListSize NOTIFY changed)
+    void setHttp2MaxHeaderListSize(quint32 size);
+    quint32 http2MaxHeaderListSize() const;
+
     /**
      * Defines if an HTTP/1 connection can be upgraded to H2C (HTTP 2 Clear Text)
      * Defaults to false
@@ -191,6 +227,33 @@ public:
     void setSocketTimeout(int timeout);
     int socketTimeout() const;
 
+    /**
+     * Defines how many seconds an idle connection is kept open between requests,
+     * 0 uses socket_timeout
+     * @accessors keepaliveTimeout(), setKeepaliveTimeout()
+     */
+    Q_PROPERTY(int keepalive_timeout READ keepaliveTimeout WRITE setKeepaliveTimeout NOTIFY changed)
+    void setKeepaliveTimeout(int timeout);
+    int keepaliveTimeout() const;
+
+    /**
+     * Defines how many seconds a client has to send the request headers
+     * counting from the first byte, 0 uses socket_timeout
+     * @accessors headerTimeout(), setHeaderTimeout()
+     */
+    Q_PROPERTY(int header_timeout READ headerTimeout WRITE setHeaderTimeout NOTIFY changed)
+    void setHeaderTimeout(int timeout);
+    int headerTimeout() const;
+
+    /**
+     * Defines how many seconds a client may stay silent while sending
+     * the request body, 0 uses socket_timeout
+     * @accessors bodyTimeout(), setBodyTimeout()
+     */
+    Q_PROPERTY(int body_timeout READ bodyTimeout WRITE setBodyTimeout NOTIFY changed)
+    void setBodyTimeout(int timeout);
+    int bodyTimeout() const;
+
     /**
      * Defines directory to chdir to after application loading
      * @accessors chdir2(), setChdir2()
@@ -266,7 +329,8 @@ public:
 
     /**
      * Defines the maximum buffer size of POST request, if a request has a content length
-     * that is bigger than the post buffer size a temporary file is created instead
+     * that is bigger than the post buffer size a temporary file is created instead,
+     * chunked request bodies are moved to a temporary file once they grow past it
      * @accessors postBuffering(), setPostBuffering()
      */
     Q_PROPERTY(qint64 post_buffering READ postBuffering WRITE setPostBuffering NOTIFY changed)
@@ -281,6 +345,38 @@ public:
     void setPostBufferingBufsize(qint64 size);
     qint64 postBufferingBufsize() const;
 
+    /**
+     * Dispatches requests as soon as their headers arrive, Request::body() is then a
+     * sequential device that fills as the body comes in (emitting readyRead()), for HTTP/2
+     * the stream receive window is only given back as the application reads it, for
+     * HTTP/1.1 the socket isn't read while post_buffering_bufsize bytes wait to be read.
+     * waitForReadyRead() is not supported, handlers call Context::detachAsync(), read
+     * the body on readyRead() and call Context::attachAsync() once readChannelFinished()
+     * is emitted.
+     * Body parameters, uploads and JSON body data are not parsed in this mode.
+     * @accessors postUnbuffered(), setPostUnbuffered()
+     */
+    Q_PROPERTY(bool post_unbuffered READ postUnbuffered WRITE setPostUnbuffered NOTIFY changed)
+    void setPostUnbuffered(bool enable);
+    bool postUnbuffered() const;
+
+    /**
+     * Defines the maximum size of a single chunk of a HTTP/1.1 chunked request body,
+     * bigger chunks are replied with 413 and the connection is closed
+     * @accessors chunkedInputLimit(), setChunkedInputLimit()
+     */
+    Q_PROPERTY(qint64 chunked_input_limit READ chunkedInputLimit WRITE setChunkedInputLimit NOTIFY changed)
+    void setChunkedInputLimit(qint64 size);
+    qint64 chunkedInputLimit() const;
+
+    /**
+     * Defines the maximum total size of a HTTP/1.1 chunked request body, 0 means no limit
+     * @accessors chunkedInputMaxSize(), setChunkedInputMaxSize()
+     */
+    Q_PROPERTY(qint64 chunked_input_max_size READ chunkedInputMaxSize WRITE setChunkedInputMaxSize NOTIFY changed)
+    void setChunkedInputMaxSize(qint64 size);
+    qint64 chunkedInputMaxSize() const;
+
     /**
      * Enable TCP NODELAY on each request
      * @accessors tcpNodelay(), setTcpNodelay()
@@ -391,6 +487,16 @@ public:
     void setCpuAffinity(int value);
     int cpuAffinity() const;
 
+    /**
+     * Defines the TCP listen queue size, connections arriving while the queue
+     * is full are dropped by the kernel, which is capped by net.core.somaxconn.
+     * Default value: 100
+     * @accessors listenBacklog(), setListenBacklog()
+     */
+    Q_PROPERTY(int listen_backlog READ listenBacklog WRITE setListenBacklog NOTIFY changed)
+    void setListenBacklog(int value);
+    int listenBacklog() const;
+
     /**
      * Enable SO_REUSEPORT for the sockets
      * @accessors reusePort(), setReusePort()
@@ -400,6 +506,40 @@ public:
     void setReusePort(bool enable);
     bool reusePort() const;
 
+    /**
+     * Attaches a classic BPF program to the SO_REUSEPORT group so the kernel
+     * hands a new connection to the worker thread pinned to the CPU that
+     * received it, that is (cpu / cpu_affinity) % threads, use with reuse_port.
+     * @accessors reusePortCbpf(), setReusePortCbpf()
+     * \note Linux only, ignored with more than one process, without cpu_affinity or
+     * when threads * cpu_affinity exceeds the CPU count
+     */
+    Q_PROPERTY(bool reuse_port_cbpf READ reusePortCbpf WRITE setReusePortCbpf NOTIFY changed)
+    void setReusePortCbpf(bool enable);
+    bool reusePortCbpf() const;
+
+    /**
+     * Uses sockets driven directly by the EPoll event loop for plain TCP
+     * connections instead of QTcpSocket, data is read straight into the
+     * protocol buffers and written with writev() skipping Qt's buffers.
+     * @accessors nativeSockets(), setNativeSockets()
+     * \note Linux only, requires the default EPoll event loop
+     */
+    Q_PROPERTY(bool native_sockets READ nativeSockets WRITE setNativeSockets NOTIFY changed)
+    void setNativeSockets(bool enable);
+    bool nativeSockets() const;
+
+    /**
+     * Balances new TCP connections among the worker threads from a single
+     * acceptor, \c round-robin hands them in turn while \c least-loaded
+     * picks the thread with fewer open connections. Empty disables the
+     * balancer and lets each thread accept on its own.
+     * @accessors threadBalancer(), setThreadBalancer()
+     */
+    Q_PROPERTY(QString thread_balancer READ threadBalancer WRITE setThreadBalancer NOTIFY changed)
+    void setThreadBalancer(const QString &policy);
+    QString threadBalancer() const;
+
     /**
      * Defines is the Application should be lazy loaded.
      * @accessors lazy(), setLazy()
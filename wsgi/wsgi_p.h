@@ -70,6 +70,10 @@ public:
     QStringList httpSockets;
     QStringList http2Sockets;
     quint32 http2HeaderTableSize = 4096;
+    quint32 http2MaxConcurrentStreams = 100;
+    quint32 http2InitialWindowSize = 65535;
+    quint32 http2ConnectionWindowSize = 65535;
+    quint32 http2MaxHeaderListSize = 0;
     QStringList httpsSockets;
     QStringList fastcgiSockets;
     QStringList staticMaps;
@@ -89,9 +93,15 @@ public:
     QString umask;
     bool noInitgroups = false;
     int cpuAffinity = 0;
+    int listenBacklog = 100;
     bool reusePort = false;
+    bool reusePortCbpf = false;
+    bool nativeSockets = false;
     qint64 postBuffering = -1;
     qint64 postBufferingBufsize = 4096;
+    qint64 chunkedInputLimit = 1048576;
+    qint64 chunkedInputMaxSize = 0;
+    bool postUnbuffered = false;
     Protocol *protoHTTP = nullptr;
     ProtocolHttp2 *protoHTTP2 = nullptr;
     Protocol *protoFCGI = nullptr;
@@ -103,13 +113,16 @@ public:
     int socketSendBuf = -1;
     int socketReceiveBuf = -1;
     int socketTimeout = 4;
+    int keepaliveTimeout = 0;
+    int headerTimeout = 0;
+    int bodyTimeout = 0;
     int websocketMaxSize = 1024 * 1024;
     bool lazy = false;
     bool master = false;
     bool autoReload = false;
     bool tcpNodelay = false;
     bool soKeepalive = false;
-    bool threadBalancer = false;
+    QString threadBalancer;
     bool userEventLoop = false;
     bool upgradeH2c = false;
     bool httpsH2 = false;